@@ -0,0 +1,292 @@
+#pragma once
+
+#include "VulkanMemoryAllocator.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "Model.h"
+#include "JobSystem.h"
+#include "FrustumCulling.h"
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+
+namespace LightVulkan {
+    namespace Benchmarks {
+
+        // Typical discrete GPU layout: device local VRAM plus host visible system memory
+        inline VkPhysicalDeviceMemoryProperties simulatedDesktopMemory() {
+            VkPhysicalDeviceMemoryProperties props{};
+            props.memoryHeapCount = 2;
+            props.memoryHeaps[0].size = 8ull * 1024 * 1024 * 1024;
+            props.memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+            props.memoryHeaps[1].size = 16ull * 1024 * 1024 * 1024;
+
+            props.memoryTypeCount = 3;
+            props.memoryTypes[0].heapIndex = 0;
+            props.memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            props.memoryTypes[1].heapIndex = 1;
+            props.memoryTypes[1].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            props.memoryTypes[2].heapIndex = 1;
+            props.memoryTypes[2].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+            return props;
+        }
+
+        // Random allocate/free churn against the allocator without touching a GPU
+        inline void runAllocatorBenchmark(uint32_t operationCount) {
+            VulkanMemoryAllocator allocator;
+            allocator.createSimulated(simulatedDesktopMemory(), 1024);
+
+            // Churn around a steady working set, roughly what a streaming scene keeps resident
+            const size_t workingSet = 4096;
+            std::mt19937 rng(1234);
+            std::vector<VulkanAllocation> live;
+            live.reserve(workingSet * 2);
+
+            auto randomRequirements = [&rng]() {
+                VkMemoryRequirements requirements{};
+                // Mostly small buffers with a tail of large textures
+                uint32_t bucket = rng() % 100;
+                if (bucket < 70) {
+                    requirements.size = 64 + rng() % (64 * 1024);
+                }
+                else if (bucket < 95) {
+                    requirements.size = 64 * 1024 + rng() % (1024 * 1024);
+                }
+                else {
+                    requirements.size = 1024 * 1024 + rng() % (16 * 1024 * 1024);
+                }
+                requirements.alignment = 1ull << (4 + rng() % 13);
+                requirements.memoryTypeBits = 0x7;
+                return requirements;
+            };
+
+            VkDeviceSize peakUsed = 0;
+            uint32_t peakBlocks = 0;
+            auto startTime = std::chrono::high_resolution_clock::now();
+
+            for (uint32_t i = 0; i < operationCount; i++) {
+                if (live.size() < workingSet / 2 || (live.size() < workingSet * 2 && rng() % 2 == 0)) {
+                    VkMemoryPropertyFlags properties = rng() % 4 == 0
+                        ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                        : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+                    AllocationKind kind = rng() % 2 ? AllocationKind::Linear : AllocationKind::Optimal;
+                    live.push_back(allocator.allocate(randomRequirements(), properties, kind));
+                }
+                else {
+                    size_t index = rng() % live.size();
+                    allocator.free(live[index]);
+                    live[index] = live.back();
+                    live.pop_back();
+                }
+
+                if (i % 1024 == 0) {
+                    VulkanAllocatorStats stats = allocator.getStats();
+                    peakUsed = std::max(peakUsed, stats.usedBytes);
+                    peakBlocks = std::max(peakBlocks, stats.blockCount);
+                }
+            }
+
+            auto endTime = std::chrono::high_resolution_clock::now();
+            double ms = std::chrono::duration<double, std::chrono::milliseconds::period>(endTime - startTime).count();
+            VulkanAllocatorStats stats = allocator.getStats();
+
+            std::cout << "Allocator: " << operationCount << " ops in " << ms << " ms ("
+                << (ms > 0.0 ? operationCount / ms * 1000.0 : 0.0) << " ops/s)" << std::endl;
+            std::cout << "  live allocations " << stats.allocationCount << ", blocks " << stats.blockCount
+                << " (peak " << peakBlocks << ")" << std::endl;
+            std::cout << "  used " << stats.usedBytes / (1024.0 * 1024.0) << " MB of "
+                << stats.blockBytes / (1024.0 * 1024.0) << " MB (peak used " << peakUsed / (1024.0 * 1024.0) << " MB)" << std::endl;
+            std::cout << "  fragmentation " << stats.fragmentation * 100.0f << "%" << std::endl;
+
+            for (auto& allocation : live) {
+                allocator.free(allocation);
+            }
+            allocator.destroy();
+        }
+
+        // Cold OBJ parse plus dedup and optimization against mapping, validating and copying the binary cache
+        inline void runMeshLoadBenchmark(const std::string& objPath, uint32_t iterations = 10) {
+            using Clock = std::chrono::high_resolution_clock;
+
+            std::vector<Vertex> vertices;
+            std::vector<uint32_t> indices;
+            JobSystem jobSystem;
+            jobSystem.create();
+            auto parseStart = Clock::now();
+            Model::parseObj(objPath, vertices, indices, jobSystem);
+            jobSystem.destroy();
+            double parseMs = std::chrono::duration<double, std::chrono::milliseconds::period>(Clock::now() - parseStart).count();
+
+            auto optimizeStart = Clock::now();
+            MeshOptimizer::Report report = MeshOptimizer::optimize(vertices, indices);
+            double optimizeMs = std::chrono::duration<double, std::chrono::milliseconds::period>(Clock::now() - optimizeStart).count();
+
+            std::string cachePath = MeshCache::getCachePath(objPath);
+            if (!MeshCache::write(cachePath, vertices, indices, MeshCache::FLAG_OPTIMIZED)) {
+                throw std::runtime_error("failed to write mesh cache!");
+            }
+
+            // Stands in for the staging ring, allocated up front like the real one
+            std::vector<uint8_t> staging(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t));
+
+            double cacheMs = 0.0;
+            for (uint32_t i = 0; i < iterations; i++) {
+                auto cacheStart = Clock::now();
+                MappedFile file;
+                MeshCacheView view;
+                if (!file.open(cachePath) || !MeshCache::read(file, view)) {
+                    throw std::runtime_error("failed to read mesh cache!");
+                }
+                memcpy(staging.data(), view.vertices, view.vertexCount * sizeof(Vertex));
+                memcpy(staging.data() + view.vertexCount * sizeof(Vertex), view.indices, view.indexCount * sizeof(uint32_t));
+                cacheMs += std::chrono::duration<double, std::chrono::milliseconds::period>(Clock::now() - cacheStart).count();
+            }
+            cacheMs /= iterations;
+
+            std::cout << "Mesh: " << objPath << " (" << vertices.size() << " vertices, " << indices.size() << " indices)" << std::endl;
+            std::cout << "  OBJ parse " << parseMs << " ms, optimize " << optimizeMs << " ms, cache load " << cacheMs << " ms ("
+                << (cacheMs > 0.0 ? (parseMs + optimizeMs) / cacheMs : 0.0) << "x)" << std::endl;
+            std::cout << "  ACMR " << report.before.acmr << " -> " << report.after.acmr
+                << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << std::endl;
+
+            size_t indexSize = vertices.size() <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+            std::cout << "  vertex data " << vertices.size() * sizeof(Vertex) << " -> " << vertices.size() * sizeof(PackedVertex)
+                << " bytes packed, index data " << indices.size() * sizeof(uint32_t) << " -> " << indices.size() * indexSize << " bytes" << std::endl;
+        }
+
+        // Vertex assembly and dedup only, the tinyobj text parse is done once up front
+        inline void runMeshIngestBenchmark(const std::string& objPath) {
+            using Clock = std::chrono::high_resolution_clock;
+
+            tinyobj::attrib_t attrib;
+            std::vector<tinyobj::shape_t> shapes;
+            std::vector<tinyobj::material_t> materials;
+            std::string warn, err;
+            if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, objPath.c_str())) {
+                throw std::runtime_error(warn + err);
+            }
+
+            uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+            double singleMs = 0.0;
+            for (uint32_t threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+                std::vector<Vertex> vertices;
+                std::vector<uint32_t> indices;
+                JobSystem jobSystem;
+                jobSystem.create(threads);
+                auto start = Clock::now();
+                MeshIngest::buildIndexedMesh(attrib, shapes, vertices, indices, jobSystem);
+                double ms = std::chrono::duration<double, std::chrono::milliseconds::period>(Clock::now() - start).count();
+                jobSystem.destroy();
+                if (threads == 1) {
+                    singleMs = ms;
+                }
+
+                std::cout << "  dedup " << threads << " threads: " << ms << " ms ("
+                    << (ms > 0.0 ? singleMs / ms : 0.0) << "x, " << vertices.size() << " unique)" << std::endl;
+
+                if (threads == maxThreads) {
+                    break;
+                }
+            }
+        }
+
+        // Small independent jobs through parallelFor, then a chain of fan-out stages linked by counter dependencies
+        inline void runJobSystemBenchmark(uint32_t jobCount = 100000, uint32_t stageCount = 64) {
+            using Clock = std::chrono::high_resolution_clock;
+
+            std::vector<float> data(jobCount);
+            auto work = [&data](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; i++) {
+                    float value = static_cast<float>(i);
+                    for (int step = 0; step < 64; step++) {
+                        value = value * 0.999f + 1.0f;
+                    }
+                    data[i] = value;
+                }
+            };
+
+            uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+            double singleMs = 0.0;
+            std::cout << "job system, " << jobCount << " jobs, " << stageCount << " dependent stages" << std::endl;
+            for (uint32_t threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+                JobSystem jobSystem;
+                jobSystem.create(threads);
+
+                auto start = Clock::now();
+                jobSystem.parallelFor(jobCount, 16, work);
+                double forMs = std::chrono::duration<double, std::chrono::milliseconds::period>(Clock::now() - start).count();
+
+                uint32_t stageJobs = jobCount / stageCount;
+                std::vector<JobCounter> stages(stageCount);
+                start = Clock::now();
+                for (uint32_t stage = 0; stage < stageCount; stage++) {
+                    JobCounter* dependency = stage > 0 ? &stages[stage - 1] : nullptr;
+                    for (uint32_t job = 0; job < stageJobs; job += 16) {
+                        uint32_t begin = stage * stageJobs + job;
+                        uint32_t end = std::min(begin + 16, (stage + 1) * stageJobs);
+                        jobSystem.run([&work, begin, end]() { work(begin, end); }, &stages[stage], dependency);
+                    }
+                }
+                jobSystem.wait(stages.back());
+                double chainMs = std::chrono::duration<double, std::chrono::milliseconds::period>(Clock::now() - start).count();
+
+                jobSystem.destroy();
+
+                if (threads == 1) {
+                    singleMs = forMs;
+                }
+                std::cout << "  " << threads << " threads: parallelFor " << forMs << " ms ("
+                    << (forMs > 0.0 ? jobCount / 16 / (forMs / 1000.0) : 0.0) << " jobs/s, "
+                    << (forMs > 0.0 ? singleMs / forMs : 0.0) << "x), dependency chain " << chainMs << " ms" << std::endl;
+
+                if (threads == maxThreads) {
+                    break;
+                }
+            }
+        }
+
+        // Random boxes scattered around a camera, the SIMD path against the scalar reference
+        inline void runCullingBenchmark(uint32_t objectCount = 100000, uint32_t iterations = 100) {
+            using Clock = std::chrono::high_resolution_clock;
+
+            std::mt19937 rng(42);
+            std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+            std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+            CullingBounds bounds;
+            bounds.resize(objectCount);
+            for (uint32_t i = 0; i < objectCount; i++) {
+                bounds.set(i, glm::vec3(position(rng), position(rng), position(rng)), glm::vec3(size(rng), size(rng), size(rng)));
+            }
+
+            glm::mat4 view = glm::lookAt(glm::vec3(0.0f, -20.0f, 5.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+            glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+            proj[1][1] *= -1;
+            Frustum frustum = Frustum::fromViewProjection(proj * view);
+
+            std::vector<uint32_t> reference(bounds.getPaddedCount());
+            std::vector<uint32_t> visible;
+
+            auto start = Clock::now();
+            uint32_t referenceCount = 0;
+            for (uint32_t i = 0; i < iterations; i++) {
+                referenceCount = FrustumCuller::cullScalar(frustum, bounds, reference.data());
+            }
+            double scalarMs = std::chrono::duration<double, std::chrono::milliseconds::period>(Clock::now() - start).count() / iterations;
+
+            start = Clock::now();
+            for (uint32_t i = 0; i < iterations; i++) {
+                FrustumCuller::cull(frustum, bounds, visible);
+            }
+            double simdMs = std::chrono::duration<double, std::chrono::milliseconds::period>(Clock::now() - start).count() / iterations;
+
+            reference.resize(referenceCount);
+            std::cout << "frustum culling, " << objectCount << " objects: " << visible.size() << " visible" << std::endl;
+            std::cout << "  scalar " << scalarMs << " ms, simd " << simdMs << " ms ("
+                << (simdMs > 0.0 ? scalarMs / simdMs : 0.0) << "x)" << (visible == reference ? "" : ", MISMATCH") << std::endl;
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "Vertex.h"
+
+namespace LightVulkan {
+    // Axis aligned box as center and half extents plus a bounding sphere around the same center
+    struct Bounds {
+        glm::vec3 center = glm::vec3(0.0f);
+        glm::vec3 extent = glm::vec3(0.0f);
+        float radius = 0.0f;
+
+        static Bounds fromVertices(const Vertex* vertices, size_t count) {
+            Bounds bounds;
+            if (count == 0) {
+                return bounds;
+            }
+
+            glm::vec3 minPos = vertices[0].pos;
+            glm::vec3 maxPos = vertices[0].pos;
+            for (size_t i = 1; i < count; i++) {
+                minPos = glm::min(minPos, vertices[i].pos);
+                maxPos = glm::max(maxPos, vertices[i].pos);
+            }
+            bounds.center = (minPos + maxPos) * 0.5f;
+            bounds.extent = (maxPos - minPos) * 0.5f;
+
+            // Tighter than the half diagonal for anything that does not fill the corners of its box
+            float radiusSquared = 0.0f;
+            for (size_t i = 0; i < count; i++) {
+                glm::vec3 offset = vertices[i].pos - bounds.center;
+                radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+            }
+            bounds.radius = std::sqrt(radiusSquared);
+            return bounds;
+        }
+        glm::vec3 getMin() const {
+            return center - extent;
+        }
+        glm::vec3 getMax() const {
+            return center + extent;
+        }
+        // Box of the transformed box, the sphere radius scales with the largest axis scale
+        Bounds transformed(const glm::mat4& transform) const {
+            Bounds result;
+            result.center = glm::vec3(transform * glm::vec4(center, 1.0f));
+
+            glm::vec3 axisX = glm::vec3(transform[0]);
+            glm::vec3 axisY = glm::vec3(transform[1]);
+            glm::vec3 axisZ = glm::vec3(transform[2]);
+            for (int axis = 0; axis < 3; axis++) {
+                result.extent[axis] = std::abs(axisX[axis]) * extent.x + std::abs(axisY[axis]) * extent.y + std::abs(axisZ[axis]) * extent.z;
+            }
+
+            float maxScale = std::max(glm::length(axisX), std::max(glm::length(axisY), glm::length(axisZ)));
+            result.radius = radius * maxScale;
+            return result;
+        }
+    };
+}
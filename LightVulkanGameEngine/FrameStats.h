@@ -0,0 +1,263 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace LightVulkan {
+    // Log-linear histogram after HdrHistogram. Values below LINEAR_BUCKETS are counted exactly, above that every
+    // power of two range is split into LINEAR_BUCKETS / 2 buckets, so any value is reported within 1/64 of itself
+    // at a fixed size, no matter how long the run or how far the outliers go.
+    class LatencyHistogram {
+    public:
+        static const uint32_t LINEAR_BUCKETS = 128;
+
+        void record(uint64_t value) {
+            uint32_t bucket = getBucket(value);
+            if (bucket >= counts.size()) {
+                counts.resize(bucket + 1, 0);
+            }
+            counts[bucket]++;
+            count++;
+            sum += value;
+            minValue = count == 1 ? value : std::min(minValue, value);
+            maxValue = std::max(maxValue, value);
+        }
+        void reset() {
+            counts.clear();
+            count = 0;
+            sum = 0;
+            minValue = 0;
+            maxValue = 0;
+        }
+        uint64_t getCount() const {
+            return count;
+        }
+        double getMean() const {
+            return count > 0 ? static_cast<double>(sum) / count : 0.0;
+        }
+        uint64_t getMin() const {
+            return minValue;
+        }
+        uint64_t getMax() const {
+            return maxValue;
+        }
+        // Smallest value at least percentile % of the samples are at or below, up to the bucket's precision
+        uint64_t getPercentile(double percentile) const {
+            if (count == 0) {
+                return 0;
+            }
+            uint64_t rank = static_cast<uint64_t>(std::ceil(std::min(std::max(percentile, 0.0), 100.0) / 100.0 * count));
+            rank = std::max<uint64_t>(rank, 1);
+
+            uint64_t seen = 0;
+            for (uint32_t bucket = 0; bucket < counts.size(); bucket++) {
+                seen += counts[bucket];
+                if (seen >= rank) {
+                    return std::min(getBucketEnd(bucket), maxValue);
+                }
+            }
+            return maxValue;
+        }
+        // Samples above value, exact only for values on a bucket boundary
+        uint64_t getCountAbove(uint64_t value) const {
+            uint64_t above = 0;
+            for (uint32_t bucket = getBucket(value) + 1; bucket < counts.size(); bucket++) {
+                above += counts[bucket];
+            }
+            return above;
+        }
+
+    private:
+        static const uint32_t HALF_BUCKETS = LINEAR_BUCKETS / 2;
+        static const uint32_t LINEAR_BITS = 7;
+
+        static uint32_t getHighestBit(uint64_t value) {
+            uint32_t bit = 0;
+            while (value >>= 1) {
+                bit++;
+            }
+            return bit;
+        }
+        static uint32_t getBucket(uint64_t value) {
+            if (value < LINEAR_BUCKETS) {
+                return static_cast<uint32_t>(value);
+            }
+            uint32_t shift = getHighestBit(value) - (LINEAR_BITS - 1);
+            uint32_t subBucket = static_cast<uint32_t>(value >> shift) - HALF_BUCKETS;
+            return LINEAR_BUCKETS + (shift - 1) * HALF_BUCKETS + subBucket;
+        }
+        // Largest value counted in bucket
+        static uint64_t getBucketEnd(uint32_t bucket) {
+            if (bucket < LINEAR_BUCKETS) {
+                return bucket;
+            }
+            uint32_t shift = (bucket - LINEAR_BUCKETS) / HALF_BUCKETS + 1;
+            uint64_t subBucket = (bucket - LINEAR_BUCKETS) % HALF_BUCKETS + HALF_BUCKETS;
+            return ((subBucket + 1) << shift) - 1;
+        }
+
+    private:
+        std::vector<uint64_t> counts;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t minValue = 0;
+        uint64_t maxValue = 0;
+    };
+
+    enum class FrameStat {
+        FrameTime,
+        FenceWait,
+        Acquire,
+        Present,
+        GpuTime,
+        Count
+    };
+
+    // Latency distributions of the main loop, recorded in microseconds. FrameTime is the CPU time from one
+    // drawFrame to the next, GpuTime the span of a frame's GPU timestamps when they are recorded, the others are
+    // the time blocked in the matching Vulkan call.
+    class FrameStats {
+    public:
+        // At the start of every frame
+        void beginFrame() {
+            auto now = std::chrono::steady_clock::now();
+            if (frameStarted) {
+                record(FrameStat::FrameTime, now - lastFrameStart);
+            }
+            lastFrameStart = now;
+            frameStarted = true;
+        }
+        void record(FrameStat stat, std::chrono::nanoseconds duration) {
+            histograms[static_cast<size_t>(stat)].record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+        }
+        void reset() {
+            for (auto& histogram : histograms) {
+                histogram.reset();
+            }
+            frameStarted = false;
+        }
+        const LatencyHistogram& get(FrameStat stat) const {
+            return histograms[static_cast<size_t>(stat)];
+        }
+
+        // Frames slower than twice the median are counted as hitches
+        void report(std::ostream& out) const {
+            const LatencyHistogram& frames = get(FrameStat::FrameTime);
+            if (frames.getCount() == 0) {
+                return;
+            }
+            out << "Frame stats over " << frames.getCount() << " frames, ms (mean / p50 / p95 / p99 / max):" << std::endl;
+            for (size_t i = 0; i < histograms.size(); i++) {
+                const LatencyHistogram& histogram = histograms[i];
+                if (histogram.getCount() == 0) {
+                    continue;
+                }
+                out << "  " << std::left << std::setw(12) << getName(static_cast<FrameStat>(i)) << std::right << std::fixed << std::setprecision(3)
+                    << std::setw(9) << histogram.getMean() / 1000.0;
+                for (double percentile : REPORTED_PERCENTILES) {
+                    out << " / " << std::setw(8) << histogram.getPercentile(percentile) / 1000.0;
+                }
+                out << " / " << std::setw(8) << histogram.getMax() / 1000.0 << std::defaultfloat << std::endl;
+            }
+            out << "  " << getHitchCount() << " hitches over 2x the median frame time" << std::endl;
+        }
+        // One row per stat
+        bool writeCsv(const std::string& path) const {
+            std::ofstream file(path);
+            if (!file) {
+                return false;
+            }
+            file << "stat,count,mean_ms,min_ms,p50_ms,p95_ms,p99_ms,p999_ms,max_ms" << std::endl;
+            file << std::fixed << std::setprecision(3);
+            for (size_t i = 0; i < histograms.size(); i++) {
+                const LatencyHistogram& histogram = histograms[i];
+                file << getName(static_cast<FrameStat>(i)) << "," << histogram.getCount() << "," << histogram.getMean() / 1000.0 << ","
+                    << histogram.getMin() / 1000.0 << "," << histogram.getPercentile(50.0) / 1000.0 << "," << histogram.getPercentile(95.0) / 1000.0 << ","
+                    << histogram.getPercentile(99.0) / 1000.0 << "," << histogram.getPercentile(99.9) / 1000.0 << "," << histogram.getMax() / 1000.0 << std::endl;
+            }
+            return static_cast<bool>(file);
+        }
+        // Summary per stat plus the percentile curve, enough to plot the distribution without the raw samples
+        bool writeJson(const std::string& path) const {
+            std::ofstream file(path);
+            if (!file) {
+                return false;
+            }
+            writeJson(file);
+            file << std::endl;
+            return static_cast<bool>(file);
+        }
+        void writeJson(std::ostream& out) const {
+            std::ios::fmtflags flags = out.flags();
+            std::streamsize precision = out.precision(3);
+            out << "{\"hitches\": " << getHitchCount() << ", \"stats\": {";
+            for (size_t i = 0; i < histograms.size(); i++) {
+                const LatencyHistogram& histogram = histograms[i];
+                out << (i > 0 ? "," : "") << "\n    \"" << getName(static_cast<FrameStat>(i)) << "\": {" << std::fixed
+                    << "\"count\": " << histogram.getCount() << ", \"meanMs\": " << histogram.getMean() / 1000.0
+                    << ", \"minMs\": " << histogram.getMin() / 1000.0 << ", \"maxMs\": " << histogram.getMax() / 1000.0 << ", \"percentilesMs\": {";
+                for (size_t p = 0; p < CURVE_PERCENTILES.size(); p++) {
+                    out << (p > 0 ? ", " : "") << "\"" << std::defaultfloat << CURVE_PERCENTILES[p] << std::fixed << "\": "
+                        << histogram.getPercentile(CURVE_PERCENTILES[p]) / 1000.0;
+                }
+                out << "}}";
+            }
+            out << "\n  }}";
+            out.flags(flags);
+            out.precision(precision);
+        }
+        // CSV when path ends in .csv, JSON otherwise
+        bool write(const std::string& path) const {
+            bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+            return csv ? writeCsv(path) : writeJson(path);
+        }
+
+    private:
+        static constexpr std::array<double, 3> REPORTED_PERCENTILES = { 50.0, 95.0, 99.0 };
+        static constexpr std::array<double, 8> CURVE_PERCENTILES = { 50.0, 75.0, 90.0, 95.0, 99.0, 99.9, 99.99, 100.0 };
+
+        static const char* getName(FrameStat stat) {
+            switch (stat) {
+            case FrameStat::FrameTime: return "frameTime";
+            case FrameStat::FenceWait: return "fenceWait";
+            case FrameStat::Acquire: return "acquire";
+            case FrameStat::Present: return "present";
+            case FrameStat::GpuTime: return "gpuTime";
+            default: return "unknown";
+            }
+        }
+        uint64_t getHitchCount() const {
+            const LatencyHistogram& frames = get(FrameStat::FrameTime);
+            return frames.getCountAbove(frames.getPercentile(50.0) * 2);
+        }
+
+    private:
+        std::array<LatencyHistogram, static_cast<size_t>(FrameStat::Count)> histograms;
+        std::chrono::steady_clock::time_point lastFrameStart;
+        bool frameStarted = false;
+    };
+
+    // Records the time until it goes out of scope into one stat
+    class FrameStatTimer {
+    public:
+        FrameStatTimer(FrameStats& stats, FrameStat stat) : stats(stats), stat(stat), start(std::chrono::steady_clock::now()) {}
+        ~FrameStatTimer() {
+            stats.record(stat, std::chrono::steady_clock::now() - start);
+        }
+        FrameStatTimer(const FrameStatTimer&) = delete;
+        FrameStatTimer& operator=(const FrameStatTimer&) = delete;
+
+    private:
+        FrameStats& stats;
+        FrameStat stat;
+        std::chrono::steady_clock::time_point start;
+    };
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LIGHTVULKAN_CULL_SSE
+#endif
+
+#include "Bounds.h"
+
+namespace LightVulkan {
+    // Six planes as (normal, distance) facing inwards, a point p is inside when dot(normal, p) + distance >= 0
+    struct Frustum {
+        enum Plane { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+        std::array<glm::vec4, PlaneCount> planes;
+
+        // Gribb/Hartmann extraction from the rows of proj * view. Clip space depth is [0, 1] (GLM_FORCE_DEPTH_ZERO_TO_ONE),
+        // so the near plane is the third row alone. The flipped Y of the Vulkan projection only swaps bottom and top.
+        static Frustum fromViewProjection(const glm::mat4& viewProj) {
+            glm::vec4 rows[4];
+            for (int row = 0; row < 4; row++) {
+                rows[row] = glm::vec4(viewProj[0][row], viewProj[1][row], viewProj[2][row], viewProj[3][row]);
+            }
+
+            Frustum frustum;
+            frustum.planes[Left] = rows[3] + rows[0];
+            frustum.planes[Right] = rows[3] - rows[0];
+            frustum.planes[Bottom] = rows[3] + rows[1];
+            frustum.planes[Top] = rows[3] - rows[1];
+            frustum.planes[Near] = rows[2];
+            frustum.planes[Far] = rows[3] - rows[2];
+
+            for (auto& plane : frustum.planes) {
+                float length = glm::length(glm::vec3(plane));
+                if (length > 0.0f) {
+                    plane = plane / length;
+                }
+            }
+            return frustum;
+        }
+        // Conservative, boxes crossing two planes just outside a corner are kept
+        bool intersects(const glm::vec3& center, const glm::vec3& extent) const {
+            for (const auto& plane : planes) {
+                float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+                float reach = std::abs(plane.x) * extent.x + std::abs(plane.y) * extent.y + std::abs(plane.z) * extent.z;
+                if (distance + reach < 0.0f) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    // World space boxes split into one array per component so a SIMD lane tests one object
+    class CullingBounds {
+    public:
+        static const uint32_t LANE_COUNT = 8;
+
+        void resize(uint32_t countIn) {
+            count = countIn;
+            size_t padded = getPaddedCount();
+            centerX.resize(padded);
+            centerY.resize(padded);
+            centerZ.resize(padded);
+            extentX.resize(padded);
+            extentY.resize(padded);
+            extentZ.resize(padded);
+        }
+        void set(uint32_t index, const glm::vec3& center, const glm::vec3& extent) {
+            centerX[index] = center.x;
+            centerY[index] = center.y;
+            centerZ[index] = center.z;
+            extentX[index] = extent.x;
+            extentY[index] = extent.y;
+            extentZ[index] = extent.z;
+        }
+        void set(uint32_t index, const Bounds& bounds) {
+            set(index, bounds.center, bounds.extent);
+        }
+        uint32_t size() const {
+            return count;
+        }
+        // Arrays are sized to a whole number of lanes, the tail is masked off rather than read as objects
+        size_t getPaddedCount() const {
+            return (static_cast<size_t>(count) + LANE_COUNT - 1) / LANE_COUNT * LANE_COUNT;
+        }
+
+    private:
+        friend struct FrustumCuller;
+
+        uint32_t count = 0;
+        std::vector<float> centerX, centerY, centerZ;
+        std::vector<float> extentX, extentY, extentZ;
+    };
+
+    struct FrustumCuller {
+        // Writes the indices of the boxes touching the frustum to visible in ascending order, returns how many
+        static uint32_t cull(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visible) {
+            // Lanes are stored unconditionally and only the count advances, so the tail needs room for a full block
+            visible.resize(bounds.getPaddedCount());
+#if defined(__AVX__)
+            uint32_t visibleCount = cullAVX(frustum, bounds, visible.data());
+#elif defined(LIGHTVULKAN_CULL_SSE)
+            uint32_t visibleCount = cullSSE(frustum, bounds, visible.data());
+#else
+            uint32_t visibleCount = cullScalar(frustum, bounds, visible.data());
+#endif
+            visible.resize(visibleCount);
+            return visibleCount;
+        }
+        // Reference path, also what the SIMD variants are checked against
+        static uint32_t cullScalar(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visible) {
+            uint32_t visibleCount = 0;
+            for (uint32_t i = 0; i < bounds.count; i++) {
+                glm::vec3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+                glm::vec3 extent(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]);
+                visible[visibleCount] = i;
+                visibleCount += frustum.intersects(center, extent) ? 1 : 0;
+            }
+            return visibleCount;
+        }
+#if defined(__AVX__)
+        static uint32_t cullAVX(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visible) {
+            __m256 planeX[Frustum::PlaneCount], planeY[Frustum::PlaneCount], planeZ[Frustum::PlaneCount], planeW[Frustum::PlaneCount];
+            __m256 absX[Frustum::PlaneCount], absY[Frustum::PlaneCount], absZ[Frustum::PlaneCount];
+            for (int p = 0; p < Frustum::PlaneCount; p++) {
+                planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+                planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+                planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+                planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+                absX[p] = _mm256_set1_ps(std::abs(frustum.planes[p].x));
+                absY[p] = _mm256_set1_ps(std::abs(frustum.planes[p].y));
+                absZ[p] = _mm256_set1_ps(std::abs(frustum.planes[p].z));
+            }
+            __m256 zero = _mm256_setzero_ps();
+
+            uint32_t visibleCount = 0;
+            for (uint32_t base = 0; base < bounds.count; base += 8) {
+                __m256 cx = _mm256_loadu_ps(&bounds.centerX[base]);
+                __m256 cy = _mm256_loadu_ps(&bounds.centerY[base]);
+                __m256 cz = _mm256_loadu_ps(&bounds.centerZ[base]);
+                __m256 ex = _mm256_loadu_ps(&bounds.extentX[base]);
+                __m256 ey = _mm256_loadu_ps(&bounds.extentY[base]);
+                __m256 ez = _mm256_loadu_ps(&bounds.extentZ[base]);
+
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (int p = 0; p < Frustum::PlaneCount; p++) {
+                    __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)),
+                        _mm256_mul_ps(planeZ[p], cz)), planeW[p]);
+                    __m256 reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey)), _mm256_mul_ps(absZ[p], ez));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_GE_OQ));
+                }
+
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside)) & tailMask(bounds.count - base);
+                for (uint32_t lane = 0; lane < 8; lane++) {
+                    visible[visibleCount] = base + lane;
+                    visibleCount += (mask >> lane) & 1;
+                }
+            }
+            return visibleCount;
+        }
+#endif
+#if defined(__AVX__) || defined(LIGHTVULKAN_CULL_SSE)
+        static uint32_t cullSSE(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visible) {
+            __m128 planeX[Frustum::PlaneCount], planeY[Frustum::PlaneCount], planeZ[Frustum::PlaneCount], planeW[Frustum::PlaneCount];
+            __m128 absX[Frustum::PlaneCount], absY[Frustum::PlaneCount], absZ[Frustum::PlaneCount];
+            for (int p = 0; p < Frustum::PlaneCount; p++) {
+                planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+                planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+                planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+                planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+                absX[p] = _mm_set1_ps(std::abs(frustum.planes[p].x));
+                absY[p] = _mm_set1_ps(std::abs(frustum.planes[p].y));
+                absZ[p] = _mm_set1_ps(std::abs(frustum.planes[p].z));
+            }
+            __m128 zero = _mm_setzero_ps();
+
+            uint32_t visibleCount = 0;
+            for (uint32_t base = 0; base < bounds.count; base += 4) {
+                __m128 cx = _mm_loadu_ps(&bounds.centerX[base]);
+                __m128 cy = _mm_loadu_ps(&bounds.centerY[base]);
+                __m128 cz = _mm_loadu_ps(&bounds.centerZ[base]);
+                __m128 ex = _mm_loadu_ps(&bounds.extentX[base]);
+                __m128 ey = _mm_loadu_ps(&bounds.extentY[base]);
+                __m128 ez = _mm_loadu_ps(&bounds.extentZ[base]);
+
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (int p = 0; p < Frustum::PlaneCount; p++) {
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+                        _mm_mul_ps(planeZ[p], cz)), planeW[p]);
+                    __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), zero));
+                }
+
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside)) & tailMask(bounds.count - base);
+                for (uint32_t lane = 0; lane < 4; lane++) {
+                    visible[visibleCount] = base + lane;
+                    visibleCount += (mask >> lane) & 1;
+                }
+            }
+            return visibleCount;
+        }
+#endif
+
+    private:
+        static uint32_t tailMask(uint32_t remaining) {
+            return remaining >= 32 ? ~0u : (1u << remaining) - 1;
+        }
+    };
+}
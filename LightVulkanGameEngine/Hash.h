@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace LightVulkan {
+    const uint64_t HASH_SEED = 14695981039346656037ull;
+
+    // 64-bit FNV-1a taken a word at a time so hashing large buffers stays cheap.
+    // Chaining through seed matches a single pass as long as every earlier range is a whole number of words.
+    inline uint64_t hashBytes(const void* bytes, size_t size, uint64_t seed = HASH_SEED) {
+        const uint8_t* data = static_cast<const uint8_t*>(bytes);
+        uint64_t hash = seed;
+        size_t words = size / sizeof(uint64_t);
+        for (size_t i = 0; i < words; i++) {
+            uint64_t word;
+            memcpy(&word, data + i * sizeof(uint64_t), sizeof(uint64_t));
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        for (size_t i = words * sizeof(uint64_t); i < size; i++) {
+            hash = (hash ^ data[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+}
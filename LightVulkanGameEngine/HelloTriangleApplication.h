@@ -62,16 +62,17 @@ private:
 
         createVertexBuffer();
         createIndexBuffer();
+        uploadManager.wait(device, uploadManager.submit(device));
         createCommandBuffers();
     }
     void cleanup() override {
-        vertexBuffer.destroy(device.getLogicalDevice());
-        indexBuffer.destroy(device.getLogicalDevice());
+        vertexBuffer.destroy(device);
+        indexBuffer.destroy(device);
         VulkanApplication::cleanup();
     }
     void createGraphicsPipeline() override {
-        VulkanShaderModule vertShaderModule(device, "shaders/helloTriangleVert.spv");
-        VulkanShaderModule fragShaderModule(device, "shaders/helloTriangleFrag.spv");
+        VulkanShaderModule vertShaderModule(device, shaderManager.getCode(shaderManager.load("shaders/helloTriangleShader.vert")));
+        VulkanShaderModule fragShaderModule(device, shaderManager.getCode(shaderManager.load("shaders/helloTriangleShader.frag")));
 
         VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
         vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -103,24 +104,17 @@ private:
         inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
         inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float)swapChain.getExtent().width;
-        viewport.height = (float)swapChain.getExtent().height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        VkRect2D scissor{};
-        scissor.offset = { 0, 0 };
-        scissor.extent = swapChain.getExtent();
-
+        // Set at record time so the pipeline does not depend on the swap chain extent
         VkPipelineViewportStateCreateInfo viewportState{};
         viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewportState.viewportCount = 1;
-        viewportState.pViewports = &viewport;
         viewportState.scissorCount = 1;
-        viewportState.pScissors = &scissor;
+
+        std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+        dynamicState.pDynamicStates = dynamicStates.data();
 
         VkPipelineRasterizationStateCreateInfo rasterizer{};
         rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -178,18 +172,30 @@ private:
         pipelineInfo.pMultisampleState = &multisampling;
         pipelineInfo.pDepthStencilState = &depthStencil;
         pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.pDynamicState = &dynamicState;
         pipelineInfo.layout = pipelineLayout;
         pipelineInfo.renderPass = renderPass;
         pipelineInfo.subpass = 0;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-        if (vkCreateGraphicsPipelines(device.getLogicalDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+        if (device.getPipelineCache().createGraphicsPipeline(device.getLogicalDevice(), pipelineInfo, graphicsPipeline) != VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics pipeline!");
         }
 
         vkDestroyShaderModule(device.getLogicalDevice(), fragShaderModule.get(), nullptr);
         vkDestroyShaderModule(device.getLogicalDevice(), vertShaderModule.get(), nullptr);
     }
+    // The prerecorded buffers reference the old framebuffers and may still be executing
+    void onSwapChainRecreated() override {
+        VkDevice logicalDevice = device.getLogicalDevice();
+        VkCommandPool commandPool = device.getCommandPool();
+        std::vector<VkCommandBuffer> oldCommandBuffers = commandBuffers;
+        deletionQueue.push(submittedFrameSerial, [logicalDevice, commandPool, oldCommandBuffers]() {
+            vkFreeCommandBuffers(logicalDevice, commandPool, static_cast<uint32_t>(oldCommandBuffers.size()), oldCommandBuffers.data());
+        });
+
+        createCommandBuffers();
+    }
     void createCommandBuffers() override {
         commandBuffers.resize(swapChain.getFramebuffers().size());
 
@@ -228,6 +234,7 @@ private:
             vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
             vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+            setViewportAndScissor(commandBuffers[i]);
 
             VkBuffer vertexBuffers[] = { vertexBuffer.getBuffer() };
             VkDeviceSize offsets[] = { 0 };
@@ -248,44 +255,21 @@ private:
     void createVertexBuffer() {
         VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
 
-        VulkanBuffer stagingBuffer;
-        stagingBuffer.create(device, bufferSize,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        void* data;
-        vkMapMemory(device.getLogicalDevice(), stagingBuffer.getMemory(), 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), (size_t)bufferSize);
-        vkUnmapMemory(device.getLogicalDevice(), stagingBuffer.getMemory());
-
         vertexBuffer.create(device, bufferSize,
             VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-        VulkanBuffer::copyBuffer(device, stagingBuffer, vertexBuffer, bufferSize);
-
-        vkDestroyBuffer(device.getLogicalDevice(), stagingBuffer.getBuffer(), nullptr);
-        vkFreeMemory(device.getLogicalDevice(), stagingBuffer.getMemory(), nullptr);
+        uploadManager.uploadBuffer(device, vertexBuffer, vertices.data(), bufferSize,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
     }
     void createIndexBuffer() {
         VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
 
-        VulkanBuffer stagingBuffer;
-        stagingBuffer.create(device, bufferSize,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        void* data;
-        vkMapMemory(device.getLogicalDevice(), stagingBuffer.getMemory(), 0, bufferSize, 0, &data);
-        memcpy(data, indices.data(), (size_t)bufferSize);
-        vkUnmapMemory(device.getLogicalDevice(), stagingBuffer.getMemory());
-
         indexBuffer.create(device, bufferSize,
             VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-        VulkanBuffer::copyBuffer(device, stagingBuffer, indexBuffer, bufferSize);
-
-        stagingBuffer.destroy(device.getLogicalDevice());
+        uploadManager.uploadBuffer(device, indexBuffer, indices.data(), bufferSize,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
     }
 };
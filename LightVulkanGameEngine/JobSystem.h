@@ -0,0 +1,302 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Profiler.h"
+
+namespace LightVulkan {
+    class JobCounter;
+
+    struct JobTask {
+        std::function<void()> job;
+        JobCounter* signal = nullptr;
+    };
+
+    // Incremented for every job that signals it and decremented as they finish. Jobs queued with
+    // a counter as dependency are parked on it and released when it drops to zero. The first exception
+    // thrown by one of its jobs is kept here and rethrown by JobSystem::wait on this counter.
+    class JobCounter {
+    public:
+        uint32_t get() const {
+            return value.load(std::memory_order_acquire);
+        }
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<uint32_t> value{ 0 };
+        // Guards the decrement to zero as well, so the counter is not touched once a waiter has locked it
+        std::mutex mutex;
+        std::vector<JobTask> continuations;
+        std::exception_ptr failure;
+    };
+
+    // Work stealing scheduler. Every thread owns a deque, the owner pushes and pops at the back while idle
+    // threads steal the oldest job from the front of another deque. The thread that created the system is
+    // thread 0 and only runs jobs while it waits, everything that has to stay on it (GLFW) goes through
+    // runOnMainThread and is executed by pumpMainThread.
+    class JobSystem {
+    public:
+        typedef std::function<void()> Job;
+
+        // threadCount includes the main thread, 0 uses every hardware thread
+        void create(uint32_t threadCount = 0) {
+            if (threadCount == 0) {
+                threadCount = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            queues.clear();
+            for (uint32_t i = 0; i < threadCount; i++) {
+                queues.push_back(std::make_unique<WorkerQueue>());
+            }
+            mainThread = std::this_thread::get_id();
+            threadIndex() = 0;
+            stopping = false;
+
+            for (uint32_t i = 1; i < threadCount; i++) {
+                workers.emplace_back(&JobSystem::workerLoop, this, i);
+            }
+        }
+        void destroy() {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                stopping = true;
+            }
+            sleepCondition.notify_all();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            workers.clear();
+            queues.clear();
+        }
+        void run(Job job, JobCounter* signal = nullptr, JobCounter* dependency = nullptr) {
+            if (signal) {
+                signal->value.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            JobTask task{ std::move(job), signal };
+            if (dependency) {
+                std::lock_guard<std::mutex> lock(dependency->mutex);
+                if (dependency->value.load(std::memory_order_acquire) > 0) {
+                    dependency->continuations.push_back(std::move(task));
+                    return;
+                }
+            }
+            push(std::move(task));
+        }
+        void runOnMainThread(Job job, JobCounter* signal = nullptr) {
+            if (signal) {
+                signal->value.fetch_add(1, std::memory_order_relaxed);
+            }
+            std::lock_guard<std::mutex> lock(mainMutex);
+            mainTasks.push_back({ std::move(job), signal });
+        }
+        // Main thread only
+        void pumpMainThread() {
+            std::deque<JobTask> tasks;
+            {
+                std::lock_guard<std::mutex> lock(mainMutex);
+                tasks.swap(mainTasks);
+            }
+            for (auto& task : tasks) {
+                execute(task);
+            }
+        }
+        // Runs queued jobs on the calling thread until counter reaches zero, then rethrows the first exception one of
+        // its jobs threw
+        void wait(JobCounter& counter) {
+            uint32_t idleSpins = 0;
+            while (counter.get() > 0) {
+                if (isMainThread()) {
+                    pumpMainThread();
+                }
+
+                JobTask task;
+                if (pop(task)) {
+                    execute(task);
+                    idleSpins = 0;
+                }
+                else if (++idleSpins < 64) {
+                    std::this_thread::yield();
+                }
+                else {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+            }
+
+            // The last job decrements under the mutex, once it is ours that job is done with the counter
+            std::exception_ptr error;
+            {
+                std::lock_guard<std::mutex> lock(counter.mutex);
+                error = counter.failure;
+                counter.failure = nullptr;
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+        // Calls fn(begin, end) over [0, count) in batches of batchSize and waits for all of them
+        template<typename Fn>
+        void parallelFor(uint32_t count, uint32_t batchSize, Fn&& fn) {
+            if (count == 0) {
+                return;
+            }
+            batchSize = std::max(1u, batchSize);
+            if (count <= batchSize) {
+                fn(0u, count);
+                return;
+            }
+
+            JobCounter counter;
+            for (uint32_t begin = 0; begin < count; begin += batchSize) {
+                uint32_t end = std::min(count, begin + batchSize);
+                run([&fn, begin, end]() { fn(begin, end); }, &counter);
+            }
+            wait(counter);
+        }
+        uint32_t getThreadCount() {
+            return static_cast<uint32_t>(queues.size());
+        }
+        // 0 on the main thread and on threads that do not belong to a job system
+        static uint32_t getThreadIndex() {
+            return threadIndex();
+        }
+        bool isMainThread() {
+            return std::this_thread::get_id() == mainThread;
+        }
+
+    private:
+        struct WorkerQueue {
+            std::mutex mutex;
+            std::deque<JobTask> tasks;
+        };
+
+        static uint32_t& threadIndex() {
+            thread_local uint32_t index = 0;
+            return index;
+        }
+        void push(JobTask task) {
+            uint32_t index = threadIndex() < queues.size() ? threadIndex() : 0;
+            {
+                std::lock_guard<std::mutex> lock(queues[index]->mutex);
+                queues[index]->tasks.push_back(std::move(task));
+            }
+            queuedTasks.fetch_add(1, std::memory_order_release);
+            sleepCondition.notify_one();
+        }
+        bool pop(JobTask& task) {
+            uint32_t self = threadIndex() < queues.size() ? threadIndex() : 0;
+            {
+                WorkerQueue& queue = *queues[self];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.tasks.empty()) {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                    queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+
+            uint32_t queueCount = static_cast<uint32_t>(queues.size());
+            for (uint32_t offset = 1; offset < queueCount; offset++) {
+                WorkerQueue& victim = *queues[(self + offset) % queueCount];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty()) {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            return false;
+        }
+        // A job without a counter has nobody to rethrow to, its exception is reported and dropped
+        void execute(JobTask& task) {
+            std::exception_ptr error;
+            try {
+                ProfileScope scope("Job");
+                task.job();
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+
+            JobCounter* signal = task.signal;
+            if (!signal) {
+                if (error) {
+                    reportDroppedFailure(error);
+                }
+                return;
+            }
+            std::vector<JobTask> released;
+            {
+                std::lock_guard<std::mutex> lock(signal->mutex);
+                if (error && !signal->failure) {
+                    signal->failure = error;
+                }
+                if (signal->value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    released.swap(signal->continuations);
+                }
+            }
+            for (auto& continuation : released) {
+                push(std::move(continuation));
+            }
+        }
+        static void reportDroppedFailure(std::exception_ptr error) {
+            try {
+                std::rethrow_exception(error);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "job without a counter threw: " << e.what() << std::endl;
+            }
+            catch (...) {
+                std::cerr << "job without a counter threw" << std::endl;
+            }
+        }
+        void workerLoop(uint32_t index) {
+            threadIndex() = index;
+            Profiler::get().setThreadName("Worker " + std::to_string(index));
+            for (;;) {
+                JobTask task;
+                if (pop(task)) {
+                    execute(task);
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                sleepCondition.wait_for(lock, std::chrono::milliseconds(1), [this]() {
+                    return stopping || queuedTasks.load(std::memory_order_acquire) > 0;
+                });
+                if (stopping) {
+                    return;
+                }
+            }
+        }
+
+    private:
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+        std::vector<std::thread> workers;
+        std::thread::id mainThread;
+        std::atomic<uint32_t> queuedTasks{ 0 };
+
+        std::mutex sleepMutex;
+        std::condition_variable sleepCondition;
+        bool stopping = false;
+
+        std::mutex mainMutex;
+        std::deque<JobTask> mainTasks;
+    };
+}
@@ -0,0 +1,265 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace LightVulkan {
+    // KTX 2.0 file header, followed by one Ktx2LevelIndex per mip level
+    struct Ktx2Header {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+
+    struct Ktx2LevelIndex {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    // Points into a MappedFile, valid only while the file stays open. Levels are stored smallest first, so
+    // data spans every level contiguously and each level's offset is relative to it.
+    struct Ktx2View {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t blockBytes = 0;
+        const uint8_t* data = nullptr;
+        uint64_t dataSize = 0;
+
+        struct Level {
+            uint64_t offset;
+            uint64_t size;
+            uint32_t width;
+            uint32_t height;
+        };
+        std::vector<Level> levels;
+    };
+
+    // Single layer 2D block compressed textures without supercompression, the subset the texture cooker writes
+    namespace Ktx2 {
+        const uint8_t IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+        // Bytes per 4x4 block, 0 for formats this reader does not handle
+        inline uint32_t getBlockBytes(VkFormat format) {
+            switch (format) {
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+                return 8;
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                return 16;
+            default:
+                return 0;
+            }
+        }
+        inline bool isSrgb(VkFormat format) {
+            switch (format) {
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_B8G8R8A8_SRGB:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                return true;
+            default:
+                return false;
+            }
+        }
+        inline uint64_t getLevelSize(uint32_t width, uint32_t height, uint32_t blockBytes) {
+            return static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+        }
+        inline std::string getCookedPath(const std::string& sourcePath) {
+            return std::filesystem::path(sourcePath).replace_extension(".ktx2").string();
+        }
+        // A cooked texture without its source is still usable, that is how cooked builds ship
+        inline bool isFresh(const std::string& cookedPath, const std::string& sourcePath) {
+            std::error_code ec;
+            auto cookedTime = std::filesystem::last_write_time(cookedPath, ec);
+            if (ec) {
+                return false;
+            }
+            auto sourceTime = std::filesystem::last_write_time(sourcePath, ec);
+            return ec || cookedTime >= sourceTime;
+        }
+        inline bool read(const MappedFile& file, Ktx2View& view) {
+            if (file.getSize() < sizeof(Ktx2Header)) {
+                return false;
+            }
+
+            Ktx2Header header;
+            memcpy(&header, file.getData(), sizeof(header));
+            if (memcmp(header.identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0 || header.supercompressionScheme != 0 ||
+                header.pixelDepth != 0 || header.layerCount > 1 || header.faceCount != 1 ||
+                header.pixelWidth == 0 || header.pixelHeight == 0 || header.levelCount == 0 || header.levelCount > 32) {
+                return false;
+            }
+
+            VkFormat format = static_cast<VkFormat>(header.vkFormat);
+            uint32_t blockBytes = getBlockBytes(format);
+            if (blockBytes == 0) {
+                return false;
+            }
+
+            uint64_t indexEnd = sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * header.levelCount;
+            if (file.getSize() < indexEnd) {
+                return false;
+            }
+
+            std::vector<Ktx2LevelIndex> index(header.levelCount);
+            memcpy(index.data(), file.getData() + sizeof(Ktx2Header), sizeof(Ktx2LevelIndex) * header.levelCount);
+
+            // Smallest level first in the file, so the last index entry starts the data block
+            uint64_t dataBegin = index.back().byteOffset;
+            uint64_t dataEnd = index.front().byteOffset + index.front().byteLength;
+            if (dataBegin < indexEnd || dataEnd < dataBegin || dataEnd > file.getSize()) {
+                return false;
+            }
+
+            view.levels.clear();
+            for (uint32_t level = 0; level < header.levelCount; level++) {
+                uint32_t width = std::max(1u, header.pixelWidth >> level);
+                uint32_t height = std::max(1u, header.pixelHeight >> level);
+                if (index[level].byteLength != getLevelSize(width, height, blockBytes) ||
+                    index[level].byteOffset < dataBegin || index[level].byteOffset + index[level].byteLength > dataEnd) {
+                    return false;
+                }
+                view.levels.push_back({ index[level].byteOffset - dataBegin, index[level].byteLength, width, height });
+            }
+
+            view.format = format;
+            view.width = header.pixelWidth;
+            view.height = header.pixelHeight;
+            view.blockBytes = blockBytes;
+            view.data = file.getData() + dataBegin;
+            view.dataSize = dataEnd - dataBegin;
+            return true;
+        }
+
+        // Basic data format descriptor for BC1 (color only) and BC3 (alpha block then color block)
+        inline std::vector<uint32_t> buildDataFormatDescriptor(VkFormat format) {
+            const uint32_t MODEL_BC1A = 128;
+            const uint32_t MODEL_BC3 = 130;
+            const uint32_t CHANNEL_COLOR = 0;
+            const uint32_t CHANNEL_BC3_ALPHA = 15;
+            const uint32_t QUALIFIER_LINEAR = 0x10;
+
+            bool srgb = isSrgb(format);
+            bool bc3 = getBlockBytes(format) == 16;
+            uint32_t sampleCount = bc3 ? 2 : 1;
+            uint32_t blockSize = 24 + 16 * sampleCount;
+
+            std::vector<uint32_t> dfd;
+            dfd.push_back(4 + blockSize);
+            dfd.push_back(0);
+            dfd.push_back(2 | (blockSize << 16));
+            dfd.push_back((bc3 ? MODEL_BC3 : MODEL_BC1A) | (1u << 8) | ((srgb ? 2u : 1u) << 16));
+            dfd.push_back(3 | (3 << 8));
+            dfd.push_back(getBlockBytes(format));
+            dfd.push_back(0);
+
+            auto addSample = [&dfd](uint32_t bitOffset, uint32_t channelType) {
+                dfd.push_back(bitOffset | (63u << 16) | (channelType << 24));
+                dfd.push_back(0);
+                dfd.push_back(0);
+                dfd.push_back(0xFFFFFFFFu);
+            };
+            if (bc3) {
+                // Alpha is never sRGB encoded
+                addSample(0, CHANNEL_BC3_ALPHA | (srgb ? QUALIFIER_LINEAR : 0));
+                addSample(64, CHANNEL_COLOR);
+            }
+            else {
+                addSample(0, CHANNEL_COLOR);
+            }
+            return dfd;
+        }
+        // levels[0] is the full resolution image. Written to a temporary file and renamed so a crash never leaves a torn file.
+        inline bool write(const std::string& path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels) {
+            uint32_t blockBytes = getBlockBytes(format);
+            uint32_t levelCount = static_cast<uint32_t>(levels.size());
+            std::vector<uint32_t> dfd = buildDataFormatDescriptor(format);
+
+            Ktx2Header header{};
+            memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+            header.vkFormat = static_cast<uint32_t>(format);
+            header.typeSize = 1;
+            header.pixelWidth = width;
+            header.pixelHeight = height;
+            header.faceCount = 1;
+            header.levelCount = levelCount;
+            header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * levelCount);
+            header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+            // Level data is aligned to lcm(block size, 4), which is the block size for every BC format
+            auto alignUp = [blockBytes](uint64_t value) { return (value + blockBytes - 1) / blockBytes * blockBytes; };
+
+            std::vector<Ktx2LevelIndex> index(levelCount);
+            uint64_t offset = alignUp(header.dfdByteOffset + header.dfdByteLength);
+            for (uint32_t level = levelCount; level-- > 0;) {
+                offset = alignUp(offset);
+                index[level].byteOffset = offset;
+                index[level].byteLength = levels[level].size();
+                index[level].uncompressedByteLength = levels[level].size();
+                offset += levels[level].size();
+            }
+
+            std::string tempPath = path + ".tmp";
+            {
+                std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+                if (!file) {
+                    return false;
+                }
+                file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                file.write(reinterpret_cast<const char*>(index.data()), sizeof(Ktx2LevelIndex) * levelCount);
+                file.write(reinterpret_cast<const char*>(dfd.data()), dfd.size() * sizeof(uint32_t));
+
+                uint64_t written = header.dfdByteOffset + header.dfdByteLength;
+                const char padding[16] = {};
+                for (uint32_t level = levelCount; level-- > 0;) {
+                    file.write(padding, static_cast<std::streamsize>(index[level].byteOffset - written));
+                    file.write(reinterpret_cast<const char*>(levels[level].data()), levels[level].size());
+                    written = index[level].byteOffset + levels[level].size();
+                }
+                if (!file) {
+                    return false;
+                }
+            }
+
+            std::error_code ec;
+            std::filesystem::rename(tempPath, path, ec);
+            if (ec) {
+                std::filesystem::remove(tempPath, ec);
+                return false;
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Vertex.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+namespace LightVulkan {
+    // On-disk layout: MeshCacheHeader, vertexCount * Vertex, indexCount * uint32_t
+    struct MeshCacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexStride;
+        uint32_t indexSize;
+        uint32_t flags;
+        uint32_t reserved;
+        uint64_t vertexCount;
+        uint64_t indexCount;
+        uint64_t checksum;
+    };
+
+    // Points into a MappedFile, valid only while the file stays open
+    struct MeshCacheView {
+        const Vertex* vertices = nullptr;
+        uint64_t vertexCount = 0;
+        const uint32_t* indices = nullptr;
+        uint64_t indexCount = 0;
+        uint32_t flags = 0;
+    };
+
+    namespace MeshCache {
+        const uint32_t MAGIC = 0x434D564C; // "LVMC"
+        const uint32_t VERSION = 2;
+
+        // Set when the index and vertex order went through MeshOptimizer
+        const uint32_t FLAG_OPTIMIZED = 1u << 0;
+
+        inline std::string getCachePath(const std::string& sourcePath) {
+            return sourcePath + ".meshcache";
+        }
+        // A cache without its source is still usable, that is how cooked builds ship
+        inline bool isFresh(const std::string& cachePath, const std::string& sourcePath) {
+            std::error_code ec;
+            auto cacheTime = std::filesystem::last_write_time(cachePath, ec);
+            if (ec) {
+                return false;
+            }
+            auto sourceTime = std::filesystem::last_write_time(sourcePath, ec);
+            return ec || cacheTime >= sourceTime;
+        }
+        inline bool read(const MappedFile& file, MeshCacheView& view) {
+            if (file.getSize() < sizeof(MeshCacheHeader)) {
+                return false;
+            }
+
+            MeshCacheHeader header;
+            memcpy(&header, file.getData(), sizeof(header));
+            if (header.magic != MAGIC || header.version != VERSION ||
+                header.vertexStride != sizeof(Vertex) || header.indexSize != sizeof(uint32_t)) {
+                return false;
+            }
+
+            if (header.vertexCount > file.getSize() / sizeof(Vertex) || header.indexCount > file.getSize() / sizeof(uint32_t)) {
+                return false;
+            }
+            uint64_t payloadSize = header.vertexCount * sizeof(Vertex) + header.indexCount * sizeof(uint32_t);
+            if (file.getSize() - sizeof(MeshCacheHeader) != payloadSize) {
+                return false;
+            }
+
+            const uint8_t* payload = file.getData() + sizeof(MeshCacheHeader);
+            if (hashBytes(payload, static_cast<size_t>(payloadSize)) != header.checksum) {
+                return false;
+            }
+
+            view.vertices = reinterpret_cast<const Vertex*>(payload);
+            view.vertexCount = header.vertexCount;
+            view.indices = reinterpret_cast<const uint32_t*>(payload + header.vertexCount * sizeof(Vertex));
+            view.indexCount = header.indexCount;
+            view.flags = header.flags;
+            return true;
+        }
+        // Written to a temporary file and renamed so a crash never leaves a torn cache behind
+        inline bool write(const std::string& cachePath, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t flags = 0) {
+            static_assert(sizeof(Vertex) % sizeof(uint64_t) == 0, "vertex block must end on a checksum word");
+            size_t vertexBytes = vertices.size() * sizeof(Vertex);
+            size_t indexBytes = indices.size() * sizeof(uint32_t);
+
+            MeshCacheHeader header{};
+            header.magic = MAGIC;
+            header.version = VERSION;
+            header.vertexStride = sizeof(Vertex);
+            header.indexSize = sizeof(uint32_t);
+            header.flags = flags;
+            header.vertexCount = vertices.size();
+            header.indexCount = indices.size();
+            header.checksum = hashBytes(indices.data(), indexBytes, hashBytes(vertices.data(), vertexBytes));
+
+            std::string tempPath = cachePath + ".tmp";
+            {
+                std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+                if (!file) {
+                    return false;
+                }
+                file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                file.write(reinterpret_cast<const char*>(vertices.data()), vertexBytes);
+                file.write(reinterpret_cast<const char*>(indices.data()), indexBytes);
+                if (!file) {
+                    return false;
+                }
+            }
+
+            std::error_code ec;
+            std::filesystem::rename(tempPath, cachePath, ec);
+            if (ec) {
+                std::filesystem::remove(tempPath, ec);
+                return false;
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Vertex.h"
+#include "JobSystem.h"
+
+namespace LightVulkan {
+    namespace MeshIngest {
+
+        // Runs fn(0..count-1) as one job per index, the calling thread helps until all are done
+        template<typename Fn>
+        void parallelFor(JobSystem& jobSystem, uint32_t count, Fn&& fn) {
+            jobSystem.parallelFor(count, 1, [&fn](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; i++) {
+                    fn(i);
+                }
+            });
+        }
+
+        // Open addressing with linear probing. Slots keep the low hash bits so most mismatches
+        // are rejected without touching the vertex array; the partition index uses the high bits.
+        class VertexHashTable {
+        public:
+            void reserve(size_t expectedCount) {
+                size_t capacity = 16;
+                while (capacity * 7 / 10 < expectedCount) {
+                    capacity *= 2;
+                }
+                slots.assign(capacity, Slot{});
+                mask = capacity - 1;
+                count = 0;
+            }
+            // Returns the index of the vertex in uniqueVertices, appending it when not present
+            uint32_t findOrInsert(const Vertex& vertex, uint64_t hash, std::vector<Vertex>& uniqueVertices, bool& inserted) {
+                if ((count + 1) * 10 > slots.size() * 7) {
+                    grow();
+                }
+
+                uint32_t tag = static_cast<uint32_t>(hash);
+                size_t slot = tag & mask;
+                while (slots[slot].id != EMPTY) {
+                    if (slots[slot].tag == tag && uniqueVertices[slots[slot].id] == vertex) {
+                        inserted = false;
+                        return slots[slot].id;
+                    }
+                    slot = (slot + 1) & mask;
+                }
+
+                uint32_t id = static_cast<uint32_t>(uniqueVertices.size());
+                uniqueVertices.push_back(vertex);
+                slots[slot] = { id, tag };
+                count++;
+                inserted = true;
+                return id;
+            }
+
+        private:
+            static constexpr uint32_t EMPTY = UINT32_MAX;
+
+            struct Slot {
+                uint32_t id = EMPTY;
+                uint32_t tag = 0;
+            };
+
+            void grow() {
+                std::vector<Slot> old;
+                old.swap(slots);
+                slots.assign(old.size() * 2, Slot{});
+                mask = slots.size() - 1;
+                for (const Slot& entry : old) {
+                    if (entry.id == EMPTY) {
+                        continue;
+                    }
+                    size_t slot = entry.tag & mask;
+                    while (slots[slot].id != EMPTY) {
+                        slot = (slot + 1) & mask;
+                    }
+                    slots[slot] = entry;
+                }
+            }
+
+        private:
+            std::vector<Slot> slots;
+            size_t mask = 0;
+            size_t count = 0;
+        };
+
+        inline Vertex makeVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index) {
+            Vertex vertex{};
+
+            vertex.pos = {
+                attrib.vertices[3 * index.vertex_index + 0],
+                attrib.vertices[3 * index.vertex_index + 1],
+                attrib.vertices[3 * index.vertex_index + 2]
+            };
+
+            vertex.texCoord = {
+                attrib.texcoords[2 * index.texcoord_index + 0],
+                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+            };
+
+            vertex.color = { 1.0f, 1.0f, 1.0f };
+
+            return vertex;
+        }
+
+        // Produces the same vertex order as a serial first-occurrence dedup over all shapes.
+        //  1. corners are split into ranges, each worker hashes its range and buckets corners by hash partition
+        //  2. each partition is deduplicated by one worker, visiting ranges in order
+        //  3. a prefix sum over first occurrences gives every unique vertex its final index
+        //  4. vertices are scattered and indices remapped in parallel
+        inline void buildIndexedMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+            std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, JobSystem& jobSystem) {
+            const uint32_t threadCount = jobSystem.getThreadCount();
+
+            std::vector<tinyobj::index_t> corners;
+            size_t totalCorners = 0;
+            for (const auto& shape : shapes) {
+                totalCorners += shape.mesh.indices.size();
+            }
+            corners.reserve(totalCorners);
+            for (const auto& shape : shapes) {
+                corners.insert(corners.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+            }
+
+            const uint32_t cornerCount = static_cast<uint32_t>(corners.size());
+            const uint32_t minRangeSize = 64 * 1024;
+            uint32_t rangeCount = std::max(1u, std::min(threadCount * 4, cornerCount / minRangeSize));
+            uint32_t partitionBits = 0;
+            while ((1u << partitionBits) < threadCount * 2 && rangeCount > 1) {
+                partitionBits++;
+            }
+            const uint32_t partitionCount = 1u << partitionBits;
+            const uint32_t rangeSize = (cornerCount + rangeCount - 1) / rangeCount;
+
+            std::vector<uint32_t> partitionOf(cornerCount);
+            std::vector<uint32_t> localId(cornerCount);
+            std::vector<uint8_t> isFirst(cornerCount, 0);
+            std::vector<std::vector<std::vector<uint32_t>>> buckets(rangeCount, std::vector<std::vector<uint32_t>>(partitionCount));
+
+            parallelFor(jobSystem, rangeCount, [&](uint32_t range) {
+                uint32_t begin = range * rangeSize;
+                uint32_t end = std::min(cornerCount, begin + rangeSize);
+                for (auto& bucket : buckets[range]) {
+                    bucket.reserve((end - begin) / partitionCount + 16);
+                }
+                for (uint32_t i = begin; i < end; i++) {
+                    uint64_t hash = hashVertex(makeVertex(attrib, corners[i]));
+                    uint32_t partition = partitionBits > 0 ? static_cast<uint32_t>(hash >> (64 - partitionBits)) : 0;
+                    partitionOf[i] = partition;
+                    buckets[range][partition].push_back(i);
+                }
+            });
+
+            std::vector<std::vector<Vertex>> partitionVertices(partitionCount);
+            std::vector<std::vector<uint32_t>> partitionFirstCorner(partitionCount);
+
+            parallelFor(jobSystem, partitionCount, [&](uint32_t partition) {
+                size_t partitionCorners = 0;
+                for (uint32_t range = 0; range < rangeCount; range++) {
+                    partitionCorners += buckets[range][partition].size();
+                }
+
+                VertexHashTable table;
+                table.reserve(partitionCorners / 4);
+                auto& uniqueVertices = partitionVertices[partition];
+                auto& firstCorner = partitionFirstCorner[partition];
+
+                for (uint32_t range = 0; range < rangeCount; range++) {
+                    for (uint32_t corner : buckets[range][partition]) {
+                        Vertex vertex = makeVertex(attrib, corners[corner]);
+                        bool inserted;
+                        localId[corner] = table.findOrInsert(vertex, hashVertex(vertex), uniqueVertices, inserted);
+                        if (inserted) {
+                            firstCorner.push_back(corner);
+                            isFirst[corner] = 1;
+                        }
+                    }
+                    std::vector<uint32_t>().swap(buckets[range][partition]);
+                }
+            });
+
+            // Exclusive prefix sum over first occurrences, per range then across ranges
+            std::vector<uint32_t> rangeUniqueCount(rangeCount, 0);
+            parallelFor(jobSystem, rangeCount, [&](uint32_t range) {
+                uint32_t begin = range * rangeSize;
+                uint32_t end = std::min(cornerCount, begin + rangeSize);
+                uint32_t count = 0;
+                for (uint32_t i = begin; i < end; i++) {
+                    count += isFirst[i];
+                }
+                rangeUniqueCount[range] = count;
+            });
+
+            std::vector<uint32_t> rangeBase(rangeCount, 0);
+            uint32_t uniqueCount = 0;
+            for (uint32_t range = 0; range < rangeCount; range++) {
+                rangeBase[range] = uniqueCount;
+                uniqueCount += rangeUniqueCount[range];
+            }
+
+            std::vector<uint32_t> globalIdOfFirst(cornerCount);
+            parallelFor(jobSystem, rangeCount, [&](uint32_t range) {
+                uint32_t begin = range * rangeSize;
+                uint32_t end = std::min(cornerCount, begin + rangeSize);
+                uint32_t next = rangeBase[range];
+                for (uint32_t i = begin; i < end; i++) {
+                    if (isFirst[i]) {
+                        globalIdOfFirst[i] = next++;
+                    }
+                }
+            });
+
+            vertices.resize(uniqueCount);
+            std::vector<std::vector<uint32_t>> partitionGlobalId(partitionCount);
+            parallelFor(jobSystem, partitionCount, [&](uint32_t partition) {
+                auto& globalIds = partitionGlobalId[partition];
+                const auto& firstCorner = partitionFirstCorner[partition];
+                globalIds.resize(firstCorner.size());
+                for (size_t u = 0; u < firstCorner.size(); u++) {
+                    globalIds[u] = globalIdOfFirst[firstCorner[u]];
+                    vertices[globalIds[u]] = partitionVertices[partition][u];
+                }
+            });
+
+            indices.resize(cornerCount);
+            parallelFor(jobSystem, rangeCount, [&](uint32_t range) {
+                uint32_t begin = range * rangeSize;
+                uint32_t end = std::min(cornerCount, begin + rangeSize);
+                for (uint32_t i = begin; i < end; i++) {
+                    indices[i] = partitionGlobalId[partitionOf[i]][localId[i]];
+                }
+            });
+        }
+    }
+}
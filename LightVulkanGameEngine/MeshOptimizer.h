@@ -0,0 +1,291 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "Vertex.h"
+
+namespace LightVulkan {
+    namespace MeshOptimizer {
+        const uint32_t VERTEX_CACHE_SIZE = 16;
+        const uint32_t INVALID_INDEX = UINT32_MAX;
+
+        struct VertexCacheStats {
+            // Transformed vertices per triangle, 0.5 is the best a regular grid can reach and 3.0 the worst
+            float acmr = 0.0f;
+            // Transformed vertices per referenced vertex, 1.0 means every vertex is shaded once
+            float atvr = 0.0f;
+        };
+
+        struct Report {
+            VertexCacheStats before;
+            VertexCacheStats after;
+        };
+
+        // Simulates a FIFO post-transform cache the size of the one Tipsify targets
+        inline VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+            uint32_t cacheSize = VERTEX_CACHE_SIZE) {
+            std::vector<uint32_t> cachedAt(vertexCount, 0);
+            std::vector<uint8_t> referenced(vertexCount, 0);
+            uint32_t time = cacheSize + 1;
+            size_t transformed = 0;
+            size_t referencedCount = 0;
+
+            for (size_t i = 0; i < indexCount; i++) {
+                uint32_t v = indices[i];
+                if (time - cachedAt[v] > cacheSize) {
+                    cachedAt[v] = time++;
+                    transformed++;
+                }
+                if (!referenced[v]) {
+                    referenced[v] = 1;
+                    referencedCount++;
+                }
+            }
+
+            VertexCacheStats stats;
+            size_t triangleCount = indexCount / 3;
+            stats.acmr = triangleCount > 0 ? static_cast<float>(transformed) / triangleCount : 0.0f;
+            stats.atvr = referencedCount > 0 ? static_cast<float>(transformed) / referencedCount : 0.0f;
+            return stats;
+        }
+
+        // Tipsify (Sander, Nehab, Barczak 2007): fans around the most recently cached vertex that still has
+        // triangles left, falling back to a dead-end stack and then a linear scan. Linear in the index count.
+        inline void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE) {
+            const size_t triangleCount = indices.size() / 3;
+            if (triangleCount == 0) {
+                return;
+            }
+
+            // Vertex to triangle adjacency in CSR form
+            std::vector<uint32_t> liveTriangles(vertexCount, 0);
+            for (uint32_t v : indices) {
+                liveTriangles[v]++;
+            }
+            std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+            for (size_t v = 0; v < vertexCount; v++) {
+                adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+            }
+            std::vector<uint32_t> adjacency(indices.size());
+            {
+                std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+                for (size_t i = 0; i < indices.size(); i++) {
+                    adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+                }
+            }
+
+            std::vector<uint32_t> cachedAt(vertexCount, 0);
+            std::vector<uint8_t> emitted(triangleCount, 0);
+            std::vector<uint32_t> deadEnd;
+            std::vector<uint32_t> candidates;
+            deadEnd.reserve(indices.size());
+            candidates.reserve(64);
+
+            std::vector<uint32_t> result;
+            result.reserve(indices.size());
+
+            uint32_t time = cacheSize + 1;
+            uint32_t cursor = 0;
+            uint32_t fan = 0;
+
+            while (fan != INVALID_INDEX) {
+                candidates.clear();
+                for (uint32_t a = adjacencyOffset[fan]; a < adjacencyOffset[fan + 1]; a++) {
+                    uint32_t triangle = adjacency[a];
+                    if (emitted[triangle]) {
+                        continue;
+                    }
+                    emitted[triangle] = 1;
+
+                    for (uint32_t k = 0; k < 3; k++) {
+                        uint32_t v = indices[triangle * 3 + k];
+                        result.push_back(v);
+                        deadEnd.push_back(v);
+                        candidates.push_back(v);
+                        liveTriangles[v]--;
+                        if (time - cachedAt[v] > cacheSize) {
+                            cachedAt[v] = time++;
+                        }
+                    }
+                }
+
+                // Prefer the oldest candidate that will still be cached after its remaining triangles are emitted
+                uint32_t best = INVALID_INDEX;
+                int64_t bestPriority = -1;
+                for (uint32_t v : candidates) {
+                    if (liveTriangles[v] == 0) {
+                        continue;
+                    }
+                    int64_t priority = 0;
+                    if (time - cachedAt[v] + 2 * liveTriangles[v] <= cacheSize) {
+                        priority = time - cachedAt[v];
+                    }
+                    if (priority > bestPriority) {
+                        bestPriority = priority;
+                        best = v;
+                    }
+                }
+
+                if (best == INVALID_INDEX) {
+                    while (!deadEnd.empty()) {
+                        uint32_t v = deadEnd.back();
+                        deadEnd.pop_back();
+                        if (liveTriangles[v] > 0) {
+                            best = v;
+                            break;
+                        }
+                    }
+                }
+                if (best == INVALID_INDEX) {
+                    while (cursor < vertexCount && liveTriangles[cursor] == 0) {
+                        cursor++;
+                    }
+                    if (cursor < vertexCount) {
+                        best = cursor;
+                    }
+                }
+                fan = best;
+            }
+
+            indices.swap(result);
+        }
+
+        // Sander et al. 2007 overdraw pass: the cache optimized order is cut into clusters wherever the cache
+        // restarts, or sooner once a cluster drawn on its own stays within threshold of the mesh ACMR. Clusters
+        // facing away from the mesh centre are drawn first since they are the most likely occluders.
+        inline void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+            float threshold = 1.05f, uint32_t cacheSize = VERTEX_CACHE_SIZE) {
+            const size_t triangleCount = indices.size() / 3;
+            if (triangleCount < 2) {
+                return;
+            }
+
+            const float meshAcmr = analyzeVertexCache(indices.data(), indices.size(), vertices.size(), cacheSize).acmr;
+            const float targetAcmr = meshAcmr * threshold;
+
+            std::vector<uint32_t> clusterStart;
+            {
+                std::vector<uint32_t> cachedAt(vertices.size(), 0);
+                uint32_t time = cacheSize + 1;
+                size_t clusterTransformed = 0;
+                size_t clusterTriangles = 0;
+
+                for (size_t t = 0; t < triangleCount; t++) {
+                    const uint32_t* triangle = &indices[t * 3];
+                    bool boundary = t == 0 ||
+                        static_cast<float>(clusterTransformed) / clusterTriangles <= targetAcmr;
+                    if (!boundary) {
+                        boundary = true;
+                        for (uint32_t k = 0; k < 3; k++) {
+                            boundary = boundary && time - cachedAt[triangle[k]] > cacheSize;
+                        }
+                    }
+
+                    // Clusters are measured from a cold cache since they end up next to arbitrary neighbours
+                    if (boundary) {
+                        clusterStart.push_back(static_cast<uint32_t>(t));
+                        time += cacheSize + 1;
+                        clusterTransformed = 0;
+                        clusterTriangles = 0;
+                    }
+
+                    for (uint32_t k = 0; k < 3; k++) {
+                        if (time - cachedAt[triangle[k]] > cacheSize) {
+                            cachedAt[triangle[k]] = time++;
+                            clusterTransformed++;
+                        }
+                    }
+                    clusterTriangles++;
+                }
+            }
+            const size_t clusterCount = clusterStart.size();
+            clusterStart.push_back(static_cast<uint32_t>(triangleCount));
+
+            glm::vec3 meshCentroid(0.0f);
+            float meshArea = 0.0f;
+            std::vector<glm::vec3> clusterCentroid(clusterCount, glm::vec3(0.0f));
+            std::vector<glm::vec3> clusterNormal(clusterCount, glm::vec3(0.0f));
+
+            for (size_t c = 0; c < clusterCount; c++) {
+                float clusterArea = 0.0f;
+                for (uint32_t t = clusterStart[c]; t < clusterStart[c + 1]; t++) {
+                    const glm::vec3& p0 = vertices[indices[t * 3 + 0]].pos;
+                    const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+                    const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+
+                    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                    float area = glm::length(normal);
+                    glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+
+                    clusterCentroid[c] += centroid * area;
+                    clusterNormal[c] += normal;
+                    clusterArea += area;
+                }
+
+                meshCentroid += clusterCentroid[c];
+                meshArea += clusterArea;
+                if (clusterArea > 0.0f) {
+                    clusterCentroid[c] /= clusterArea;
+                }
+                float normalLength = glm::length(clusterNormal[c]);
+                if (normalLength > 0.0f) {
+                    clusterNormal[c] /= normalLength;
+                }
+            }
+            if (meshArea > 0.0f) {
+                meshCentroid /= meshArea;
+            }
+
+            std::vector<float> sortKey(clusterCount);
+            for (size_t c = 0; c < clusterCount; c++) {
+                sortKey[c] = glm::dot(clusterCentroid[c] - meshCentroid, clusterNormal[c]);
+            }
+
+            std::vector<uint32_t> order(clusterCount);
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                return sortKey[a] > sortKey[b];
+            });
+
+            std::vector<uint32_t> result;
+            result.reserve(indices.size());
+            for (uint32_t c : order) {
+                result.insert(result.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+            }
+            indices.swap(result);
+        }
+
+        // Renumbers vertices in the order the index buffer first touches them and drops unreferenced ones
+        inline void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+            std::vector<uint32_t> remap(vertices.size(), INVALID_INDEX);
+            std::vector<Vertex> result;
+            result.reserve(vertices.size());
+
+            for (uint32_t& index : indices) {
+                if (remap[index] == INVALID_INDEX) {
+                    remap[index] = static_cast<uint32_t>(result.size());
+                    result.push_back(vertices[index]);
+                }
+                index = remap[index];
+            }
+            vertices.swap(result);
+        }
+
+        inline Report optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float overdrawThreshold = 1.05f) {
+            Report report;
+            report.before = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+            optimizeVertexCache(indices, vertices.size());
+            optimizeOverdraw(indices, vertices, overdrawThreshold);
+            optimizeVertexFetch(vertices, indices);
+
+            report.after = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+            return report;
+        }
+    }
+}
@@ -3,68 +3,63 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-
 #include <glm/glm.hpp>
 
 #include <stdexcept>
+#include <iostream>
 #include <array>
 #include <vector>
 #include <unordered_map>
 
+#include "Vertex.h"
+#include "VertexLayout.h"
+#include "Bounds.h"
+#include "MeshCache.h"
+#include "MeshIngest.h"
+#include "MeshOptimizer.h"
 #include "VulkanBuffer.h"
+#include "VulkanUploadManager.h"
 
 namespace LightVulkan {
-    struct Vertex {
-        glm::vec3 pos;
-        glm::vec3 color;
-        glm::vec2 texCoord;
-
-        static VkVertexInputBindingDescription getBindingDescription() {
-            VkVertexInputBindingDescription bindingDescription{};
-            bindingDescription.binding = 0;
-            bindingDescription.stride = sizeof(Vertex);
-            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-            return bindingDescription;
-        }
-
-        static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
-            std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
-
-            attributeDescriptions[0].binding = 0;
-            attributeDescriptions[0].location = 0;
-            attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-            attributeDescriptions[1].binding = 0;
-            attributeDescriptions[1].location = 1;
-            attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attributeDescriptions[1].offset = offsetof(Vertex, color);
+    class Model {
+    public:
+        // Prefers the binary cache next to the OBJ and regenerates it when missing, stale or corrupt.
+        // With optimize set an unoptimized cache also counts as stale. The cache always holds Float32 vertices,
+        // packing into the requested layout happens on the way to the GPU.
+        void load(VulkanDevice& device, VulkanUploadManager& uploadManager, JobSystem& jobSystem, const std::string& filepath,
+            VertexLayout layoutIn = VertexLayout::Float32, bool optimize = true) {
+            layout = layoutIn;
+
+            std::string cachePath = MeshCache::getCachePath(filepath);
+            if (MeshCache::isFresh(cachePath, filepath)) {
+                MappedFile file;
+                MeshCacheView view;
+                if (file.open(cachePath) && MeshCache::read(file, view) &&
+                    (!optimize || (view.flags & MeshCache::FLAG_OPTIMIZED))) {
+                    // The upload copies straight from the mapping into staging memory
+                    createBuffers(device, uploadManager, view.vertices, view.vertexCount, view.indices, view.indexCount);
+                    return;
+                }
+            }
 
-            attributeDescriptions[2].binding = 0;
-            attributeDescriptions[2].location = 2;
-            attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-            attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
+            std::vector<Vertex> vertices;
+            std::vector<uint32_t> indices;
+            parseObj(filepath, vertices, indices, jobSystem);
 
-            return attributeDescriptions;
-        }
+            uint32_t cacheFlags = 0;
+            if (optimize) {
+                MeshOptimizer::Report report = MeshOptimizer::optimize(vertices, indices);
+                std::cout << "Optimized " << filepath << ": ACMR " << report.before.acmr << " -> " << report.after.acmr
+                    << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << std::endl;
+                cacheFlags |= MeshCache::FLAG_OPTIMIZED;
+            }
 
-        bool operator==(const Vertex& other) const {
-            return pos == other.pos && color == other.color && texCoord == other.texCoord;
-        }
-    };
+            // Best effort, a read-only asset directory only costs the next startup a reparse
+            MeshCache::write(cachePath, vertices, indices, cacheFlags);
 
-    struct VertexHash {
-        size_t operator()(Vertex const& vertex) const noexcept {
-            return ((std::hash<glm::vec3>()(vertex.pos) ^ (std::hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^ (std::hash<glm::vec2>()(vertex.texCoord) << 1);
+            createBuffers(device, uploadManager, vertices.data(), vertices.size(), indices.data(), indices.size());
         }
-    };
-
-    class Model {
-    public:
-        void load(VulkanDevice& device, const std::string& filepath) {
+        static void parseObj(const std::string& filepath, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, JobSystem& jobSystem) {
             tinyobj::attrib_t attrib;
             std::vector<tinyobj::shape_t> shapes;
             std::vector<tinyobj::material_t> materials;
@@ -74,45 +69,42 @@ namespace LightVulkan {
                 throw std::runtime_error(warn + err);
             }
 
-            std::unordered_map<Vertex, uint32_t, VertexHash> uniqueVertices{};
-
-            for (const auto& shape : shapes) {
-                for (const auto& index : shape.mesh.indices) {
-                    Vertex vertex{};
-
-                    vertex.pos = {
-                        attrib.vertices[3 * index.vertex_index + 0],
-                        attrib.vertices[3 * index.vertex_index + 1],
-                        attrib.vertices[3 * index.vertex_index + 2]
-                    };
-
-                    vertex.texCoord = {
-                        attrib.texcoords[2 * index.texcoord_index + 0],
-                        1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-                    };
-
-                    vertex.color = { 1.0f, 1.0f, 1.0f };
-
-                    if (uniqueVertices.count(vertex) == 0) {
-                        uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                        vertices.push_back(vertex);
-                    }
-
-                    indices.push_back(uniqueVertices[vertex]);
-                }
-            }
-            createVertexBuffer(device);
-            createIndexBuffer(device);
+            MeshIngest::buildIndexedMesh(attrib, shapes, vertices, indices, jobSystem);
+        }
+        // Vertex data on binding 0 and the index buffer, instance data is bound separately
+        void bind(VkCommandBuffer commandBuffer) {
+            VkBuffer vertexBuffers[] = { vertexBuffer.getBuffer() };
+            VkDeviceSize offsets[] = { 0 };
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer.getBuffer(), 0, indexType);
+        }
+        // One draw for instanceCount copies reading InstanceData from firstInstance on
+        void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance = 0) {
+            vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, 0, 0, firstInstance);
         }
         void destroyBuffers(VulkanDevice& device) {
-            indexBuffer.destroy(device.getLogicalDevice());
-            vertexBuffer.destroy(device.getLogicalDevice());
+            indexBuffer.destroy(device);
+            vertexBuffer.destroy(device);
+        }
+        uint32_t getVertexCount() {
+            return vertexCount;
+        }
+        uint32_t getIndexCount() {
+            return indexCount;
         }
-        std::vector<Vertex>& getVertices() {
-            return vertices;
+        VkIndexType getIndexType() {
+            return indexType;
         }
-        std::vector<uint32_t>& getIndices() {
-            return indices;
+        VertexLayout getVertexLayout() {
+            return layout;
+        }
+        // Model space, before the dequantize transform is applied
+        const Bounds& getBounds() {
+            return bounds;
+        }
+        // Identity for Float32, otherwise has to be applied before the model matrix
+        glm::mat4 getDequantizeTransform() {
+            return quantization.getDequantizeTransform();
         }
         VkBuffer getVertexBuffer() {
             return vertexBuffer.getBuffer();
@@ -122,53 +114,56 @@ namespace LightVulkan {
         }
 
     private:
-        void createVertexBuffer(VulkanDevice& device) {
-            VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-            VulkanBuffer stagingBuffer;
-            stagingBuffer.create(device, bufferSize,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        void createBuffers(VulkanDevice& device, VulkanUploadManager& uploadManager,
+            const Vertex* vertices, uint64_t vertexCountIn, const uint32_t* indices, uint64_t indexCountIn) {
+            vertexCount = static_cast<uint32_t>(vertexCountIn);
+            indexCount = static_cast<uint32_t>(indexCountIn);
 
-            void* data;
-            vkMapMemory(device.getLogicalDevice(), stagingBuffer.getMemory(), 0, bufferSize, 0, &data);
-            memcpy(data, vertices.data(), (size_t)bufferSize);
-            vkUnmapMemory(device.getLogicalDevice(), stagingBuffer.getMemory());
+            bounds = Bounds::fromVertices(vertices, vertexCount);
+            quantization = layout == VertexLayout::Float32 ? VertexQuantization{} : VertexQuantization::fromBounds(vertices, vertexCount);
 
-            vertexBuffer.create(device, bufferSize,
+            VkDeviceSize vertexBufferSize = static_cast<VkDeviceSize>(VertexLayouts::getStride(layout)) * vertexCountIn;
+            vertexBuffer.create(device, vertexBufferSize,
                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-            VulkanBuffer::copyBuffer(device, stagingBuffer, vertexBuffer, bufferSize);
-
-            vkDestroyBuffer(device.getLogicalDevice(), stagingBuffer.getBuffer(), nullptr);
-            vkFreeMemory(device.getLogicalDevice(), stagingBuffer.getMemory(), nullptr);
-        }
-        void createIndexBuffer(VulkanDevice& device) {
-            VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-            VulkanBuffer stagingBuffer;
-            stagingBuffer.create(device, bufferSize,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            // Packed layouts are converted straight into staging memory, no intermediate copy of the mesh
+            VkDeviceSize stride = VertexLayouts::getStride(layout);
+            uploadManager.fillBuffer(device, vertexBuffer, vertexBufferSize, stride, [this, vertices, stride](void* staging, VkDeviceSize offset, VkDeviceSize size) {
+                VertexLayouts::pack(layout, vertices + offset / stride, static_cast<size_t>(size / stride), quantization, staging);
+            }, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
 
-            void* data;
-            vkMapMemory(device.getLogicalDevice(), stagingBuffer.getMemory(), 0, bufferSize, 0, &data);
-            memcpy(data, indices.data(), (size_t)bufferSize);
-            vkUnmapMemory(device.getLogicalDevice(), stagingBuffer.getMemory());
+            // Every index fits in 16 bits, primitive restart is never enabled so 0xFFFF is a valid index too
+            indexType = vertexCount <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
 
-            indexBuffer.create(device, bufferSize,
+            VkDeviceSize indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+            VkDeviceSize indexBufferSize = indexSize * indexCountIn;
+            indexBuffer.create(device, indexBufferSize,
                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-            VulkanBuffer::copyBuffer(device, stagingBuffer, indexBuffer, bufferSize);
-
-            stagingBuffer.destroy(device.getLogicalDevice());
+            if (indexType == VK_INDEX_TYPE_UINT16) {
+                uploadManager.fillBuffer(device, indexBuffer, indexBufferSize, sizeof(uint16_t), [indices](void* staging, VkDeviceSize offset, VkDeviceSize size) {
+                    const uint32_t* src = indices + offset / sizeof(uint16_t);
+                    uint16_t* dst = static_cast<uint16_t*>(staging);
+                    for (VkDeviceSize i = 0; i < size / sizeof(uint16_t); i++) {
+                        dst[i] = static_cast<uint16_t>(src[i]);
+                    }
+                }, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+            }
+            else {
+                uploadManager.uploadBuffer(device, indexBuffer, indices, indexBufferSize,
+                    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+            }
         }
 
     private:
-        std::vector<Vertex> vertices;
-        std::vector<uint32_t> indices;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+        VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+        VertexLayout layout = VertexLayout::Float32;
+        VertexQuantization quantization;
+        Bounds bounds;
         VulkanBuffer vertexBuffer;
         VulkanBuffer indexBuffer;
     };
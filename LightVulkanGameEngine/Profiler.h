@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace LightVulkan {
+    struct ProfileEvent {
+        const char* name = nullptr;
+        int64_t startNs = 0;
+        int64_t endNs = 0;
+    };
+
+    // Average and worst time per frame over the last Profiler::AVERAGE_WINDOW frames
+    struct ProfileScopeStats {
+        const char* name = nullptr;
+        bool gpu = false;
+        double averageMs = 0.0;
+        double maxMs = 0.0;
+        double callsPerFrame = 0.0;
+    };
+
+    // Collects CPU scopes from any thread and GPU scopes from VulkanGpuProfiler. Every thread appends to its own
+    // ring of events without locking and drops new events while the ring is full. The main thread drains the rings
+    // once per frame in endFrame, where the events are kept for the trace and folded into rolling per scope
+    // averages. Scope names must outlive the profiler, string literals or intern().
+    class Profiler {
+    public:
+        static const uint32_t THREAD_CAPACITY = 16384;
+        static const uint32_t AVERAGE_WINDOW = 120;
+        static const size_t MAX_TRACE_EVENTS = 1 << 20;
+
+        static Profiler& get() {
+            static Profiler profiler;
+            return profiler;
+        }
+        // Nothing is recorded until enabled, scopes then cost a clock read and a store each
+        void setEnabled(bool enable) {
+            enabled.store(enable, std::memory_order_relaxed);
+        }
+        bool isEnabled() const {
+            return enabled.load(std::memory_order_relaxed);
+        }
+        int64_t now() const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+        }
+        // Shown as the track name in the trace, threads that never call it are numbered
+        void setThreadName(const std::string& name) {
+            if (isEnabled()) {
+                getThreadBuffer().name = name;
+            }
+        }
+        void record(const char* name, int64_t startNs, int64_t endNs) {
+            ThreadBuffer& buffer = getThreadBuffer();
+            uint64_t index = buffer.written.load(std::memory_order_relaxed);
+            // A full ring may still be read by endFrame, never overwrite a slot it has not released
+            if (index - buffer.read.load(std::memory_order_acquire) >= THREAD_CAPACITY) {
+                buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            buffer.events[index % THREAD_CAPACITY] = { name, startNs, endNs };
+            buffer.written.store(index + 1, std::memory_order_release);
+        }
+        // Main thread only, GPU scopes arrive already converted to the CPU timeline
+        void recordGpu(const char* name, int64_t startNs, int64_t endNs) {
+            if (!isEnabled()) {
+                return;
+            }
+            gpuEvents.push_back({ name, startNs, endNs });
+        }
+        // Stable copy of a name whose owner may go away before its events are read
+        const char* intern(const std::string& name) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return internedNames.insert(name).first->c_str();
+        }
+
+        // Main thread, once per frame. Events past a whole ring per frame and thread are lost and counted.
+        void endFrame() {
+            if (!isEnabled()) {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (uint32_t track = 0; track < threadBuffers.size(); track++) {
+                    ThreadBuffer& buffer = *threadBuffers[track];
+                    uint64_t written = buffer.written.load(std::memory_order_acquire);
+                    uint64_t read = buffer.read.load(std::memory_order_relaxed);
+                    for (; read < written; read++) {
+                        addEvent(buffer.events[read % THREAD_CAPACITY], track, false);
+                    }
+                    buffer.read.store(read, std::memory_order_release);
+                    droppedEvents += buffer.dropped.exchange(0, std::memory_order_relaxed);
+                }
+            }
+            for (const auto& event : gpuEvents) {
+                addEvent(event, GPU_TRACK, true);
+            }
+            gpuEvents.clear();
+
+            for (auto& entry : history) {
+                ScopeHistory& scope = entry.second;
+                scope.samples[scope.next] = { scope.frameMs, scope.frameCalls };
+                scope.next = (scope.next + 1) % AVERAGE_WINDOW;
+                if (scope.sampleCount < AVERAGE_WINDOW) {
+                    scope.sampleCount++;
+                }
+                scope.frameMs = 0.0;
+                scope.frameCalls = 0;
+            }
+        }
+        // Sorted by average time, GPU scopes after CPU ones
+        std::vector<ProfileScopeStats> getAverages() {
+            std::vector<ProfileScopeStats> averages;
+            for (const auto& entry : history) {
+                const ScopeHistory& scope = entry.second;
+                if (scope.sampleCount == 0) {
+                    continue;
+                }
+                ProfileScopeStats stats;
+                stats.name = scope.name;
+                stats.gpu = scope.gpu;
+                for (uint32_t i = 0; i < scope.sampleCount; i++) {
+                    stats.averageMs += scope.samples[i].ms;
+                    stats.maxMs = std::max(stats.maxMs, scope.samples[i].ms);
+                    stats.callsPerFrame += scope.samples[i].calls;
+                }
+                stats.averageMs /= scope.sampleCount;
+                stats.callsPerFrame /= scope.sampleCount;
+                averages.push_back(stats);
+            }
+            std::sort(averages.begin(), averages.end(), [](const ProfileScopeStats& a, const ProfileScopeStats& b) {
+                return a.gpu != b.gpu ? b.gpu : a.averageMs > b.averageMs;
+            });
+            return averages;
+        }
+        void report(std::ostream& out) {
+            std::vector<ProfileScopeStats> averages = getAverages();
+            if (averages.empty()) {
+                return;
+            }
+            out << "Profile, ms per frame over the last " << AVERAGE_WINDOW << " frames (avg / max, calls):" << std::endl;
+            for (const auto& stats : averages) {
+                out << "  " << (stats.gpu ? "GPU " : "CPU ") << std::left << std::setw(24) << stats.name << std::right
+                    << std::fixed << std::setprecision(3) << std::setw(9) << stats.averageMs << " / " << std::setw(9) << stats.maxMs
+                    << std::setprecision(1) << std::setw(8) << stats.callsPerFrame << std::defaultfloat << std::endl;
+            }
+        }
+        // Chrome trace event format, loads in chrome://tracing and ui.perfetto.dev
+        bool writeChromeTrace(const std::string& path) {
+            std::ofstream file(path, std::ios::binary);
+            if (!file) {
+                return false;
+            }
+
+            file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (uint32_t track = 0; track < threadBuffers.size(); track++) {
+                    const std::string& name = threadBuffers[track]->name;
+                    writeThreadName(file, track, name.empty() ? "Thread " + std::to_string(track) : name);
+                    file << ",\n";
+                }
+            }
+            writeThreadName(file, GPU_TRACK, "GPU");
+
+            file << std::fixed << std::setprecision(3);
+            for (const auto& event : trace) {
+                file << ",\n{\"name\":\"";
+                writeEscaped(file, event.name);
+                file << "\",\"cat\":\"" << (event.track == GPU_TRACK ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.track
+                    << ",\"ts\":" << event.startNs / 1000.0 << ",\"dur\":" << (event.endNs - event.startNs) / 1000.0 << "}";
+            }
+            file << "\n]}\n";
+
+            std::cout << "Wrote " << trace.size() << " profile events to " << path;
+            if (droppedEvents > 0) {
+                std::cout << " (" << droppedEvents << " dropped)";
+            }
+            std::cout << std::endl;
+            return static_cast<bool>(file);
+        }
+
+    private:
+        static const uint32_t GPU_TRACK = 1000;
+
+        struct ThreadBuffer {
+            std::vector<ProfileEvent> events = std::vector<ProfileEvent>(THREAD_CAPACITY);
+            std::atomic<uint64_t> written{ 0 };
+            // Advanced by the main thread once it is done with the slots before it
+            std::atomic<uint64_t> read{ 0 };
+            std::atomic<uint64_t> dropped{ 0 };
+            std::string name;
+        };
+
+        struct TraceEvent {
+            const char* name;
+            uint32_t track;
+            int64_t startNs;
+            int64_t endNs;
+        };
+
+        struct FrameSample {
+            double ms = 0.0;
+            uint32_t calls = 0;
+        };
+
+        struct ScopeHistory {
+            const char* name = nullptr;
+            bool gpu = false;
+            double frameMs = 0.0;
+            uint32_t frameCalls = 0;
+            std::array<FrameSample, AVERAGE_WINDOW> samples{};
+            uint32_t sampleCount = 0;
+            uint32_t next = 0;
+        };
+
+        Profiler() : origin(std::chrono::steady_clock::now()) {}
+
+        ThreadBuffer& getThreadBuffer() {
+            thread_local ThreadBuffer* buffer = nullptr;
+            if (buffer == nullptr) {
+                std::lock_guard<std::mutex> lock(mutex);
+                threadBuffers.push_back(std::make_unique<ThreadBuffer>());
+                buffer = threadBuffers.back().get();
+            }
+            return *buffer;
+        }
+        // CPU and GPU scopes of the same name are kept apart
+        void addEvent(const ProfileEvent& event, uint32_t track, bool gpu) {
+            if (trace.size() < MAX_TRACE_EVENTS) {
+                trace.push_back({ event.name, track, event.startNs, event.endNs });
+            }
+            else {
+                droppedEvents++;
+            }
+
+            ScopeHistory& scope = history[{ event.name, gpu }];
+            scope.name = event.name;
+            scope.gpu = gpu;
+            scope.frameMs += (event.endNs - event.startNs) / 1e6;
+            scope.frameCalls++;
+        }
+        static void writeThreadName(std::ostream& out, uint32_t track, const std::string& name) {
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track << ",\"args\":{\"name\":\"";
+            writeEscaped(out, name.c_str());
+            out << "\"}}";
+        }
+        static void writeEscaped(std::ostream& out, const char* text) {
+            for (; *text; text++) {
+                if (*text == '"' || *text == '\\') {
+                    out << '\\';
+                }
+                out << (static_cast<unsigned char>(*text) < 0x20 ? ' ' : *text);
+            }
+        }
+
+    private:
+        std::atomic<bool> enabled{ false };
+        std::chrono::steady_clock::time_point origin;
+
+        // Guards the buffer list and interned names, never taken on the recording path once a thread has its buffer
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+        std::set<std::string> internedNames;
+
+        std::vector<ProfileEvent> gpuEvents;
+        std::vector<TraceEvent> trace;
+        uint64_t droppedEvents = 0;
+        std::map<std::pair<const char*, bool>, ScopeHistory> history;
+    };
+
+    // Records the enclosing block as one event on the calling thread's track
+    class ProfileScope {
+    public:
+        explicit ProfileScope(const char* name) : name(name), startNs(Profiler::get().isEnabled() ? Profiler::get().now() : -1) {}
+        ~ProfileScope() {
+            if (startNs >= 0) {
+                Profiler::get().record(name, startNs, Profiler::get().now());
+            }
+        }
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        const char* name;
+        int64_t startNs;
+    };
+}
@@ -0,0 +1,438 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef LIGHTVULKAN_SHADERC
+#include <shaderc/shaderc.hpp>
+#endif
+
+#include "Hash.h"
+
+namespace LightVulkan {
+    typedef uint32_t ShaderHandle;
+
+    struct ShaderLoadStats {
+        uint32_t compiled = 0;
+        uint32_t cached = 0;
+        double milliseconds = 0.0;
+    };
+
+    // Compiles GLSL to SPIR-V at runtime. Includes are expanded and defines injected here, so the expanded text is
+    // everything the compiler sees and its hash names the cached SPIR-V, a warm start only reads and hashes the
+    // sources. Compiles with shaderc when built with LIGHTVULKAN_SHADERC, otherwise runs the SDK's glslc.
+    // Watching polls the sources on a thread of its own, a compile can take longer than a frame and must not hold
+    // up the job system. Reloaded code is handed to the main thread by poll(), a failed compile keeps the old code.
+    class ShaderManager {
+    public:
+        static const uint32_t SPIRV_MAGIC = 0x07230203;
+        static const uint32_t MAX_INCLUDE_DEPTH = 32;
+
+        void create(const std::string& cacheDirectoryIn) {
+            cacheDirectory = cacheDirectoryIn;
+            std::error_code ec;
+            std::filesystem::create_directories(cacheDirectory, ec);
+        }
+        void destroy() {
+            stopWatching();
+            std::lock_guard<std::mutex> lock(mutex);
+            programs.clear();
+            pending.clear();
+        }
+
+        // Main thread. Loading the same source and defines again returns the existing handle.
+        ShaderHandle load(const std::string& sourcePath, const std::vector<std::string>& defines = {}) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (ShaderHandle handle = 0; handle < programs.size(); handle++) {
+                    if (programs[handle].sourcePath == sourcePath && programs[handle].defines == defines) {
+                        return handle;
+                    }
+                }
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            Program program;
+            program.sourcePath = sourcePath;
+            program.defines = defines;
+            std::string log;
+            bool cached = false;
+            if (!build(program, cached, log)) {
+                throw std::runtime_error("failed to compile shader " + sourcePath + "!\n" + log);
+            }
+            stats.milliseconds += std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+            (cached ? stats.cached : stats.compiled)++;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            programs.push_back(std::move(program));
+            return static_cast<ShaderHandle>(programs.size() - 1);
+        }
+        // Main thread, valid until the next poll()
+        const std::vector<uint32_t>& getCode(ShaderHandle handle) {
+            return programs[handle].code;
+        }
+        const std::string& getSourcePath(ShaderHandle handle) {
+            return programs[handle].sourcePath;
+        }
+        const ShaderLoadStats& getStats() {
+            return stats;
+        }
+
+        void startWatching(std::chrono::milliseconds interval = std::chrono::milliseconds(250)) {
+            if (watcher.joinable()) {
+                return;
+            }
+            watchInterval = interval;
+            stopping = false;
+            watcher = std::thread([this]() {
+                watch();
+            });
+        }
+        void stopWatching() {
+            if (!watcher.joinable()) {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wakeup.notify_all();
+            watcher.join();
+        }
+        // Main thread, once per frame. Installs code the watcher recompiled and returns the handles that changed.
+        std::vector<ShaderHandle> poll() {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::vector<ShaderHandle> changed;
+            for (auto& reload : pending) {
+                programs[reload.handle].code = std::move(reload.code);
+                if (std::find(changed.begin(), changed.end(), reload.handle) == changed.end()) {
+                    changed.push_back(reload.handle);
+                }
+            }
+            pending.clear();
+            return changed;
+        }
+
+    private:
+        struct SourceFile {
+            std::string path;
+            std::filesystem::file_time_type writeTime;
+        };
+
+        struct Program {
+            std::string sourcePath;
+            std::vector<std::string> defines;
+            std::vector<uint32_t> code;
+            // The source and everything it includes, with the write times the code was built from
+            std::vector<SourceFile> files;
+        };
+
+        struct Reload {
+            ShaderHandle handle;
+            std::vector<uint32_t> code;
+        };
+
+        // Preprocesses, then loads the SPIR-V from the cache or compiles and caches it
+        bool build(Program& program, bool& cached, std::string& log) {
+            std::vector<SourceFile> files;
+            std::string source;
+            try {
+                source = preprocess(program.sourcePath, program.defines, files);
+            }
+            catch (const std::exception& e) {
+                log = e.what();
+                return false;
+            }
+
+            std::string stage = std::filesystem::path(program.sourcePath).extension().string();
+            uint64_t key = hashBytes(COMPILER_TAG, sizeof(COMPILER_TAG) - 1);
+            key = hashBytes(stage.data(), stage.size(), key);
+            key = hashBytes(source.data(), source.size(), key);
+            std::ostringstream name;
+            name << std::hex << std::setw(16) << std::setfill('0') << key;
+            std::filesystem::path cachePath = std::filesystem::path(cacheDirectory) / (name.str() + ".spv");
+
+            std::vector<uint32_t> code;
+            cached = readSpirv(cachePath, code);
+            if (!cached) {
+                if (!compile(source, program.sourcePath, stage, name.str(), code, log)) {
+                    return false;
+                }
+                writeCache(cachePath, code);
+            }
+            program.code = std::move(code);
+            program.files = std::move(files);
+            return true;
+        }
+
+        // Expands #include "file", relative to the including file, and puts the defines right after #version.
+        // #line directives keep compiler errors pointing at the original lines, the source string number is the
+        // file's index in files.
+        static std::string preprocess(const std::string& sourcePath, const std::vector<std::string>& defines, std::vector<SourceFile>& files) {
+            std::ostringstream out;
+            expand(sourcePath, defines, 0, out, files);
+            return out.str();
+        }
+        static void expand(const std::string& path, const std::vector<std::string>& defines, uint32_t depth, std::ostream& out, std::vector<SourceFile>& files) {
+            if (depth > MAX_INCLUDE_DEPTH) {
+                throw std::runtime_error("shader include depth exceeded in " + path + ", is there a cycle?");
+            }
+            std::ifstream file(path);
+            if (!file.is_open()) {
+                throw std::runtime_error("failed to open file : " + path);
+            }
+
+            size_t fileIndex = files.size();
+            for (size_t i = 0; i < files.size(); i++) {
+                if (files[i].path == path) {
+                    fileIndex = i;
+                }
+            }
+            if (fileIndex == files.size()) {
+                std::error_code ec;
+                files.push_back({ path, std::filesystem::last_write_time(path, ec) });
+            }
+            if (depth > 0) {
+                out << "#line 1 " << fileIndex << "\n";
+            }
+
+            std::string line;
+            uint32_t lineNumber = 0;
+            while (std::getline(file, line)) {
+                lineNumber++;
+                size_t start = line.find_first_not_of(" \t");
+                if (start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+                    size_t open = line.find('"', start + 8);
+                    size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+                    if (close == std::string::npos) {
+                        throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": expected #include \"file\"");
+                    }
+                    std::filesystem::path included = std::filesystem::path(path).parent_path() / line.substr(open + 1, close - open - 1);
+                    expand(included.generic_string(), defines, depth + 1, out, files);
+                    out << "#line " << lineNumber + 1 << " " << fileIndex << "\n";
+                    continue;
+                }
+                out << line << "\n";
+                if (depth == 0 && start != std::string::npos && line.compare(start, 8, "#version") == 0 && !defines.empty()) {
+                    for (const auto& define : defines) {
+                        size_t equals = define.find('=');
+                        out << "#define " << (equals == std::string::npos ? define : define.substr(0, equals) + " " + define.substr(equals + 1)) << "\n";
+                    }
+                    out << "#line " << lineNumber + 1 << " 0\n";
+                }
+            }
+        }
+
+        static bool readSpirv(const std::filesystem::path& path, std::vector<uint32_t>& code) {
+            std::ifstream file(path, std::ios::ate | std::ios::binary);
+            if (!file.is_open()) {
+                return false;
+            }
+            size_t size = static_cast<size_t>(file.tellg());
+            if (size == 0 || size % sizeof(uint32_t) != 0) {
+                return false;
+            }
+            code.resize(size / sizeof(uint32_t));
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(code.data()), size);
+            return static_cast<bool>(file) && code[0] == SPIRV_MAGIC;
+        }
+        // Written aside and renamed so a reader never sees a partial file
+        static void writeCache(const std::filesystem::path& path, const std::vector<uint32_t>& code) {
+            std::filesystem::path temporary = path;
+            temporary += ".tmp" + std::to_string(nextTemporary++);
+            {
+                std::ofstream file(temporary, std::ios::binary);
+                file.write(reinterpret_cast<const char*>(code.data()), code.size() * sizeof(uint32_t));
+                if (!file) {
+                    return;
+                }
+            }
+            std::error_code ec;
+            std::filesystem::rename(temporary, path, ec);
+            if (ec) {
+                std::filesystem::remove(temporary, ec);
+            }
+        }
+
+#ifdef LIGHTVULKAN_SHADERC
+        static constexpr char COMPILER_TAG[] = "shaderc 1";
+
+        bool compile(const std::string& source, const std::string& sourcePath, const std::string& stage, const std::string& name,
+            std::vector<uint32_t>& code, std::string& log) {
+            shaderc_shader_kind kind;
+            if (!getShaderKind(stage, kind)) {
+                log = "unknown shader stage " + stage;
+                return false;
+            }
+            shaderc::Compiler compiler;
+            shaderc::CompileOptions options;
+            shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source, kind, sourcePath.c_str(), options);
+            if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+                log = result.GetErrorMessage();
+                return false;
+            }
+            code.assign(result.cbegin(), result.cend());
+            return true;
+        }
+        static bool getShaderKind(const std::string& stage, shaderc_shader_kind& kind) {
+            if (stage == ".vert") kind = shaderc_vertex_shader;
+            else if (stage == ".frag") kind = shaderc_fragment_shader;
+            else if (stage == ".comp") kind = shaderc_compute_shader;
+            else if (stage == ".geom") kind = shaderc_geometry_shader;
+            else if (stage == ".tesc") kind = shaderc_tess_control_shader;
+            else if (stage == ".tese") kind = shaderc_tess_evaluation_shader;
+            else return false;
+            return true;
+        }
+#else
+        static constexpr char COMPILER_TAG[] = "glslc 1";
+
+        // The expanded source goes through a file keeping the stage extension, glslc picks the stage from it
+        bool compile(const std::string& source, const std::string& sourcePath, const std::string& stage, const std::string& name,
+            std::vector<uint32_t>& code, std::string& log) {
+            std::string base = (std::filesystem::path(cacheDirectory) / (name + "." + std::to_string(nextTemporary++))).generic_string();
+            std::string sourceFile = base + stage;
+            std::string outputFile = base + ".spv";
+            std::string logFile = base + ".log";
+            {
+                std::ofstream file(sourceFile, std::ios::binary);
+                file << source;
+                if (!file) {
+                    log = "failed to write " + sourceFile;
+                    return false;
+                }
+            }
+
+            std::string command = "\"" + getGlslcPath() + "\" \"" + sourceFile + "\" -o \"" + outputFile + "\" > \"" + logFile + "\" 2>&1";
+#ifdef _WIN32
+            // cmd strips the outer quotes of a command starting with one
+            command = "\"" + command + "\"";
+#endif
+            int status = std::system(command.c_str());
+
+            std::ifstream logStream(logFile);
+            std::ostringstream logText;
+            logText << logStream.rdbuf();
+            logStream.close();
+            log = logText.str();
+            for (size_t at = log.find(sourceFile); at != std::string::npos; at = log.find(sourceFile, at + sourcePath.size())) {
+                log.replace(at, sourceFile.size(), sourcePath);
+            }
+
+            bool compiled = status == 0 && readSpirv(outputFile, code);
+            if (status != 0 && log.empty()) {
+                log = "glslc exited with " + std::to_string(status) + ", is the Vulkan SDK installed?";
+            }
+            std::error_code ec;
+            std::filesystem::remove(sourceFile, ec);
+            std::filesystem::remove(outputFile, ec);
+            std::filesystem::remove(logFile, ec);
+            return compiled;
+        }
+        static std::string getGlslcPath() {
+            const char* sdk = std::getenv("VULKAN_SDK");
+            if (sdk == nullptr) {
+                return "glslc";
+            }
+#ifdef _WIN32
+            return std::string(sdk) + "/Bin/glslc.exe";
+#else
+            return std::string(sdk) + "/bin/glslc";
+#endif
+        }
+#endif
+
+        void watch() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stopping) {
+                wakeup.wait_for(lock, watchInterval, [this]() {
+                    return stopping;
+                });
+                if (stopping) {
+                    break;
+                }
+
+                // Write times are taken now, a file saved again during the compile is picked up on the next pass
+                std::vector<std::pair<ShaderHandle, Program>> changed;
+                for (ShaderHandle handle = 0; handle < programs.size(); handle++) {
+                    if (hasChanged(programs[handle].files)) {
+                        Program program;
+                        program.sourcePath = programs[handle].sourcePath;
+                        program.defines = programs[handle].defines;
+                        changed.push_back({ handle, std::move(program) });
+                    }
+                }
+                if (changed.empty()) {
+                    continue;
+                }
+
+                lock.unlock();
+                for (auto& entry : changed) {
+                    Program& program = entry.second;
+                    bool cached = false;
+                    std::string log;
+                    bool built = build(program, cached, log);
+                    if (built) {
+                        std::cout << "Reloaded shader " << program.sourcePath << (cached ? " from the cache" : "") << std::endl;
+                    }
+                    else {
+                        std::cerr << "failed to compile shader " << program.sourcePath << ", keeping the previous code\n" << log << std::endl;
+                    }
+                    entry.first = built ? entry.first : UINT32_MAX;
+                }
+                lock.lock();
+
+                for (auto& entry : changed) {
+                    if (entry.first != UINT32_MAX) {
+                        programs[entry.first].files = std::move(entry.second.files);
+                        pending.push_back({ entry.first, std::move(entry.second.code) });
+                    }
+                }
+            }
+        }
+        // Updates the recorded write times, so a failed compile is retried only once the file changes again. A
+        // file that cannot be read right now, as while an editor replaces it, counts as unchanged.
+        static bool hasChanged(std::vector<SourceFile>& files) {
+            bool changed = false;
+            for (auto& file : files) {
+                std::error_code ec;
+                auto writeTime = std::filesystem::last_write_time(file.path, ec);
+                if (!ec && writeTime != file.writeTime) {
+                    file.writeTime = writeTime;
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+
+    private:
+        std::string cacheDirectory;
+        ShaderLoadStats stats;
+        static inline std::atomic<uint32_t> nextTemporary{ 0 };
+
+        // Guards programs other than their code, pending and stopping
+        std::mutex mutex;
+        std::vector<Program> programs;
+        std::vector<Reload> pending;
+
+        std::thread watcher;
+        std::condition_variable wakeup;
+        std::chrono::milliseconds watchInterval{ 250 };
+        bool stopping = false;
+    };
+}
@@ -2,17 +2,68 @@
 
 #include "VulkanApplication.h"
 #include "Model.h"
+#include "VulkanUniformRingBuffer.h"
+#include "VulkanCommandRecorder.h"
+#include "FrustumCulling.h"
+#include "VulkanInstanceBuffer.h"
+#include "VulkanGpuCuller.h"
+#include "VulkanTextureStreamer.h"
+#include "VulkanBindlessTable.h"
+#include "VulkanRenderGraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
 
 using namespace LightVulkan;
 
 const std::string MODEL_PATH = "models/viking_room.obj";
 const std::string TEXTURE_PATH = "textures/viking_room.png";
 
+const VkDeviceSize UNIFORM_RING_FRAME_SIZE = 64 * 1024;
+
+const float OBJECT_SPACING = 2.0f;
+const glm::vec3 CAMERA_POSITION(2.0f, 2.0f, 2.0f);
+
+// Visible instances are split evenly across the recording threads, one instanced draw per range, but a range
+// never gets fewer than this many so tiny scenes are not spread over secondaries that each rebind everything
+const uint32_t MIN_INSTANCES_PER_DRAW = 64;
+
 class SimpleModelApplication : public VulkanApplication {
 public:
     void run() {
         VulkanApplication::run("Simple Model Vulkan");
     }
+    // Copies of the model laid out on a square grid, the ones surviving frustum culling are drawn as instances
+    void setObjectCount(uint32_t count) {
+        objectCount = std::max(1u, count);
+    }
+    // Culls on the GPU into indirect draws, no per-object CPU work per frame. Falls back to CPU culling when the
+    // device lacks multiDrawIndirect or drawIndirectFirstInstance. A cullShader.comp that fails to compile, or a
+    // draw count that disagrees with the CPU reference at exit, is an error.
+    void setGpuCulling(bool enabled) {
+        gpuCulling = enabled;
+    }
+    // VRAM the texture streamer may keep resident, 0 picks a share of the device local heap
+    void setTextureBudget(VkDeviceSize bytes) {
+        textureBudget = bytes;
+    }
+    // On by default. Textures and materials come from one bindless set when the device supports descriptor indexing,
+    // otherwise the combined image sampler stays in the per frame set
+    void setBindless(bool enabled) {
+        bindless = enabled;
+    }
+    // Animation advances by this many seconds per frame instead of following the clock, so every run renders the
+    // same frames. 0 follows the clock.
+    void setFixedTimeStep(float seconds) {
+        fixedTimeStep = seconds;
+    }
+    // Snorm16Position by default. Float32 draws with shader.vert, the packed layouts need packedShader.vert
+    void setVertexLayout(VertexLayout layout) {
+        vertexLayout = layout;
+    }
 
 private:
     struct UniformBufferObject {
@@ -21,35 +72,72 @@ private:
         alignas(16) glm::mat4 proj;
     };
 
+    // Source of the per frame set's update template
+    struct FrameDescriptors {
+        VkDescriptorBufferInfo uniforms;
+        VkDescriptorImageInfo texture;
+        VkDescriptorBufferInfo materials;
+    };
+
 private:
     void initVulkan() override {
         VulkanApplication::initVulkan();
 
+        // Let the texture transfer run on the GPU while the model is parsed
         createTextureImage();
+        uploadManager.submit(device);
         createTextureSampler();
+        if (bindless) {
+            createBindlessMaterials();
+        }
+        markStartupPhase("texture");
         loadModel();
+        uploadManager.wait(device, uploadManager.submit(device));
+        markStartupPhase("model");
 
-        createDescriptorSets();
+        createDescriptorTemplate();
         createCommandBuffers();
-    }
-    void cleanupSwapChain() override {
-        VulkanApplication::cleanupSwapChain();
-
-        for (size_t i = 0; i < swapChain.getImages().size(); i++) {
-            uniformBuffers[i].destroy(device.getLogicalDevice());
+        createObjects();
+        instanceBuffer.create(device, objectCount, MAX_FRAMES_IN_FLIGHT);
+        if (gpuCulling) {
+            createGpuCulling();
         }
-        vkDestroyDescriptorPool(device.getLogicalDevice(), descriptorPool, nullptr);
+        recorder.create(device, jobSystem, MAX_FRAMES_IN_FLIGHT);
+        buildFrameGraph();
+        markStartupPhase("scene");
     }
     void cleanup() override {
-        vkDestroyDescriptorSetLayout(device.getLogicalDevice(), descriptorSetLayout, nullptr);
+        frameGraph.destroy(device);
+        bool gpuCullingMatched = true;
+        if (gpuCulling) {
+            if (gpuCullingRan) {
+                gpuCullingMatched = reportGpuCulling();
+            }
+            gpuCuller.destroy(device);
+            gpuInstanceBuffer.destroy(device);
+        }
+        reportTextureStreaming();
+        textureStreamer.destroy(device);
+        if (bindless) {
+            bindlessTable.destroy(device);
+        }
+        recorder.destroy(device);
+        instanceBuffer.destroy(device);
+        uniformRing.destroy(device);
+        descriptorTemplate.destroy(device);
         textureSampler.destroy(device);
-        texture.destroy(device);
         model.destroyBuffers(device);
         VulkanApplication::cleanup();
+
+        if (!gpuCullingMatched) {
+            throw std::runtime_error("GPU culling draw count does not match the CPU reference!");
+        }
     }
     void createGraphicsPipeline() override {
-        VulkanShaderModule vertShaderModule(device, "shaders/vert.spv");
-        VulkanShaderModule fragShaderModule(device, "shaders/frag.spv");
+        vertexShader = shaderManager.load(VertexLayouts::getVertexShaderPath(vertexLayout));
+        fragmentShader = shaderManager.load(bindless ? "shaders/bindlessShader.frag" : "shaders/shader.frag");
+        VulkanShaderModule vertShaderModule(device, shaderManager.getCode(vertexShader));
+        VulkanShaderModule fragShaderModule(device, shaderManager.getCode(fragmentShader));
 
         VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
         vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -68,37 +156,29 @@ private:
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
+        VertexInputDescription vertexInput = VertexLayouts::getInputDescription(vertexLayout);
 
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexInput.bindings.size());
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInput.attributes.size());
+        vertexInputInfo.pVertexBindingDescriptions = vertexInput.bindings.data();
+        vertexInputInfo.pVertexAttributeDescriptions = vertexInput.attributes.data();
 
         VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
         inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
         inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
         inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float)swapChain.getExtent().width;
-        viewport.height = (float)swapChain.getExtent().height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        VkRect2D scissor{};
-        scissor.offset = { 0, 0 };
-        scissor.extent = swapChain.getExtent();
-
+        // Set at record time so the pipeline does not depend on the swap chain extent
         VkPipelineViewportStateCreateInfo viewportState{};
         viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewportState.viewportCount = 1;
-        viewportState.pViewports = &viewport;
         viewportState.scissorCount = 1;
-        viewportState.pScissors = &scissor;
+
+        std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+        dynamicState.pDynamicStates = dynamicStates.data();
 
         VkPipelineRasterizationStateCreateInfo rasterizer{};
         rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -138,10 +218,15 @@ private:
         colorBlending.blendConstants[2] = 0.0f;
         colorBlending.blendConstants[3] = 0.0f;
 
+        std::vector<VkDescriptorSetLayout> setLayouts = { descriptorSetLayout };
+        if (bindless) {
+            setLayouts.push_back(bindlessTable.getLayout());
+        }
+
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 1;
-        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
 
         if (vkCreatePipelineLayout(device.getLogicalDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout!");
@@ -158,20 +243,22 @@ private:
         pipelineInfo.pMultisampleState = &multisampling;
         pipelineInfo.pDepthStencilState = &depthStencil;
         pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.pDynamicState = &dynamicState;
         pipelineInfo.layout = pipelineLayout;
         pipelineInfo.renderPass = renderPass;
         pipelineInfo.subpass = 0;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-        if (vkCreateGraphicsPipelines(device.getLogicalDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+        if (device.getPipelineCache().createGraphicsPipeline(device.getLogicalDevice(), pipelineInfo, graphicsPipeline) != VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics pipeline!");
         }
 
         vkDestroyShaderModule(device.getLogicalDevice(), fragShaderModule.get(), nullptr);
         vkDestroyShaderModule(device.getLogicalDevice(), vertShaderModule.get(), nullptr);
     }
+    // Recorded every frame, so one per frame in flight independent of the swap chain
     void createCommandBuffers() override {
-        commandBuffers.resize(swapChain.getFramebuffers().size());
+        commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -182,185 +269,478 @@ private:
         if (vkAllocateCommandBuffers(device.getLogicalDevice(), &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
             throw std::runtime_error("failed to allocate command buffers!");
         }
+    }
+    VkCommandBuffer recordCommandBuffer(uint32_t imageIndex) override {
+        VkCommandBuffer commandBuffer = commandBuffers[currentFrame];
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording command buffer!");
+        }
 
-        for (size_t i = 0; i < commandBuffers.size(); i++) {
-            VkCommandBufferBeginInfo beginInfo{};
-            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        gpuProfiler.beginFrame(device, commandBuffer, static_cast<uint32_t>(currentFrame));
+        {
+            GpuProfileScope frameScope(gpuProfiler, commandBuffer, "Frame");
 
-            if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-                throw std::runtime_error("failed to begin recording command buffer!");
+            frameGraph.setImage(swapChainTarget, swapChain.getImages()[imageIndex], swapChain.getImageViews()[imageIndex].get());
+            if (gpuCulling) {
+                frameGraph.setBuffer(indirectCommands, gpuCuller.getCommandBuffer(static_cast<uint32_t>(currentFrame)));
+                frameGraph.setBuffer(indirectCount, gpuCuller.getCountBuffer(static_cast<uint32_t>(currentFrame)));
             }
+            frameGraph.execute(device, commandBuffer);
+        }
 
-            VkRenderPassBeginInfo renderPassInfo{};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = renderPass;
-            renderPassInfo.framebuffer = swapChain.getFramebuffers()[i];
-            renderPassInfo.renderArea.offset = { 0, 0 };
-            renderPassInfo.renderArea.extent = swapChain.getExtent();
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
 
-            std::array<VkClearValue, 2> clearValues{};
-            clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-            clearValues[1].depthStencil = { 1.0f, 0 };
+        return commandBuffer;
+    }
+    // The graph owns the attachments and framebuffers, the base render pass is only kept for pipeline compatibility
+    void createColorResources() override {}
+    void createDepthResources() override {}
+    void createFramebuffers() override {}
+    void onSwapChainRecreated() override {
+        auto retired = std::make_shared<VulkanRenderGraph>(std::move(frameGraph));
+        deletionQueue.push(submittedFrameSerial, [this, retired]() {
+            retired->destroy(device);
+        });
+        buildFrameGraph();
+    }
+    // Frames in flight finish with the old pipelines, the next recorded frame uses the new ones
+    void onShadersReloaded(const std::vector<ShaderHandle>& shaders) override {
+        for (ShaderHandle shader : shaders) {
+            if (shader == vertexShader || shader == fragmentShader) {
+                VkDevice logicalDevice = device.getLogicalDevice();
+                VkPipeline oldPipeline = graphicsPipeline;
+                VkPipelineLayout oldPipelineLayout = pipelineLayout;
+                deletionQueue.push(submittedFrameSerial, [logicalDevice, oldPipeline, oldPipelineLayout]() {
+                    vkDestroyPipeline(logicalDevice, oldPipeline, nullptr);
+                    vkDestroyPipelineLayout(logicalDevice, oldPipelineLayout, nullptr);
+                });
+                createGraphicsPipeline();
+                break;
+            }
+        }
+        if (gpuCulling && std::find(shaders.begin(), shaders.end(), cullShader) != shaders.end()) {
+            gpuCuller.reloadShader(device, shaderManager.getCode(cullShader), deletionQueue, submittedFrameSerial);
+        }
+    }
+    // Optional GPU cull pass, then the main pass drawing into transient MSAA color and depth and resolving into the
+    // swap chain image. Attachments are sized to the swap chain, so the graph is rebuilt with it.
+    void buildFrameGraph() {
+        frameGraph = VulkanRenderGraph();
+        frameGraph.setProfiler(&gpuProfiler);
+        VkExtent2D extent = swapChain.getExtent();
+
+        RenderGraphImageDesc colorDesc{ swapChain.getImageFormat(), extent, msaaSamples,
+            VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT };
+        RenderGraphImageDesc depthDesc{ Utils::findDepthFormat(device.getPhysicalDevice()), extent, msaaSamples,
+            VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT };
+        RenderGraphImageDesc targetDesc{ swapChain.getImageFormat(), extent, VK_SAMPLE_COUNT_1_BIT, 0, VK_IMAGE_ASPECT_COLOR_BIT };
+
+        RenderGraphResource color = frameGraph.createImage("color", colorDesc);
+        RenderGraphResource depth = frameGraph.createImage("depth", depthDesc);
+        // The acquire semaphore is waited on at the color attachment output stage
+        RenderGraphState targetFinal = swapChain.isOffscreen()
+            ? RenderGraphState{ swapChain.getFinalLayout(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT }
+            : RenderGraphState{ swapChain.getFinalLayout(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0 };
+        swapChainTarget = frameGraph.importImage("swap chain", targetDesc,
+            { VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 }, targetFinal);
+
+        if (gpuCulling) {
+            // The frame's previous use of its buffers finished before its fence, the visible count is read back on the host
+            indirectCommands = frameGraph.importBuffer("indirect commands", {}, {});
+            indirectCount = frameGraph.importBuffer("indirect count", {}, { VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT });
+
+            uint32_t cullPass = frameGraph.addPass("cull", RenderGraphPassType::Compute, [this](RenderGraphContext& context) {
+                gpuCuller.cull(context.commandBuffer, static_cast<uint32_t>(currentFrame), frustum);
+                lastCulledFrame = static_cast<uint32_t>(currentFrame);
+                lastCulledFrustum = frustum;
+                gpuCullingRan = true;
+            });
+            frameGraph.write(cullPass, indirectCommands, RenderGraphUsage::StorageWrite);
+            frameGraph.write(cullPass, indirectCount, RenderGraphUsage::StorageWrite);
+        }
 
-            renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-            renderPassInfo.pClearValues = clearValues.data();
+        uint32_t mainPass = frameGraph.addPass("main", RenderGraphPassType::Graphics, [this](RenderGraphContext& context) {
+            recordMainPass(context);
+        });
+        VkClearValue clearColor{};
+        clearColor.color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+        VkClearValue clearDepth{};
+        clearDepth.depthStencil = { 1.0f, 0 };
+        frameGraph.addColorAttachment(mainPass, color, &clearColor);
+        frameGraph.setDepthAttachment(mainPass, depth, &clearDepth);
+        frameGraph.addResolveAttachment(mainPass, swapChainTarget);
+        if (gpuCulling) {
+            frameGraph.read(mainPass, indirectCommands, RenderGraphUsage::Indirect);
+            frameGraph.read(mainPass, indirectCount, RenderGraphUsage::Indirect);
+        }
+        else {
+            frameGraph.setSecondaryContents(mainPass);
+        }
 
-            vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        frameGraph.compile(device);
+        if (!frameGraphReported) {
+            frameGraphReported = true;
+            const RenderGraphStats& stats = frameGraph.getStats();
+            std::cout << "Render graph: " << stats.passCount - stats.culledPassCount << " of " << stats.passCount << " passes, "
+                << stats.barrierBatchCount << " barrier batches (" << stats.imageBarrierCount << " image barriers) per frame, "
+                << stats.transientImageCount << " transient images in " << stats.allocatedBytes / 1024 << " KiB ("
+                << stats.transientBytes / 1024 << " KiB unaliased)" << std::endl;
+        }
+    }
+    void recordMainPass(RenderGraphContext& context) {
+        if (gpuCulling) {
+            vkCmdBindPipeline(context.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+            setViewportAndScissor(context.commandBuffer);
 
-            vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+            model.bind(context.commandBuffer);
+            VkBuffer instanceBuffers[] = { gpuInstanceBuffer.getBuffer() };
+            VkDeviceSize instanceOffsets[] = { 0 };
+            vkCmdBindVertexBuffers(context.commandBuffer, InstanceData::BINDING, 1, instanceBuffers, instanceOffsets);
 
-            VkBuffer vertexBuffers[] = { model.getVertexBuffer() };
-            VkDeviceSize offsets[] = { 0 };
-            vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
+            bindDescriptorSets(context.commandBuffer);
 
-            vkCmdBindIndexBuffer(commandBuffers[i], model.getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            gpuCuller.draw(context.commandBuffer, static_cast<uint32_t>(currentFrame));
+            return;
+        }
 
-            vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
+        VkCommandBufferInheritanceInfo inheritance{};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass = context.renderPass;
+        inheritance.subpass = 0;
+        inheritance.framebuffer = context.framebuffer;
+
+        uint32_t visibleCount = static_cast<uint32_t>(visibleObjects.size());
+        uint32_t threadCount = recorder.getThreadCount();
+        uint32_t instancesPerDraw = std::max(MIN_INSTANCES_PER_DRAW, (visibleCount + threadCount - 1) / threadCount);
+
+        secondaryCommandBuffers.clear();
+        recorder.beginFrame(device, static_cast<uint32_t>(currentFrame));
+        recorder.record(device, inheritance, visibleCount, [this](VkCommandBuffer secondary, uint32_t begin, uint32_t end) {
+            recordObjects(secondary, begin, end);
+        }, secondaryCommandBuffers, instancesPerDraw);
+
+        // Everything can be culled, executing zero secondaries is invalid
+        if (!secondaryCommandBuffers.empty()) {
+            vkCmdExecuteCommands(context.commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+        }
+    }
+    // Secondaries inherit nothing but the render pass, so every range binds its own state.
+    // [begin, end) indexes the visible instances written for this frame.
+    void recordObjects(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        setViewportAndScissor(commandBuffer);
 
-            vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(model.getIndices().size()), 1, 0, 0, 0);
+        model.bind(commandBuffer);
+        instanceBuffer.bind(commandBuffer);
 
-            vkCmdEndRenderPass(commandBuffers[i]);
+        bindDescriptorSets(commandBuffer);
 
-            if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to record command buffer!");
+        model.draw(commandBuffer, end - begin, firstVisibleInstance + begin);
+    }
+    // The bindless set is the same for every frame and draw, only the per frame set changes
+    void bindDescriptorSets(VkCommandBuffer commandBuffer) {
+        std::array<VkDescriptorSet, 2> sets = { frameDescriptorSet, bindless ? bindlessTable.getSet() : VK_NULL_HANDLE };
+        uint32_t setCount = bindless ? 2 : 1;
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, setCount, sets.data(), 1, &uniformOffset);
+    }
+    void createObjects() {
+        uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(objectCount))));
+        float center = (side - 1) * 0.5f;
+
+        objectTransforms.resize(objectCount);
+        for (uint32_t i = 0; i < objectCount; i++) {
+            glm::vec3 offset((i % side - center) * OBJECT_SPACING, (i / side - center) * OBJECT_SPACING, 0.0f);
+            objectTransforms[i] = glm::translate(glm::mat4(1.0f), offset);
+            nearestObjectDistance = std::min(nearestObjectDistance, glm::length(CAMERA_POSITION - offset));
+        }
+        objectBounds.resize(objectCount);
+    }
+    // Every copy shares the model rotation, so the rotated box is computed once and only moved per object
+    void cullObjects(const glm::mat4& rotation, const Frustum& frustum) {
+        Bounds rotated = model.getBounds().transformed(rotation);
+        for (uint32_t i = 0; i < objectCount; i++) {
+            objectBounds.set(i, glm::vec3(objectTransforms[i][3]) + rotated.center, rotated.extent);
+        }
+        FrustumCuller::cull(frustum, objectBounds, visibleObjects);
+
+        instanceBuffer.beginFrame(static_cast<uint32_t>(currentFrame));
+        InstanceData* instances = instanceBuffer.allocate(static_cast<uint32_t>(visibleObjects.size()), firstVisibleInstance);
+        for (size_t i = 0; i < visibleObjects.size(); i++) {
+            instances[i].model = objectTransforms[visibleObjects[i]];
+            instances[i].color = glm::vec4(1.0f);
+            instances[i].materialIndex = materialIndex;
+        }
+    }
+    // Static instance data plus one cull object per copy. The model spins around its origin every frame, so the
+    // sphere is centered on that origin and grown to contain every rotation, the object buffer never changes.
+    void createGpuCulling() {
+        if (!VulkanGpuCuller::isSupported(device)) {
+            std::cout << "GPU culling unsupported on this device, culling on the CPU" << std::endl;
+            gpuCulling = false;
+            return;
+        }
+        cullShader = shaderManager.load("shaders/cullShader.comp");
+
+        const Bounds& bounds = model.getBounds();
+        float radius = glm::length(bounds.center) + bounds.radius;
+
+        std::vector<InstanceData> instances(objectCount);
+        std::vector<GpuCullObject> gpuObjects(objectCount);
+        for (uint32_t i = 0; i < objectCount; i++) {
+            instances[i].model = objectTransforms[i];
+            instances[i].color = glm::vec4(1.0f);
+            instances[i].materialIndex = materialIndex;
+
+            gpuObjects[i].sphere = glm::vec4(glm::vec3(objectTransforms[i][3]), radius);
+            gpuObjects[i].indexCount = model.getIndexCount();
+            gpuObjects[i].firstIndex = 0;
+            gpuObjects[i].vertexOffset = 0;
+            gpuObjects[i].firstInstance = i;
+        }
+
+        VkDeviceSize instanceBufferSize = sizeof(InstanceData) * objectCount;
+        gpuInstanceBuffer.create(device, instanceBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        uploadManager.uploadBuffer(device, gpuInstanceBuffer, instances.data(), instanceBufferSize,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+
+        gpuCuller.create(device, uploadManager, gpuObjects, MAX_FRAMES_IN_FLIGHT, shaderManager.getCode(cullShader));
+        uploadManager.wait(device, uploadManager.submit(device));
+
+        std::cout << "GPU culling " << objectCount << " objects, "
+            << (gpuCuller.isCompacting() ? "compacted with vkCmdDrawIndexedIndirectCount" : "one indirect slot per object") << std::endl;
+    }
+    // The device is idle by now, checks the last frame's draw count against the same sphere test on the CPU. Spheres
+    // within rounding distance of a plane may land on either side, so they are the only allowed difference.
+    bool reportGpuCulling() {
+        const Bounds& bounds = model.getBounds();
+        float radius = glm::length(bounds.center) + bounds.radius;
+
+        const float tolerance = 1e-4f * std::max(1.0f, radius);
+        uint32_t expected = 0;
+        uint32_t borderline = 0;
+        for (uint32_t i = 0; i < objectCount; i++) {
+            glm::vec3 center = glm::vec3(objectTransforms[i][3]);
+            bool visible = true;
+            bool nearPlane = false;
+            for (const auto& plane : lastCulledFrustum.planes) {
+                float distance = glm::dot(glm::vec3(plane), center) + plane.w + radius;
+                visible = visible && distance >= 0.0f;
+                nearPlane = nearPlane || std::abs(distance) <= tolerance;
             }
+            expected += visible ? 1 : 0;
+            borderline += nearPlane ? 1 : 0;
         }
+
+        uint32_t visibleCount = gpuCuller.getVisibleCount(lastCulledFrame);
+        uint32_t difference = visibleCount > expected ? visibleCount - expected : expected - visibleCount;
+        bool matched = difference <= borderline;
+        std::cout << "GPU culling: " << visibleCount << " of " << objectCount << " objects visible in the last frame (CPU reference "
+            << expected << ", " << borderline << " on a plane), " << (matched ? "match" : "MISMATCH") << std::endl;
+        return matched;
     }
     void updateUniformBuffers(uint32_t currentImage) override {
-        static auto startTime = std::chrono::high_resolution_clock::now();
+        if (animationFrame == 0) {
+            animationStart = std::chrono::high_resolution_clock::now();
+        }
+        float time = fixedTimeStep > 0.0f
+            ? fixedTimeStep * animationFrame
+            : std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - animationStart).count();
+        animationFrame++;
 
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+        glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
 
         UniformBufferObject ubo{};
-        ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        ubo.model = rotation * model.getDequantizeTransform();
+        ubo.view = glm::lookAt(CAMERA_POSITION, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
         ubo.proj = glm::perspective(glm::radians(45.0f), swapChain.getExtent().width / (float)swapChain.getExtent().height, 0.1f, 10.0f);
-        ubo.proj[1][1] *= -1;
 
-        void* data;
-        vkMapMemory(device.getLogicalDevice(), uniformBuffers[currentImage].getMemory(), 0, sizeof(ubo), 0, &data);
-        memcpy(data, &ubo, sizeof(ubo));
-        vkUnmapMemory(device.getLogicalDevice(), uniformBuffers[currentImage].getMemory());
-    }
-    void createUniformBuffers() override {
-        VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+        // The texture is an atlas over the whole model, so the closest copy's projected diameter is the detail it needs
+        float screenPixels = model.getBounds().radius * ubo.proj[1][1] * swapChain.getExtent().height / std::max(nearestObjectDistance, 0.1f);
+        {
+            ProfileScope scope("Texture streaming");
+            textureStreamer.requestResolution(textureHandle, screenPixels);
+            textureStreamer.update(device, deletionQueue, submittedFrameSerial);
+        }
+        writeFrameDescriptorSet();
 
-        uniformBuffers.resize(swapChain.getImages().size());
+        ubo.proj[1][1] *= -1;
 
-        for (size_t i = 0; i < swapChain.getImages().size(); i++) {
-            uniformBuffers[i].create(device,
-                bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        frustum = Frustum::fromViewProjection(ubo.proj * ubo.view);
+        if (!gpuCulling) {
+            ProfileScope scope("CPU culling");
+            cullObjects(rotation, frustum);
         }
+
+        uniformRing.beginFrame(static_cast<uint32_t>(currentFrame));
+        uniformOffset = uniformRing.push(ubo);
     }
+    void createUniformBuffers() override {
+        uniformRing.create(device, UNIFORM_RING_FRAME_SIZE, MAX_FRAMES_IN_FLIGHT);
+    }
+    // Runs before the pipeline is created, which is when the bindless layout first has to exist
     void createDescriptorSetLayout() override {
+        if (bindless && !VulkanBindlessTable::isSupported(device)) {
+            std::cout << "Descriptor indexing unsupported on this device, binding the texture per frame" << std::endl;
+            bindless = false;
+        }
+        if (bindless) {
+            bindlessTable.create(device, MAX_FRAMES_IN_FLIGHT);
+        }
+
         VkDescriptorSetLayoutBinding uboLayoutBinding{};
         uboLayoutBinding.binding = 0;
         uboLayoutBinding.descriptorCount = 1;
-        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         uboLayoutBinding.pImmutableSamplers = nullptr;
         uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
+        // The material buffer takes the texture's place when textures come from the bindless set
         VkDescriptorSetLayoutBinding samplerLayoutBinding{};
         samplerLayoutBinding.binding = 1;
         samplerLayoutBinding.descriptorCount = 1;
-        samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        samplerLayoutBinding.descriptorType = getMaterialDescriptorType();
         samplerLayoutBinding.pImmutableSamplers = nullptr;
         samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-        std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
-        VkDescriptorSetLayoutCreateInfo layoutInfo{};
-        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-        layoutInfo.pBindings = bindings.data();
-
-        if (vkCreateDescriptorSetLayout(device.getLogicalDevice(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create descriptor set layout!");
-        }
+        descriptorSetLayout = descriptorLayoutCache.get(device, { uboLayoutBinding, samplerLayoutBinding });
     }
-    void createDescriptorPool() override {
-        std::array<VkDescriptorPoolSize, 2> poolSizes{};
-        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[0].descriptorCount = static_cast<uint32_t>(swapChain.getImages().size());
-        poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[1].descriptorCount = static_cast<uint32_t>(swapChain.getImages().size());
-
-        VkDescriptorPoolCreateInfo poolInfo{};
-        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-        poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = static_cast<uint32_t>(swapChain.getImages().size());
-
-        if (vkCreateDescriptorPool(device.getLogicalDevice(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create descriptor pool!");
-        }
+    // The per frame set is written in one call from a FrameDescriptors, binding 1 reads whichever member the mode uses
+    void createDescriptorTemplate() {
+        std::vector<VkDescriptorUpdateTemplateEntry> entries = {
+            VulkanDescriptorUpdateTemplate::makeEntry(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, offsetof(FrameDescriptors, uniforms)),
+            VulkanDescriptorUpdateTemplate::makeEntry(1, getMaterialDescriptorType(),
+                bindless ? offsetof(FrameDescriptors, materials) : offsetof(FrameDescriptors, texture))
+        };
+        descriptorTemplate.create(device, descriptorSetLayout, entries);
     }
-    void createDescriptorSets() override {
-        std::vector<VkDescriptorSetLayout> layouts(swapChain.getImages().size(), descriptorSetLayout);
-        VkDescriptorSetAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocInfo.descriptorPool = descriptorPool;
-        allocInfo.descriptorSetCount = static_cast<uint32_t>(swapChain.getImages().size());
-        allocInfo.pSetLayouts = layouts.data();
-
-        descriptorSets.resize(swapChain.getImages().size());
-        if (vkAllocateDescriptorSets(device.getLogicalDevice(), &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate descriptor sets!");
+    // Only the mip tail of a cooked texture is uploaded here, finer levels stream in once frames are running
+    void createTextureImage() {
+        textureStreamer.create(device, uploadManager, jobSystem, textureBudget);
+        textureHandle = textureStreamer.add(device, TEXTURE_PATH, VK_FORMAT_R8G8B8A8_SRGB);
+        mipLevels = textureStreamer.getLevelCount(textureHandle);
+    }
+    VkDescriptorType getMaterialDescriptorType() {
+        return bindless ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    }
+    // One material for every copy of the model, white so the bindless path draws exactly what the per frame path does
+    void createBindlessMaterials() {
+        bindlessTable.setSampler(device, textureSampler.get());
+        bindlessTexture = bindlessTable.addTexture(device, textureStreamer.getImageView(textureHandle));
+        bindlessTextureGeneration = textureStreamer.getGeneration(textureHandle);
+        materialIndex = bindlessTable.addMaterial(glm::vec4(1.0f), bindlessTexture);
+        std::cout << "Bindless textures: " << bindlessTable.getTextureCapacity() << " slots" << std::endl;
+    }
+    // Each frame allocates its set from the frame's pool, which was reset after its fence wait, so whatever view the
+    // streamer published last is picked up without tracking which sets are stale. Bindless frames keep their own
+    // material copy instead, a new view gets a new slot and only this frame's copy points at it.
+    void writeFrameDescriptorSet() {
+        FrameDescriptors descriptors{};
+        descriptors.uniforms.buffer = uniformRing.getBuffer();
+        descriptors.uniforms.offset = 0;
+        descriptors.uniforms.range = sizeof(UniformBufferObject);
+
+        if (bindless) {
+            uint64_t generation = textureStreamer.getGeneration(textureHandle);
+            if (bindlessTextureGeneration != generation) {
+                bindlessTextureGeneration = generation;
+                bindlessTable.setTexture(device, deletionQueue, submittedFrameSerial, bindlessTexture, textureStreamer.getImageView(textureHandle));
+            }
+            bindlessTable.beginFrame(static_cast<uint32_t>(currentFrame));
+            descriptors.materials = bindlessTable.getMaterialBufferInfo(static_cast<uint32_t>(currentFrame));
         }
-
-        for (size_t i = 0; i < swapChain.getImages().size(); i++) {
-            VkDescriptorBufferInfo bufferInfo{};
-            bufferInfo.buffer = uniformBuffers[i].getBuffer();
-            bufferInfo.offset = 0;
-            bufferInfo.range = sizeof(UniformBufferObject);
-
-            VkDescriptorImageInfo imageInfo{};
-            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfo.imageView = texture.getImageView();
-            imageInfo.sampler = textureSampler.get();
-
-            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[0].dstSet = descriptorSets[i];
-            descriptorWrites[0].dstBinding = 0;
-            descriptorWrites[0].dstArrayElement = 0;
-            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrites[0].descriptorCount = 1;
-            descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[1].dstSet = descriptorSets[i];
-            descriptorWrites[1].dstBinding = 1;
-            descriptorWrites[1].dstArrayElement = 0;
-            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrites[1].descriptorCount = 1;
-            descriptorWrites[1].pImageInfo = &imageInfo;
-
-            vkUpdateDescriptorSets(device.getLogicalDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+        else {
+            descriptors.texture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            descriptors.texture.imageView = textureStreamer.getImageView(textureHandle);
+            descriptors.texture.sampler = textureSampler.get();
         }
+
+        frameDescriptorSet = frameDescriptorAllocator.allocate(device, descriptorSetLayout);
+        descriptorTemplate.update(device, frameDescriptorSet, &descriptors);
     }
-    void createTextureImage() {
-        texture.create(device, TEXTURE_PATH, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+    void writeBenchmarkScene(std::ostream& out) override {
+        out << ", \"objects\": " << objectCount << ", \"gpuCulling\": " << (gpuCulling ? "true" : "false")
+            << ", \"bindless\": " << (bindless ? "true" : "false") << ", \"timeStep\": " << fixedTimeStep;
+    }
+    void writeBenchmarkMemory(std::ostream& out) override {
+        const TextureStreamerStats& stats = textureStreamer.getStats();
+        out << ", \"textureResidentBytes\": " << stats.residentBytes << ", \"texturePeakResidentBytes\": " << stats.peakResidentBytes;
+    }
+    void reportTextureStreaming() {
+        const TextureStreamerStats& stats = textureStreamer.getStats();
+        std::cout << "Texture streaming: level " << textureStreamer.getResidentLevel(textureHandle) << " of " << mipLevels << " resident, "
+            << stats.residentBytes / 1024 << " KiB resident (peak " << stats.peakResidentBytes / 1024 << " KiB) of "
+            << stats.budgetBytes / (1024 * 1024) << " MiB budget, " << stats.streamIns << " stream-ins ("
+            << stats.streamedBytes / 1024 << " KiB), " << stats.evictions << " evictions" << std::endl;
     }
     void createTextureSampler() {
         textureSampler.create(device, mipLevels);
     }
     void loadModel() {
-        model.load(device, MODEL_PATH);
+        model.load(device, uploadManager, jobSystem, MODEL_PATH, vertexLayout);
     }
 
 private:
-    std::vector<VulkanBuffer> uniformBuffers;
+    VulkanUniformRingBuffer uniformRing;
+    uint32_t uniformOffset = 0;
 
+    // Owned by the layout cache
     VkDescriptorSetLayout descriptorSetLayout;
-    VkDescriptorPool descriptorPool;
-    std::vector<VkDescriptorSet> descriptorSets;
+    VulkanDescriptorUpdateTemplate descriptorTemplate;
+    VkDescriptorSet frameDescriptorSet = VK_NULL_HANDLE;
 
-    uint32_t mipLevels;
-    VulkanTexture texture;
+    uint32_t mipLevels = 1;
+    VulkanTextureStreamer textureStreamer;
+    StreamedTextureHandle textureHandle = 0;
+    VkDeviceSize textureBudget = 0;
     VulkanSampler textureSampler;
 
+    bool bindless = true;
+    VulkanBindlessTable bindlessTable;
+    BindlessTextureHandle bindlessTexture = 0;
+    uint64_t bindlessTextureGeneration = 0;
+    uint32_t materialIndex = 0;
+
     Model model;
+
+    float fixedTimeStep = 0.0f;
+    VertexLayout vertexLayout = VertexLayout::Snorm16Position;
+    uint64_t animationFrame = 0;
+    std::chrono::high_resolution_clock::time_point animationStart;
+
+    uint32_t objectCount = 1;
+    std::vector<glm::mat4> objectTransforms;
+    float nearestObjectDistance = std::numeric_limits<float>::max();
+    CullingBounds objectBounds;
+    std::vector<uint32_t> visibleObjects;
+    VulkanInstanceBuffer instanceBuffer;
+    uint32_t firstVisibleInstance = 0;
+    Frustum frustum;
+
+    bool gpuCulling = false;
+    VulkanGpuCuller gpuCuller;
+    VulkanBuffer gpuInstanceBuffer;
+    uint32_t lastCulledFrame = 0;
+    Frustum lastCulledFrustum;
+    bool gpuCullingRan = false;
+
+    VulkanCommandRecorder recorder;
+    std::vector<VkCommandBuffer> secondaryCommandBuffers;
+
+    ShaderHandle vertexShader = 0;
+    ShaderHandle fragmentShader = 0;
+    ShaderHandle cullShader = UINT32_MAX;
+
+    VulkanRenderGraph frameGraph;
+    RenderGraphResource swapChainTarget = 0;
+    RenderGraphResource indirectCommands = 0;
+    RenderGraphResource indirectCount = 0;
+    bool frameGraphReported = false;
 };
@@ -0,0 +1,157 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Declarations only, the implementation lives with the application
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include <stb_image.h>
+#endif
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb_image_resize.h>
+
+#include "Ktx2.h"
+
+namespace LightVulkan {
+    // Offline conversion of source images into block compressed KTX2 files with the whole mip chain baked in,
+    // so loading is a single copy with no decode, no blits and a quarter to an eighth of the RGBA8 footprint
+    namespace TextureCooker {
+        enum class Compression {
+            // BC3 when any texel is not fully opaque, BC1 otherwise
+            Auto,
+            BC1,
+            BC3
+        };
+
+        struct CookStats {
+            VkFormat format = VK_FORMAT_UNDEFINED;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t levelCount = 0;
+            uint64_t uncompressedBytes = 0;
+            uint64_t cookedBytes = 0;
+            double milliseconds = 0.0;
+        };
+
+        // Edge texels are repeated for levels smaller than a block
+        inline void compressLevel(const uint8_t* rgba, uint32_t width, uint32_t height, bool alpha, std::vector<uint8_t>& blocks) {
+            uint32_t blockBytes = alpha ? 16 : 8;
+            uint32_t blocksX = (width + 3) / 4;
+            uint32_t blocksY = (height + 3) / 4;
+            blocks.resize(static_cast<size_t>(blocksX) * blocksY * blockBytes);
+
+            uint8_t block[16 * 4];
+            uint8_t* dst = blocks.data();
+            for (uint32_t by = 0; by < blocksY; by++) {
+                for (uint32_t bx = 0; bx < blocksX; bx++) {
+                    for (uint32_t y = 0; y < 4; y++) {
+                        uint32_t srcY = std::min(by * 4 + y, height - 1);
+                        for (uint32_t x = 0; x < 4; x++) {
+                            uint32_t srcX = std::min(bx * 4 + x, width - 1);
+                            memcpy(&block[(y * 4 + x) * 4], &rgba[(static_cast<size_t>(srcY) * width + srcX) * 4], 4);
+                        }
+                    }
+                    stb_compress_dxt_block(dst, block, alpha ? 1 : 0, STB_DXT_HIGHQUAL);
+                    dst += blockBytes;
+                }
+            }
+        }
+        inline bool hasAlpha(const uint8_t* rgba, size_t texelCount) {
+            for (size_t i = 0; i < texelCount; i++) {
+                if (rgba[i * 4 + 3] != 255) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        // srgb selects both the output format and gamma correct downsampling
+        inline CookStats cook(const std::string& sourcePath, const std::string& cookedPath, bool srgb, Compression compression = Compression::Auto) {
+            auto start = std::chrono::high_resolution_clock::now();
+
+            int texWidth, texHeight, texChannels;
+            stbi_uc* pixels = stbi_load(sourcePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+            if (!pixels) {
+                throw std::runtime_error("failed to load texture image!");
+            }
+
+            uint32_t width = static_cast<uint32_t>(texWidth);
+            uint32_t height = static_cast<uint32_t>(texHeight);
+            std::vector<uint8_t> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+            stbi_image_free(pixels);
+
+            bool alpha = compression == Compression::BC3 ||
+                (compression == Compression::Auto && hasAlpha(level.data(), static_cast<size_t>(width) * height));
+
+            CookStats stats;
+            if (alpha) {
+                stats.format = srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+            }
+            else {
+                stats.format = srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+            }
+            stats.width = width;
+            stats.height = height;
+            stats.levelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+
+            // Each level is filtered from the one above it, the same chain the runtime blits used to build
+            std::vector<std::vector<uint8_t>> levels(stats.levelCount);
+            std::vector<uint8_t> next;
+            uint32_t levelWidth = width;
+            uint32_t levelHeight = height;
+            for (uint32_t i = 0; i < stats.levelCount; i++) {
+                compressLevel(level.data(), levelWidth, levelHeight, alpha, levels[i]);
+                stats.uncompressedBytes += static_cast<uint64_t>(levelWidth) * levelHeight * 4;
+                stats.cookedBytes += levels[i].size();
+
+                if (i + 1 == stats.levelCount) {
+                    break;
+                }
+
+                uint32_t nextWidth = std::max(1u, levelWidth / 2);
+                uint32_t nextHeight = std::max(1u, levelHeight / 2);
+                next.resize(static_cast<size_t>(nextWidth) * nextHeight * 4);
+                int resized = srgb
+                    ? stbir_resize_uint8_srgb(level.data(), levelWidth, levelHeight, 0, next.data(), nextWidth, nextHeight, 0, 4, 3, 0)
+                    : stbir_resize_uint8(level.data(), levelWidth, levelHeight, 0, next.data(), nextWidth, nextHeight, 0, 4);
+                if (!resized) {
+                    throw std::runtime_error("failed to downsample texture mip level!");
+                }
+                level.swap(next);
+                levelWidth = nextWidth;
+                levelHeight = nextHeight;
+            }
+
+            if (!Ktx2::write(cookedPath, stats.format, width, height, levels)) {
+                throw std::runtime_error("failed to write cooked texture!");
+            }
+
+            stats.milliseconds = std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+            return stats;
+        }
+        inline void cookAndReport(const std::string& sourcePath, bool srgb = true) {
+            std::string cookedPath = Ktx2::getCookedPath(sourcePath);
+            CookStats stats = cook(sourcePath, cookedPath, srgb);
+
+            std::cout << "Cooked " << sourcePath << " -> " << cookedPath << std::endl;
+            std::cout << "  " << stats.width << "x" << stats.height << ", " << stats.levelCount << " levels, "
+                << (Ktx2::getBlockBytes(stats.format) == 16 ? "BC3" : "BC1") << (srgb ? " sRGB" : " linear") << std::endl;
+            std::cout << "  RGBA8 with mips: " << stats.uncompressedBytes / 1024 << " KiB, cooked: " << stats.cookedBytes / 1024 << " KiB ("
+                << (stats.cookedBytes > 0 ? static_cast<double>(stats.uncompressedBytes) / stats.cookedBytes : 0.0) << "x smaller)" << std::endl;
+            std::cout << "  " << stats.milliseconds << " ms" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace LightVulkan {
+    struct Vertex {
+        glm::vec3 pos;
+        glm::vec3 color;
+        glm::vec2 texCoord;
+
+        static VkVertexInputBindingDescription getBindingDescription() {
+            VkVertexInputBindingDescription bindingDescription{};
+            bindingDescription.binding = 0;
+            bindingDescription.stride = sizeof(Vertex);
+            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+            return bindingDescription;
+        }
+
+        static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
+            std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+
+            attributeDescriptions[0].binding = 0;
+            attributeDescriptions[0].location = 0;
+            attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+            attributeDescriptions[0].offset = offsetof(Vertex, pos);
+
+            attributeDescriptions[1].binding = 0;
+            attributeDescriptions[1].location = 1;
+            attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+            attributeDescriptions[1].offset = offsetof(Vertex, color);
+
+            attributeDescriptions[2].binding = 0;
+            attributeDescriptions[2].location = 2;
+            attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
+            attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
+
+            return attributeDescriptions;
+        }
+
+        bool operator==(const Vertex& other) const {
+            return pos == other.pos && color == other.color && texCoord == other.texCoord;
+        }
+    };
+
+    // Per instance data read at VK_VERTEX_INPUT_RATE_INSTANCE from binding 1. A mat4 attribute takes four locations,
+    // one per column, so the transform occupies 3 to 6.
+    struct InstanceData {
+        glm::mat4 model;
+        glm::vec4 color;
+        // Into the bindless material table, ignored by the non bindless shaders
+        uint32_t materialIndex = 0;
+        uint32_t padding[3] = {};
+
+        static const uint32_t BINDING = 1;
+
+        static VkVertexInputBindingDescription getBindingDescription() {
+            VkVertexInputBindingDescription bindingDescription{};
+            bindingDescription.binding = BINDING;
+            bindingDescription.stride = sizeof(InstanceData);
+            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+            return bindingDescription;
+        }
+
+        static std::array<VkVertexInputAttributeDescription, 6> getAttributeDescriptions() {
+            std::array<VkVertexInputAttributeDescription, 6> attributeDescriptions{};
+
+            for (uint32_t column = 0; column < 4; column++) {
+                attributeDescriptions[column].binding = BINDING;
+                attributeDescriptions[column].location = 3 + column;
+                attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+                attributeDescriptions[column].offset = static_cast<uint32_t>(offsetof(InstanceData, model) + column * sizeof(glm::vec4));
+            }
+
+            attributeDescriptions[4].binding = BINDING;
+            attributeDescriptions[4].location = 7;
+            attributeDescriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[4].offset = offsetof(InstanceData, color);
+
+            attributeDescriptions[5].binding = BINDING;
+            attributeDescriptions[5].location = 8;
+            attributeDescriptions[5].format = VK_FORMAT_R32_UINT;
+            attributeDescriptions[5].offset = offsetof(InstanceData, materialIndex);
+
+            return attributeDescriptions;
+        }
+    };
+
+    // Mixes every component bit pattern. -0.0f is folded into 0.0f because Vertex::operator== treats them as equal.
+    inline uint64_t hashVertex(const Vertex& vertex) {
+        static_assert(sizeof(Vertex) == 8 * sizeof(uint32_t), "hashVertex expects eight packed floats");
+
+        uint32_t bits[8];
+        memcpy(bits, &vertex, sizeof(bits));
+
+        uint64_t hash = 0x9E3779B97F4A7C15ull;
+        for (uint32_t i = 0; i < 8; i += 2) {
+            uint64_t lo = bits[i] == 0x80000000u ? 0 : bits[i];
+            uint64_t hi = bits[i + 1] == 0x80000000u ? 0 : bits[i + 1];
+            hash = (hash ^ (lo | (hi << 32))) * 0xBF58476D1CE4E5B9ull;
+            hash ^= hash >> 29;
+        }
+        hash *= 0x94D049BB133111EBull;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    struct VertexHash {
+        size_t operator()(Vertex const& vertex) const noexcept {
+            return static_cast<size_t>(hashVertex(vertex));
+        }
+    };
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Vertex.h"
+
+namespace LightVulkan {
+    enum class VertexLayout {
+        // Vertex as parsed, 32 bytes
+        Float32,
+        // PackedVertex with half float positions, 12 bytes
+        HalfPosition,
+        // PackedVertex with 16-bit normalized positions, 12 bytes. Uniform precision over the bounds
+        Snorm16Position
+    };
+
+    // Positions are stored relative to the mesh bounds, remapped to [-1, 1]. Only position and UV are kept,
+    // the parser always produced a white color so the packed shader variant writes it as a constant.
+    struct PackedVertex {
+        uint16_t pos[4];
+        uint16_t texCoord[2];
+
+        static VkVertexInputBindingDescription getBindingDescription() {
+            VkVertexInputBindingDescription bindingDescription{};
+            bindingDescription.binding = 0;
+            bindingDescription.stride = sizeof(PackedVertex);
+            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+            return bindingDescription;
+        }
+
+        // Three component 16-bit formats are rarely supported for vertex fetch, pos[3] is padding
+        static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions(VertexLayout layout) {
+            std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+
+            attributeDescriptions[0].binding = 0;
+            attributeDescriptions[0].location = 0;
+            attributeDescriptions[0].format = layout == VertexLayout::HalfPosition ?
+                VK_FORMAT_R16G16B16A16_SFLOAT : VK_FORMAT_R16G16B16A16_SNORM;
+            attributeDescriptions[0].offset = offsetof(PackedVertex, pos);
+
+            attributeDescriptions[1].binding = 0;
+            attributeDescriptions[1].location = 2;
+            attributeDescriptions[1].format = VK_FORMAT_R16G16_SFLOAT;
+            attributeDescriptions[1].offset = offsetof(PackedVertex, texCoord);
+
+            return attributeDescriptions;
+        }
+    };
+
+    // Maps packed positions in [-1, 1] back to model space, folded into the model matrix so the shader stays a plain transform
+    struct VertexQuantization {
+        glm::vec3 center = glm::vec3(0.0f);
+        glm::vec3 extent = glm::vec3(1.0f);
+
+        static VertexQuantization fromBounds(const Vertex* vertices, size_t count) {
+            VertexQuantization quantization;
+            if (count == 0) {
+                return quantization;
+            }
+
+            glm::vec3 minPos = vertices[0].pos;
+            glm::vec3 maxPos = vertices[0].pos;
+            for (size_t i = 1; i < count; i++) {
+                minPos = glm::min(minPos, vertices[i].pos);
+                maxPos = glm::max(maxPos, vertices[i].pos);
+            }
+
+            quantization.center = (minPos + maxPos) * 0.5f;
+            quantization.extent = (maxPos - minPos) * 0.5f;
+            for (int axis = 0; axis < 3; axis++) {
+                if (quantization.extent[axis] <= 0.0f) {
+                    quantization.extent[axis] = 1.0f;
+                }
+            }
+            return quantization;
+        }
+        glm::mat4 getDequantizeTransform() const {
+            return glm::scale(glm::translate(glm::mat4(1.0f), center), extent);
+        }
+    };
+
+    struct VertexInputDescription {
+        std::vector<VkVertexInputBindingDescription> bindings;
+        std::vector<VkVertexInputAttributeDescription> attributes;
+    };
+
+    namespace VertexLayouts {
+        inline uint32_t getStride(VertexLayout layout) {
+            return layout == VertexLayout::Float32 ? sizeof(Vertex) : sizeof(PackedVertex);
+        }
+        // Vertex data on binding 0 followed by InstanceData on binding 1
+        inline VertexInputDescription getInputDescription(VertexLayout layout) {
+            VertexInputDescription description;
+            if (layout == VertexLayout::Float32) {
+                auto attributes = Vertex::getAttributeDescriptions();
+                description.bindings.push_back(Vertex::getBindingDescription());
+                description.attributes.assign(attributes.begin(), attributes.end());
+            }
+            else {
+                auto attributes = PackedVertex::getAttributeDescriptions(layout);
+                description.bindings.push_back(PackedVertex::getBindingDescription());
+                description.attributes.assign(attributes.begin(), attributes.end());
+            }
+
+            auto instanceAttributes = InstanceData::getAttributeDescriptions();
+            description.bindings.push_back(InstanceData::getBindingDescription());
+            description.attributes.insert(description.attributes.end(), instanceAttributes.begin(), instanceAttributes.end());
+            return description;
+        }
+        // GLSL source, both packed layouts decode to floats in the input assembler and share one shader
+        inline const char* getVertexShaderPath(VertexLayout layout) {
+            return layout == VertexLayout::Float32 ? "shaders/shader.vert" : "shaders/packedShader.vert";
+        }
+        // Writes count vertices of the given layout into dst, which must hold count * getStride(layout) bytes
+        inline void pack(VertexLayout layout, const Vertex* vertices, size_t count, const VertexQuantization& quantization, void* dst) {
+            if (layout == VertexLayout::Float32) {
+                std::copy(vertices, vertices + count, static_cast<Vertex*>(dst));
+                return;
+            }
+
+            PackedVertex* packed = static_cast<PackedVertex*>(dst);
+            for (size_t i = 0; i < count; i++) {
+                glm::vec3 normalized = (vertices[i].pos - quantization.center) / quantization.extent;
+                for (int axis = 0; axis < 3; axis++) {
+                    float value = std::min(std::max(normalized[axis], -1.0f), 1.0f);
+                    packed[i].pos[axis] = layout == VertexLayout::HalfPosition ?
+                        glm::packHalf1x16(value) : glm::packSnorm1x16(value);
+                }
+                packed[i].pos[3] = layout == VertexLayout::HalfPosition ? glm::packHalf1x16(1.0f) : glm::packSnorm1x16(1.0f);
+                packed[i].texCoord[0] = glm::packHalf1x16(vertices[i].texCoord.x);
+                packed[i].texCoord[1] = glm::packHalf1x16(vertices[i].texCoord.y);
+            }
+        }
+    }
+}
@@ -14,6 +14,7 @@
 #include <stb_image.h>
 
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 #include <stdexcept>
 #include <algorithm>
@@ -36,22 +37,96 @@
 #include "VulkanSampler.h"
 #include "VulkanSyncObjects.h"
 #include "VulkanShaderModule.h"
+#include "ShaderManager.h"
+#include "VulkanUploadManager.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanDescriptors.h"
+#include "VulkanGpuProfiler.h"
+#include "Profiler.h"
+#include "FrameStats.h"
+#include "JobSystem.h"
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
+const uint32_t HEADLESS_IMAGE_COUNT = 3;
+
+const std::string PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+const std::string SHADER_CACHE_DIRECTORY = "shaders/cache";
+
+const double PROFILE_REPORT_INTERVAL = 2.0;
 
 namespace LightVulkan {
 
     class VulkanApplication {
     public:
         void run(std::string title) {
-            window.setUp(WIDTH, HEIGHT, title.c_str());
+            Profiler::get().setThreadName("Main");
+            window.setUp(width, height, title.c_str());
             initVulkan();
             mainLoop();
             cleanup();
         }
+        void runHeadless(uint32_t frameCount) {
+            headless = true;
+            Profiler::get().setThreadName("Main");
+            initVulkan();
+
+            auto startTime = std::chrono::high_resolution_clock::now();
+            for (uint32_t i = 0; i < frameCount; i++) {
+                {
+                    ProfileScope scope("Frame");
+                    drawFrame();
+                }
+                endFrame();
+            }
+            vkDeviceWaitIdle(device.getLogicalDevice());
+            auto endTime = std::chrono::high_resolution_clock::now();
+
+            float totalTime = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
+            runTime = totalTime;
+            std::cout << "Rendered " << frameCount << " offscreen frames in " << totalTime << " ms ("
+                << (frameCount > 0 ? totalTime / frameCount : 0.0f) << " ms/frame, "
+                << (frameCount > 0 ? recordTime / frameCount : 0.0) << " ms/frame recording)" << std::endl;
+
+            cleanup();
+        }
+        // Including the main thread, 0 uses every hardware thread
+        void setJobThreadCount(uint32_t count) {
+            jobThreadCount = count;
+        }
+        // Starts from an empty pipeline cache, for comparing against a warm start
+        void setLoadPipelineCache(bool load) {
+            loadPipelineCache = load;
+        }
+        // Records CPU scopes and GPU timestamps, prints rolling averages and writes a Chrome trace to path on exit
+        void setProfiling(const std::string& tracePath) {
+            Profiler::get().setEnabled(true);
+            profileTracePath = tracePath;
+        }
+        // Frame time and blocking call histograms are printed on exit and, with a path, written there as CSV or JSON
+        // on exit and whenever F12 is pressed
+        void setFrameStatsPath(const std::string& path) {
+            frameStatsPath = path;
+        }
+        // Window or offscreen image size
+        void setResolution(uint32_t widthIn, uint32_t heightIn) {
+            width = widthIn;
+            height = heightIn;
+        }
+        // run() closes the window after this many frames, 0 runs until it is closed
+        void setFrameLimit(uint32_t frames) {
+            frameLimit = frames;
+        }
+        // Writes startup phases, frame time distributions and memory use as JSON to path on exit. Implies GPU timestamps.
+        void setBenchmarkOutput(const std::string& path) {
+            benchmarkPath = path;
+        }
+        // Recompiles shaders in the background when their sources change and swaps in the pipelines using them
+        void setShaderHotReload(bool enabled) {
+            shaderHotReload = enabled;
+        }
 
     protected:
         Window window;
@@ -61,10 +136,20 @@ namespace LightVulkan {
         VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
         VulkanDevice device;
         VulkanSwapChain swapChain;
+        VulkanUploadManager uploadManager;
+        JobSystem jobSystem;
+
+        // Layouts shared by content, long lived sets, and sets rebuilt every frame
+        VulkanDescriptorLayoutCache descriptorLayoutCache;
+        VulkanDescriptorAllocator descriptorAllocator;
+        VulkanFrameDescriptorAllocator frameDescriptorAllocator;
+        uint32_t jobThreadCount = 0;
 
         VkRenderPass renderPass;
         VkPipelineLayout pipelineLayout;
         VkPipeline graphicsPipeline;
+        ShaderManager shaderManager;
+        bool shaderHotReload = false;
 
         VulkanResource colorResource;
         VulkanDepthResource depthResource;
@@ -74,35 +159,139 @@ namespace LightVulkan {
         VulkanSyncObjects syncObjects;
         size_t currentFrame = 0;
 
+        // Serial of the last submitted frame and of the frame each in-flight slot last submitted
+        uint64_t submittedFrameSerial = 0;
+        std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> frameSerials{};
+        VulkanDeletionQueue deletionQueue;
+
+        // CPU time spent in recordCommandBuffer over the whole run
+        double recordTime = 0.0;
+
+        bool headless = false;
+        uint32_t offscreenImageIndex = 0;
+        bool loadPipelineCache = true;
+
+        // Timestamps around the frame's GPU work, only created when profiling or benchmarking
+        VulkanGpuProfiler gpuProfiler;
+        std::string profileTracePath;
+
+        FrameStats frameStats;
+        std::string frameStatsPath;
+
+        uint32_t width = WIDTH;
+        uint32_t height = HEIGHT;
+        uint32_t frameLimit = 0;
+        uint32_t renderedFrames = 0;
+        // Wall time of the frame loop in ms
+        double runTime = 0.0;
+
+        std::string benchmarkPath;
+        std::vector<std::pair<std::string, double>> startupPhases;
+        std::chrono::high_resolution_clock::time_point startupPhaseStart;
+        VkDeviceSize peakDeviceBytes = 0;
+
         void mainLoop() {
-            while (!glfwWindowShouldClose(window.get())) {
-                glfwPollEvents();
-                drawFrame();
+            auto startTime = std::chrono::high_resolution_clock::now();
+            auto lastReport = startTime;
+            while (!glfwWindowShouldClose(window.get()) && (frameLimit == 0 || renderedFrames < frameLimit)) {
+                {
+                    ProfileScope scope("Frame");
+                    {
+                        ProfileScope pollScope("Poll events");
+                        glfwPollEvents();
+                        jobSystem.pumpMainThread();
+                    }
+                    drawFrame();
+                }
+                endFrame();
+
+                if (window.consumeStatsRequest()) {
+                    dumpFrameStats();
+                }
+
+                auto now = std::chrono::high_resolution_clock::now();
+                if (Profiler::get().isEnabled() && std::chrono::duration<double>(now - lastReport).count() >= PROFILE_REPORT_INTERVAL) {
+                    Profiler::get().report(std::cout);
+                    lastReport = now;
+                }
             }
 
             vkDeviceWaitIdle(device.getLogicalDevice());
+            runTime = std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+        }
+        void endFrame() {
+            renderedFrames++;
+            Profiler::get().endFrame();
+            if (!benchmarkPath.empty()) {
+                peakDeviceBytes = std::max(peakDeviceBytes, device.getAllocator().getStats().blockBytes);
+            }
+        }
+        // Time since the previous mark, or since initVulkan started, is attributed to name
+        void markStartupPhase(const std::string& name) {
+            auto now = std::chrono::high_resolution_clock::now();
+            startupPhases.push_back({ name, std::chrono::duration<double, std::chrono::milliseconds::period>(now - startupPhaseStart).count() });
+            startupPhaseStart = now;
         }
 
         virtual void initVulkan() {
-            instance.setUp(debugMessenger);
+            startupPhaseStart = std::chrono::high_resolution_clock::now();
+            jobSystem.create(jobThreadCount);
+            instance.setUp(debugMessenger, headless);
             debugMessenger.setUp(instance.get());
-            device.setUp(instance, window, msaaSamples);
-            swapChain.create(device, window);
+            markStartupPhase("instance");
+            if (headless) {
+                device.setUpHeadless(instance, msaaSamples);
+                swapChain.createOffscreen(device, width, height, HEADLESS_IMAGE_COUNT);
+            }
+            else {
+                device.setUp(instance, window, msaaSamples);
+                swapChain.create(device, window);
+            }
+            markStartupPhase("device");
+            device.createPipelineCache(PIPELINE_CACHE_PATH, loadPipelineCache);
+            shaderManager.create(SHADER_CACHE_DIRECTORY);
             swapChain.createImageViews(device.getLogicalDevice());
             createRenderPass();
+            descriptorAllocator.create();
+            frameDescriptorAllocator.create(MAX_FRAMES_IN_FLIGHT);
             createDescriptorSetLayout();
             createGraphicsPipeline();
+            markStartupPhase("pipelines");
+            reportShaderStats();
+            reportPipelineCacheStats();
             createCommandPool();
+            uploadManager.create(device);
             createColorResources();
             createDepthResources();
             createFramebuffers();
             createUniformBuffers();
             createDescriptorPool();
             syncObjects.create(device, swapChain, MAX_FRAMES_IN_FLIGHT);
+            if (Profiler::get().isEnabled() || !benchmarkPath.empty()) {
+                if (VulkanGpuProfiler::isSupported(device)) {
+                    gpuProfiler.create(device, MAX_FRAMES_IN_FLIGHT);
+                }
+                else {
+                    std::cout << "Timestamp queries unsupported on the graphics queue, profiling the CPU only" << std::endl;
+                }
+            }
+            if (shaderHotReload) {
+                shaderManager.startWatching();
+            }
+            markStartupPhase("frame resources");
+        }
+        void reportShaderStats() {
+            const ShaderLoadStats& stats = shaderManager.getStats();
+            std::cout << "Shaders: " << stats.compiled << " compiled, " << stats.cached << " from the SPIR-V cache in " << stats.milliseconds << " ms" << std::endl;
+        }
+        void reportPipelineCacheStats() {
+            const PipelineCacheStats& stats = device.getPipelineCache().getStats();
+            std::cout << "Pipeline cache " << (stats.warm ? "warm (" + std::to_string(stats.loadedBytes) + " bytes)" : std::string("cold"))
+                << ": " << stats.pipelineCount << " startup pipelines created in " << stats.creationMs << " ms" << std::endl;
         }
         virtual void cleanupSwapChain() {
-            depthResource.destroy(device.getLogicalDevice());
-            colorResource.destroy(device.getLogicalDevice());
+            depthResource.destroy(device);
+            colorResource.destroy(device);
 
             swapChain.destroyFrameBuffers(device.getLogicalDevice());
 
@@ -113,18 +302,41 @@ namespace LightVulkan {
             vkDestroyRenderPass(device.getLogicalDevice(), renderPass, nullptr);
 
             swapChain.destroyImageViews(device.getLogicalDevice());
-            swapChain.destroy(device.getLogicalDevice());
+            swapChain.destroy(device);
         }
         virtual void cleanup() {
+            shaderManager.destroy();
+            if (!benchmarkPath.empty()) {
+                writeBenchmarkResults();
+            }
+            dumpFrameStats();
+            if (Profiler::get().isEnabled()) {
+                Profiler::get().report(std::cout);
+                if (!Profiler::get().writeChromeTrace(profileTracePath)) {
+                    std::cerr << "failed to write profile trace " << profileTracePath << std::endl;
+                }
+            }
+            gpuProfiler.destroy(device);
+            deletionQueue.flush();
             cleanupSwapChain();
+            frameDescriptorAllocator.destroy(device);
+            descriptorAllocator.destroy(device);
+            descriptorLayoutCache.destroy(device);
+            uploadManager.destroy(device);
             syncObjects.destroy(device, MAX_FRAMES_IN_FLIGHT);
             vkDestroyCommandPool(device.getLogicalDevice(), device.getCommandPool(), nullptr);
             device.destroy(instance.get());
             debugMessenger.destroy(instance.get());
             instance.destroy();
-            window.destroy();
-            glfwTerminate();
+            if (!headless) {
+                window.destroy();
+                glfwTerminate();
+            }
+            jobSystem.destroy();
         }
+        // Frames in flight keep using the old swap chain and its attachments, those are retired through the
+        // deletion queue instead of waiting for the device. Pipelines use dynamic viewport and scissor and the
+        // render pass only depends on the surface format, so both usually survive.
         virtual void recreateSwapChain() {
             int width = 0, height = 0;
             glfwGetFramebufferSize(window.get(), &width, &height);
@@ -133,21 +345,116 @@ namespace LightVulkan {
                 glfwWaitEvents();
             }
 
-            vkDeviceWaitIdle(device.getLogicalDevice());
+            VkDevice logicalDevice = device.getLogicalDevice();
+            VkSwapchainKHR oldSwapChain = swapChain.get();
+            VkFormat oldFormat = swapChain.getImageFormat();
+            std::vector<VkFramebuffer> oldFramebuffers = swapChain.getFramebuffers();
+            std::vector<VulkanImageView> oldImageViews = swapChain.getImageViews();
+            VulkanResource oldColorResource = colorResource;
+            VulkanDepthResource oldDepthResource = depthResource;
 
-            cleanupSwapChain();
-            swapChain.create(device, window);
-            swapChain.createImageViews(device.getLogicalDevice());
-            createRenderPass();
-            createGraphicsPipeline();
+            swapChain.create(device, window, oldSwapChain);
+
+            deletionQueue.push(submittedFrameSerial, [this, logicalDevice, oldFramebuffers, oldImageViews, oldColorResource, oldDepthResource]() mutable {
+                for (auto framebuffer : oldFramebuffers) {
+                    vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
+                }
+                for (auto& imageView : oldImageViews) {
+                    imageView.destroy(logicalDevice);
+                }
+                oldColorResource.destroy(device);
+                oldDepthResource.destroy(device);
+            });
+            // Frame fences do not cover presentation, the last presents of the old swap chain can still be pending
+            // when the last frame rendered to it has completed. Presents on a queue complete in order, so the old
+            // swap chain is kept until every image of the new one could have been presented and acquired again,
+            // which takes MAX_FRAMES_IN_FLIGHT plus the image count more completed frames.
+            uint64_t retireSerial = submittedFrameSerial + MAX_FRAMES_IN_FLIGHT + swapChain.getImages().size();
+            deletionQueue.push(retireSerial, [logicalDevice, oldSwapChain]() {
+                vkDestroySwapchainKHR(logicalDevice, oldSwapChain, nullptr);
+            });
+
+            if (swapChain.getImageFormat() != oldFormat) {
+                VkRenderPass oldRenderPass = renderPass;
+                VkPipeline oldPipeline = graphicsPipeline;
+                VkPipelineLayout oldPipelineLayout = pipelineLayout;
+                deletionQueue.push(submittedFrameSerial, [logicalDevice, oldRenderPass, oldPipeline, oldPipelineLayout]() {
+                    vkDestroyPipeline(logicalDevice, oldPipeline, nullptr);
+                    vkDestroyPipelineLayout(logicalDevice, oldPipelineLayout, nullptr);
+                    vkDestroyRenderPass(logicalDevice, oldRenderPass, nullptr);
+                });
+
+                createRenderPass();
+                createGraphicsPipeline();
+            }
+
+            swapChain.createImageViews(logicalDevice);
             createColorResources();
             createDepthResources();
             createFramebuffers();
-            createUniformBuffers();
-            createDescriptorPool();
-            createDescriptorSets();
-            createCommandBuffers();
             syncObjects.resize(swapChain);
+            onSwapChainRecreated();
+        }
+        void dumpFrameStats() {
+            frameStats.report(std::cout);
+            if (!frameStatsPath.empty()) {
+                if (frameStats.write(frameStatsPath)) {
+                    std::cout << "Wrote frame stats to " << frameStatsPath << std::endl;
+                }
+                else {
+                    std::cerr << "failed to write frame stats " << frameStatsPath << std::endl;
+                }
+            }
+        }
+        void writeBenchmarkResults() {
+            std::ofstream file(benchmarkPath);
+            if (!file) {
+                std::cerr << "failed to write benchmark results " << benchmarkPath << std::endl;
+                return;
+            }
+            VulkanAllocatorStats memory = device.getAllocator().getStats();
+
+            file << std::fixed << std::setprecision(3);
+            file << "{\n  \"scene\": {\"width\": " << swapChain.getExtent().width << ", \"height\": " << swapChain.getExtent().height
+                << ", \"headless\": " << (headless ? "true" : "false") << ", \"msaaSamples\": " << msaaSamples;
+            writeBenchmarkScene(file);
+            file << "},\n  \"frames\": " << renderedFrames << ",\n  \"runMs\": " << runTime << ",\n  \"recordMs\": " << recordTime
+                << ",\n  \"startupMs\": {";
+            double startupTotal = 0.0;
+            for (size_t i = 0; i < startupPhases.size(); i++) {
+                file << (i > 0 ? ", " : "") << "\"" << startupPhases[i].first << "\": " << startupPhases[i].second;
+                startupTotal += startupPhases[i].second;
+            }
+            file << (startupPhases.empty() ? "" : ", ") << "\"total\": " << startupTotal << "},\n  \"frameStats\": ";
+            frameStats.writeJson(file);
+            file << ",\n  \"memory\": {\"deviceBlocks\": " << memory.blockCount << ", \"deviceAllocations\": " << memory.allocationCount
+                << ", \"deviceBlockBytes\": " << memory.blockBytes << ", \"deviceUsedBytes\": " << memory.usedBytes
+                << ", \"peakDeviceBlockBytes\": " << std::max(peakDeviceBytes, memory.blockBytes);
+            writeBenchmarkMemory(file);
+            file << "}\n}\n";
+            std::cout << "Wrote benchmark results to " << benchmarkPath << std::endl;
+        }
+        // Extra ", \"key\": value" pairs for the scene and memory objects of the benchmark results
+        virtual void writeBenchmarkScene(std::ostream&) {}
+        virtual void writeBenchmarkMemory(std::ostream&) {}
+        // Applications holding per swap chain image state rebuild it here, retiring the old state through deletionQueue
+        virtual void onSwapChainRecreated() {}
+        // Applications rebuild the pipelines built from these shaders here, retiring the old ones through deletionQueue
+        virtual void onShadersReloaded(const std::vector<ShaderHandle>&) {}
+        void setViewportAndScissor(VkCommandBuffer commandBuffer) {
+            VkViewport viewport{};
+            viewport.x = 0.0f;
+            viewport.y = 0.0f;
+            viewport.width = (float)swapChain.getExtent().width;
+            viewport.height = (float)swapChain.getExtent().height;
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+            VkRect2D scissor{};
+            scissor.offset = { 0, 0 };
+            scissor.extent = swapChain.getExtent();
+            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
         }
         virtual void createRenderPass() {
             VkAttachmentDescription colorAttachment{};
@@ -178,7 +485,7 @@ namespace LightVulkan {
             colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
             colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
             colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+            colorAttachmentResolve.finalLayout = swapChain.getFinalLayout();
 
             VkAttachmentReference colorAttachmentRef{};
             colorAttachmentRef.attachment = 0;
@@ -273,12 +580,38 @@ namespace LightVulkan {
 
         virtual void createGraphicsPipeline() = 0;
         virtual void createCommandBuffers() = 0;
+        // Applications whose draws depend on per-frame state re-record here, otherwise the prerecorded buffer is reused
+        virtual VkCommandBuffer recordCommandBuffer(uint32_t imageIndex) {
+            return commandBuffers[imageIndex];
+        }
 
         virtual void drawFrame() {
-            vkWaitForFences(device.getLogicalDevice(), 1, &syncObjects.getInFlightFences()[currentFrame], VK_TRUE, UINT64_MAX);
+            frameStats.beginFrame();
+            {
+                ProfileScope scope("Wait for frame");
+                FrameStatTimer timer(frameStats, FrameStat::FenceWait);
+                vkWaitForFences(device.getLogicalDevice(), 1, &syncObjects.getInFlightFences()[currentFrame], VK_TRUE, UINT64_MAX);
+            }
+            deletionQueue.collect(frameSerials[currentFrame]);
+            if (shaderHotReload) {
+                std::vector<ShaderHandle> reloaded = shaderManager.poll();
+                if (!reloaded.empty()) {
+                    onShadersReloaded(reloaded);
+                }
+            }
+            frameDescriptorAllocator.beginFrame(device, static_cast<uint32_t>(currentFrame));
 
             uint32_t imageIndex;
-            VkResult result = vkAcquireNextImageKHR(device.getLogicalDevice(), swapChain.get(), UINT64_MAX, syncObjects.getImageAvailableSemaphores()[currentFrame], VK_NULL_HANDLE, &imageIndex);
+            VkResult result = VK_SUCCESS;
+            if (headless) {
+                imageIndex = offscreenImageIndex;
+                offscreenImageIndex = (offscreenImageIndex + 1) % static_cast<uint32_t>(swapChain.getImages().size());
+            }
+            else {
+                ProfileScope scope("Acquire");
+                FrameStatTimer timer(frameStats, FrameStat::Acquire);
+                result = vkAcquireNextImageKHR(device.getLogicalDevice(), swapChain.get(), UINT64_MAX, syncObjects.getImageAvailableSemaphores()[currentFrame], VK_NULL_HANDLE, &imageIndex);
+            }
 
             if (result == VK_ERROR_OUT_OF_DATE_KHR) {
                 recreateSwapChain();
@@ -299,23 +632,46 @@ namespace LightVulkan {
 
             VkSemaphore waitSemaphores[] = { syncObjects.getImageAvailableSemaphores()[currentFrame] };
             VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-            submitInfo.waitSemaphoreCount = 1;
+            submitInfo.waitSemaphoreCount = headless ? 0 : 1;
             submitInfo.pWaitSemaphores = waitSemaphores;
             submitInfo.pWaitDstStageMask = waitStages;
 
+            {
+                ProfileScope scope("Update");
+                updateUniformBuffers(imageIndex);
+            }
+            VkCommandBuffer commandBuffer;
+            {
+                ProfileScope scope("Record");
+                auto recordStart = std::chrono::high_resolution_clock::now();
+                commandBuffer = recordCommandBuffer(imageIndex);
+                recordTime += std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - recordStart).count();
+            }
+            std::chrono::nanoseconds gpuTime;
+            if (gpuProfiler.consumeFrameTime(gpuTime)) {
+                frameStats.record(FrameStat::GpuTime, gpuTime);
+            }
+
             submitInfo.commandBufferCount = 1;
-            submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+            submitInfo.pCommandBuffers = &commandBuffer;
 
             VkSemaphore signalSemaphores[] = { syncObjects.getRenderFinishedSemaphores()[currentFrame] };
-            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.signalSemaphoreCount = headless ? 0 : 1;
             submitInfo.pSignalSemaphores = signalSemaphores;
 
             vkResetFences(device.getLogicalDevice(), 1, &syncObjects.getInFlightFences()[currentFrame]);
 
-            updateUniformBuffers(imageIndex);
+            {
+                ProfileScope scope("Submit");
+                if (vkQueueSubmit(device.getGraphicsQueue(), 1, &submitInfo, syncObjects.getInFlightFences()[currentFrame]) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to submit draw command buffer!");
+                }
+            }
+            frameSerials[currentFrame] = ++submittedFrameSerial;
 
-            if (vkQueueSubmit(device.getGraphicsQueue(), 1, &submitInfo, syncObjects.getInFlightFences()[currentFrame]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to submit draw command buffer!");
+            if (headless) {
+                currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+                return;
             }
 
             VkPresentInfoKHR presentInfo{};
@@ -330,7 +686,11 @@ namespace LightVulkan {
 
             presentInfo.pImageIndices = &imageIndex;
 
-            result = vkQueuePresentKHR(device.getPresentQueue(), &presentInfo);
+            {
+                ProfileScope scope("Present");
+                FrameStatTimer timer(frameStats, FrameStat::Present);
+                result = vkQueuePresentKHR(device.getPresentQueue(), &presentInfo);
+            }
 
             if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window.isFrameBufferResized()) {
                 window.setFrameBufferResized(false);
@@ -0,0 +1,304 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+#include "VulkanDeletionQueue.h"
+
+namespace LightVulkan {
+    typedef uint32_t BindlessTextureHandle;
+
+    // Matches Material in bindlessShader.frag (std430). albedoTexture is a table handle on the CPU and is
+    // replaced with the texture's current slot when the frame's copy is written.
+    struct BindlessMaterial {
+        glm::vec4 baseColor = glm::vec4(1.0f);
+        uint32_t albedoTexture = 0;
+        uint32_t padding[3] = {};
+    };
+
+    // One descriptor set shared by every draw: a large partially bound array of sampled images, a sampler, and a
+    // material buffer indexed per instance. Draws pick their material through InstanceData::materialIndex, so
+    // changing texture or material never needs a descriptor bind.
+    //
+    // Slots are written with update after bind while earlier frames still reference other slots. A slot a
+    // submitted frame may read is never rewritten, replacing a texture's view moves it to a fresh slot and
+    // releases the old one through the deletion queue. Handles stay stable across those moves.
+    class VulkanBindlessTable {
+    public:
+        static const uint32_t MAX_TEXTURES = 4096;
+        static const uint32_t MAX_MATERIALS = 4096;
+
+        static bool isSupported(VulkanDevice& device) {
+            return device.getFeatures().descriptorIndexing;
+        }
+        void create(VulkanDevice& device, uint32_t frameCountIn, uint32_t textureCapacityIn = MAX_TEXTURES, uint32_t materialCapacityIn = MAX_MATERIALS) {
+            frameCount = frameCountIn;
+            materialCapacity = std::max(1u, materialCapacityIn);
+
+            VkPhysicalDeviceVulkan12Properties properties12{};
+            properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+            VkPhysicalDeviceProperties2 properties{};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties.pNext = &properties12;
+            vkGetPhysicalDeviceProperties2(device.getPhysicalDevice(), &properties);
+
+            textureCapacity = std::min({ std::max(1u, textureCapacityIn),
+                properties12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                properties12.maxDescriptorSetUpdateAfterBindSampledImages });
+
+            createLayout(device);
+            createPool(device);
+            allocateSet(device);
+
+            VkDeviceSize alignment = std::max<VkDeviceSize>(properties.properties.limits.minStorageBufferOffsetAlignment, 1);
+            materialRegionSize = (sizeof(BindlessMaterial) * materialCapacity + alignment - 1) / alignment * alignment;
+            materialBuffer.create(device, materialRegionSize * frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            mappedMaterials = static_cast<char*>(materialBuffer.getMappedData());
+            if (mappedMaterials == nullptr) {
+                throw std::runtime_error("failed to map bindless material buffer!");
+            }
+            frameMaterialVersions.assign(frameCount, 0);
+
+            // Popped from the back, so slot 0 is handed out first
+            freeSlots.clear();
+            for (uint32_t slot = textureCapacity; slot-- > 0;) {
+                freeSlots.push_back(slot);
+            }
+        }
+        void destroy(VulkanDevice& device) {
+            materialBuffer.destroy(device);
+            mappedMaterials = nullptr;
+            vkDestroyDescriptorPool(device.getLogicalDevice(), pool, nullptr);
+            vkDestroyDescriptorSetLayout(device.getLogicalDevice(), layout, nullptr);
+            textureSlots.clear();
+            materials.clear();
+        }
+        // Goes to the pipeline layout after the per frame set
+        VkDescriptorSetLayout getLayout() {
+            return layout;
+        }
+        VkDescriptorSet getSet() {
+            return set;
+        }
+        // Every texture in the table is sampled with this sampler
+        void setSampler(VulkanDevice& device, VkSampler sampler) {
+            VkDescriptorImageInfo imageInfo{};
+            imageInfo.sampler = sampler;
+
+            VkWriteDescriptorSet descriptorWrite{};
+            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrite.dstSet = set;
+            descriptorWrite.dstBinding = SAMPLER_BINDING;
+            descriptorWrite.dstArrayElement = 0;
+            descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+            descriptorWrite.descriptorCount = 1;
+            descriptorWrite.pImageInfo = &imageInfo;
+
+            vkUpdateDescriptorSets(device.getLogicalDevice(), 1, &descriptorWrite, 0, nullptr);
+        }
+        // The view must be in SHADER_READ_ONLY_OPTIMAL whenever a frame using it executes
+        BindlessTextureHandle addTexture(VulkanDevice& device, VkImageView view) {
+            BindlessTextureHandle handle = static_cast<BindlessTextureHandle>(textureSlots.size());
+            textureSlots.push_back(writeSlot(device, view));
+            materialVersion++;
+            return handle;
+        }
+        // Frames submitted up to serial keep sampling the old view through the old slot
+        void setTexture(VulkanDevice& device, VulkanDeletionQueue& deletionQueue, uint64_t serial, BindlessTextureHandle handle, VkImageView view) {
+            uint32_t oldSlot = textureSlots.at(handle);
+            textureSlots[handle] = writeSlot(device, view);
+            retireSlot(deletionQueue, serial, oldSlot);
+            materialVersion++;
+        }
+        // Materials still pointing at the handle must be changed before the next frame is written
+        void removeTexture(VulkanDeletionQueue& deletionQueue, uint64_t serial, BindlessTextureHandle handle) {
+            retireSlot(deletionQueue, serial, textureSlots.at(handle));
+            textureSlots[handle] = INVALID_SLOT;
+        }
+        // Only once the device is idle
+        void removeTexture(BindlessTextureHandle handle) {
+            if (textureSlots.at(handle) != INVALID_SLOT) {
+                freeSlots.push_back(textureSlots[handle]);
+                textureSlots[handle] = INVALID_SLOT;
+            }
+        }
+        uint32_t getTextureSlot(BindlessTextureHandle handle) {
+            return textureSlots.at(handle);
+        }
+        // Returns the index instances pass in InstanceData::materialIndex
+        uint32_t addMaterial(const glm::vec4& baseColor, BindlessTextureHandle albedoTexture) {
+            if (materials.size() >= materialCapacity) {
+                throw std::runtime_error("bindless material table exhausted!");
+            }
+            BindlessMaterial material;
+            material.baseColor = baseColor;
+            material.albedoTexture = albedoTexture;
+            materials.push_back(material);
+            materialVersion++;
+            return static_cast<uint32_t>(materials.size() - 1);
+        }
+        void setMaterial(uint32_t index, const glm::vec4& baseColor, BindlessTextureHandle albedoTexture) {
+            materials.at(index).baseColor = baseColor;
+            materials[index].albedoTexture = albedoTexture;
+            materialVersion++;
+        }
+        uint32_t getMaterialCount() {
+            return static_cast<uint32_t>(materials.size());
+        }
+        // The caller must have waited on the fence of the frame that last used this region. Rewrites the frame's
+        // material copy only when something changed since it was last written.
+        void beginFrame(uint32_t frameIndex) {
+            uint32_t frame = frameIndex % frameCount;
+            if (frameMaterialVersions[frame] == materialVersion) {
+                return;
+            }
+            frameMaterialVersions[frame] = materialVersion;
+
+            BindlessMaterial* dst = reinterpret_cast<BindlessMaterial*>(mappedMaterials + materialRegionSize * frame);
+            for (size_t i = 0; i < materials.size(); i++) {
+                dst[i] = materials[i];
+                dst[i].albedoTexture = textureSlots.at(materials[i].albedoTexture);
+            }
+        }
+        // For a STORAGE_BUFFER binding in each frame's own set
+        VkDescriptorBufferInfo getMaterialBufferInfo(uint32_t frameIndex) {
+            VkDescriptorBufferInfo bufferInfo{};
+            bufferInfo.buffer = materialBuffer.getBuffer();
+            bufferInfo.offset = materialRegionSize * (frameIndex % frameCount);
+            bufferInfo.range = sizeof(BindlessMaterial) * materialCapacity;
+            return bufferInfo;
+        }
+        uint32_t getTextureCapacity() {
+            return textureCapacity;
+        }
+        uint32_t getResidentTextureCount() {
+            return textureCapacity - static_cast<uint32_t>(freeSlots.size());
+        }
+
+    private:
+        static const uint32_t TEXTURE_BINDING = 0;
+        static const uint32_t SAMPLER_BINDING = 1;
+        static const uint32_t INVALID_SLOT = ~0u;
+
+        void createLayout(VulkanDevice& device) {
+            std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+            bindings[0].binding = TEXTURE_BINDING;
+            bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            bindings[0].descriptorCount = textureCapacity;
+            bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+            bindings[1].binding = SAMPLER_BINDING;
+            bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+            bindings[1].descriptorCount = 1;
+            bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+            std::array<VkDescriptorBindingFlags, 2> bindingFlags = {
+                VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+                0
+            };
+            VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+            bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+            bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+            bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+            VkDescriptorSetLayoutCreateInfo layoutInfo{};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            layoutInfo.pNext = &bindingFlagsInfo;
+            layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+            layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+            layoutInfo.pBindings = bindings.data();
+
+            if (vkCreateDescriptorSetLayout(device.getLogicalDevice(), &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create bindless descriptor set layout!");
+            }
+        }
+        void createPool(VulkanDevice& device) {
+            std::array<VkDescriptorPoolSize, 2> poolSizes{};
+            poolSizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            poolSizes[0].descriptorCount = textureCapacity;
+            poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+            poolSizes[1].descriptorCount = 1;
+
+            VkDescriptorPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+            poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+            poolInfo.pPoolSizes = poolSizes.data();
+            poolInfo.maxSets = 1;
+
+            if (vkCreateDescriptorPool(device.getLogicalDevice(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create bindless descriptor pool!");
+            }
+        }
+        void allocateSet(VulkanDevice& device) {
+            VkDescriptorSetAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = pool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &layout;
+
+            if (vkAllocateDescriptorSets(device.getLogicalDevice(), &allocInfo, &set) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate bindless descriptor set!");
+            }
+        }
+        uint32_t writeSlot(VulkanDevice& device, VkImageView view) {
+            if (freeSlots.empty()) {
+                throw std::runtime_error("bindless texture table exhausted!");
+            }
+            uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+
+            VkDescriptorImageInfo imageInfo{};
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageInfo.imageView = view;
+
+            VkWriteDescriptorSet descriptorWrite{};
+            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrite.dstSet = set;
+            descriptorWrite.dstBinding = TEXTURE_BINDING;
+            descriptorWrite.dstArrayElement = slot;
+            descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            descriptorWrite.descriptorCount = 1;
+            descriptorWrite.pImageInfo = &imageInfo;
+
+            vkUpdateDescriptorSets(device.getLogicalDevice(), 1, &descriptorWrite, 0, nullptr);
+            return slot;
+        }
+        void retireSlot(VulkanDeletionQueue& deletionQueue, uint64_t serial, uint32_t slot) {
+            if (slot == INVALID_SLOT) {
+                return;
+            }
+            deletionQueue.push(serial, [this, slot]() {
+                freeSlots.push_back(slot);
+            });
+        }
+
+    private:
+        VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+        VkDescriptorPool pool = VK_NULL_HANDLE;
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        uint32_t textureCapacity = 0;
+        std::vector<uint32_t> textureSlots;
+        std::vector<uint32_t> freeSlots;
+
+        uint32_t frameCount = 1;
+        uint32_t materialCapacity = 0;
+        VkDeviceSize materialRegionSize = 0;
+        VulkanBuffer materialBuffer;
+        char* mappedMaterials = nullptr;
+        std::vector<BindlessMaterial> materials;
+        uint64_t materialVersion = 1;
+        std::vector<uint64_t> frameMaterialVersions;
+    };
+}
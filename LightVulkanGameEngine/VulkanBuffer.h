@@ -6,6 +6,7 @@
 #include <stdexcept>
 
 #include "VulkanDevice.h"
+#include "VulkanCommandBuffer.h"
 #include "VulkanUtils.h"
 
 namespace LightVulkan {
@@ -25,26 +26,23 @@ namespace LightVulkan {
             VkMemoryRequirements memRequirements;
             vkGetBufferMemoryRequirements(device.getLogicalDevice(), buffer, &memRequirements);
 
-            VkMemoryAllocateInfo allocInfo{};
-            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-            allocInfo.allocationSize = memRequirements.size;
-            allocInfo.memoryTypeIndex = Utils::findMemoryType(device.getPhysicalDevice(), memRequirements.memoryTypeBits, properties);
+            allocation = device.getAllocator().allocate(memRequirements, properties, AllocationKind::Linear);
 
-            if (vkAllocateMemory(device.getLogicalDevice(), &allocInfo, nullptr, &memory) != VK_SUCCESS) {
-                throw std::runtime_error("failed to allocate buffer memory!");
-            }
-
-            vkBindBufferMemory(device.getLogicalDevice(), buffer, memory, 0);
+            vkBindBufferMemory(device.getLogicalDevice(), buffer, allocation.memory, allocation.offset);
         }
-        void destroy(VkDevice device) {
-            vkDestroyBuffer(device, buffer, nullptr);
-            vkFreeMemory(device, memory, nullptr);
+        void destroy(VulkanDevice& device) {
+            vkDestroyBuffer(device.getLogicalDevice(), buffer, nullptr);
+            device.getAllocator().free(allocation);
         }
         VkBuffer getBuffer() {
             return buffer;
         }
-        VkDeviceMemory getMemory() {
-            return memory;
+        const VulkanAllocation& getAllocation() {
+            return allocation;
+        }
+        // Host visible buffers are persistently mapped by the allocator
+        void* getMappedData() {
+            return allocation.mappedData;
         }
         static void copyBuffer(VulkanDevice& device, VulkanBuffer srcBuffer, VulkanBuffer dstBuffer, VkDeviceSize size) {
             VulkanCommandBuffer commandBuffer;
@@ -60,6 +58,6 @@ namespace LightVulkan {
 
     private:
         VkBuffer buffer;
-        VkDeviceMemory memory;
+        VulkanAllocation allocation;
     };
 }
@@ -0,0 +1,133 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include "VulkanDevice.h"
+#include "JobSystem.h"
+
+namespace LightVulkan {
+    // Records a frame's draws into secondary command buffers as jobs. Every job system thread owns one
+    // transient pool per frame in flight, pools are reset as a whole and their buffers reused.
+    class VulkanCommandRecorder {
+    public:
+        typedef std::function<void(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end)> RecordFn;
+
+        void create(VulkanDevice& device, JobSystem& jobSystemIn, uint32_t frameCount) {
+            jobSystem = &jobSystemIn;
+            threadCount = jobSystem->getThreadCount();
+            QueueFamilyIndices queueFamilies = device.getQueueFamilies();
+
+            frames.resize(frameCount);
+            for (auto& frame : frames) {
+                frame.threads.resize(threadCount);
+                for (auto& thread : frame.threads) {
+                    VkCommandPoolCreateInfo poolInfo{};
+                    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+                    poolInfo.queueFamilyIndex = queueFamilies.graphicsFamily.value();
+                    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+                    if (vkCreateCommandPool(device.getLogicalDevice(), &poolInfo, nullptr, &thread.pool) != VK_SUCCESS) {
+                        throw std::runtime_error("failed to create recording command pool!");
+                    }
+                }
+            }
+        }
+        void destroy(VulkanDevice& device) {
+            for (auto& frame : frames) {
+                for (auto& thread : frame.threads) {
+                    vkDestroyCommandPool(device.getLogicalDevice(), thread.pool, nullptr);
+                }
+            }
+            frames.clear();
+        }
+        // The frame's fence must have signaled, every buffer recorded from its pools goes back to the initial state
+        void beginFrame(VulkanDevice& device, uint32_t frameIndex) {
+            currentFrame = frameIndex % static_cast<uint32_t>(frames.size());
+            for (auto& thread : frames[currentFrame].threads) {
+                vkResetCommandPool(device.getLogicalDevice(), thread.pool, 0);
+                thread.used = 0;
+            }
+        }
+        // Splits [0, itemCount) into contiguous ranges, one job each, and appends the secondaries in range order
+        // so the primary executes the draws in the same order a single thread would have recorded them.
+        void record(VulkanDevice& device, const VkCommandBufferInheritanceInfo& inheritance, uint32_t itemCount,
+            const RecordFn& fn, std::vector<VkCommandBuffer>& secondaries, uint32_t minItemsPerRange = 256) {
+            if (itemCount == 0) {
+                return;
+            }
+
+            uint32_t rangeCount = std::min(threadCount, (itemCount + minItemsPerRange - 1) / minItemsPerRange);
+            uint32_t rangeSize = (itemCount + rangeCount - 1) / rangeCount;
+            rangeCount = (itemCount + rangeSize - 1) / rangeSize;
+
+            size_t first = secondaries.size();
+            secondaries.resize(first + rangeCount);
+
+            VkDevice logicalDevice = device.getLogicalDevice();
+            // A thread only records one range at a time, so its pool never sees concurrent use
+            jobSystem->parallelFor(rangeCount, 1, [&](uint32_t range, uint32_t) {
+                VkCommandBuffer commandBuffer = acquire(logicalDevice, frames[currentFrame].threads[JobSystem::getThreadIndex()]);
+
+                VkCommandBufferBeginInfo beginInfo{};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+                beginInfo.pInheritanceInfo = &inheritance;
+
+                if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to begin recording secondary command buffer!");
+                }
+
+                uint32_t begin = range * rangeSize;
+                fn(commandBuffer, begin, std::min(itemCount, begin + rangeSize));
+
+                if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to record secondary command buffer!");
+                }
+                secondaries[first + range] = commandBuffer;
+            });
+        }
+        uint32_t getThreadCount() {
+            return threadCount;
+        }
+
+    private:
+        struct ThreadState {
+            VkCommandPool pool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> buffers;
+            size_t used = 0;
+        };
+
+        struct FrameState {
+            std::vector<ThreadState> threads;
+        };
+
+        static VkCommandBuffer acquire(VkDevice device, ThreadState& thread) {
+            if (thread.used == thread.buffers.size()) {
+                VkCommandBufferAllocateInfo allocInfo{};
+                allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                allocInfo.commandPool = thread.pool;
+                allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+                allocInfo.commandBufferCount = 1;
+
+                VkCommandBuffer commandBuffer;
+                if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to allocate secondary command buffer!");
+                }
+                thread.buffers.push_back(commandBuffer);
+            }
+            return thread.buffers[thread.used++];
+        }
+
+    private:
+        JobSystem* jobSystem = nullptr;
+        uint32_t threadCount = 1;
+        uint32_t currentFrame = 0;
+        std::vector<FrameState> frames;
+    };
+}
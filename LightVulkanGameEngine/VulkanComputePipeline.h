@@ -0,0 +1,81 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "VulkanDevice.h"
+#include "VulkanShaderModule.h"
+
+namespace LightVulkan {
+    // Compute pipeline with its own layout. Unlike the graphics pipeline nothing here depends on the render pass
+    // or the swap chain, so it is created once and survives swap chain recreation.
+    class VulkanComputePipeline {
+    public:
+        void create(VulkanDevice& device, const std::vector<uint32_t>& shaderCode, const std::vector<VkDescriptorSetLayout>& setLayouts, uint32_t pushConstantSize) {
+            VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+            pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+            pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+
+            VkPushConstantRange pushConstantRange{};
+            pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            pushConstantRange.offset = 0;
+            pushConstantRange.size = pushConstantSize;
+            if (pushConstantSize > 0) {
+                pipelineLayoutInfo.pushConstantRangeCount = 1;
+                pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+            }
+
+            if (vkCreatePipelineLayout(device.getLogicalDevice(), &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create compute pipeline layout!");
+            }
+
+            pipeline = createPipeline(device, shaderCode);
+        }
+        // Builds the pipeline from new code with the same layout and returns the old one, which the caller retires
+        // once no submitted frame uses it
+        VkPipeline replaceShader(VulkanDevice& device, const std::vector<uint32_t>& shaderCode) {
+            VkPipeline oldPipeline = pipeline;
+            pipeline = createPipeline(device, shaderCode);
+            return oldPipeline;
+        }
+        void destroy(VulkanDevice& device) {
+            vkDestroyPipeline(device.getLogicalDevice(), pipeline, nullptr);
+            vkDestroyPipelineLayout(device.getLogicalDevice(), layout, nullptr);
+        }
+        VkPipeline get() {
+            return pipeline;
+        }
+        VkPipelineLayout getLayout() {
+            return layout;
+        }
+
+    private:
+        VkPipeline createPipeline(VulkanDevice& device, const std::vector<uint32_t>& shaderCode) {
+            VulkanShaderModule shaderModule(device, shaderCode);
+
+            VkComputePipelineCreateInfo pipelineInfo{};
+            pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            pipelineInfo.stage.module = shaderModule.get();
+            pipelineInfo.stage.pName = "main";
+            pipelineInfo.layout = layout;
+
+            VkPipeline created = VK_NULL_HANDLE;
+            VkResult result = device.getPipelineCache().createComputePipeline(device.getLogicalDevice(), pipelineInfo, created);
+            shaderModule.destroy(device);
+            if (result != VK_SUCCESS) {
+                throw std::runtime_error("failed to create compute pipeline!");
+            }
+            return created;
+        }
+
+    private:
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+    };
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+namespace LightVulkan {
+    // Defers destruction of objects that submitted frames may still reference. Entries are tagged with the
+    // serial of the last frame submitted before they were retired and run once that frame's fence has signaled.
+    // An entry can be tagged with a later serial to outlive work the frame fences do not cover.
+    class VulkanDeletionQueue {
+    public:
+        void push(uint64_t serial, std::function<void()> deleter) {
+            entries.push_back({ serial, std::move(deleter) });
+        }
+        // Submissions on one queue complete in order, so everything up to completedSerial is idle. Entries due
+        // run in the order they were pushed, ones tagged further ahead stay behind without holding up the rest.
+        void collect(uint64_t completedSerial) {
+            for (auto entry = entries.begin(); entry != entries.end();) {
+                if (entry->serial <= completedSerial) {
+                    entry->deleter();
+                    entry = entries.erase(entry);
+                }
+                else {
+                    ++entry;
+                }
+            }
+        }
+        // Only after the device has gone idle
+        void flush() {
+            for (auto& entry : entries) {
+                entry.deleter();
+            }
+            entries.clear();
+        }
+        size_t size() {
+            return entries.size();
+        }
+
+    private:
+        struct Entry {
+            uint64_t serial;
+            std::function<void()> deleter;
+        };
+
+    private:
+        std::deque<Entry> entries;
+    };
+}
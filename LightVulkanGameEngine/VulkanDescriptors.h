@@ -0,0 +1,343 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "VulkanDevice.h"
+
+namespace LightVulkan {
+    // Equal binding lists share one VkDescriptorSetLayout, so layouts are requested by content wherever they are
+    // needed instead of being created and owned by hand. Layouts live until the cache is destroyed.
+    class VulkanDescriptorLayoutCache {
+    public:
+        VkDescriptorSetLayout get(VulkanDevice& device, std::vector<VkDescriptorSetLayoutBinding> bindings) {
+            std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+                return a.binding < b.binding;
+            });
+
+            LayoutKey key;
+            key.bindings = std::move(bindings);
+            for (const auto& binding : key.bindings) {
+                if (binding.pImmutableSamplers != nullptr) {
+                    key.immutableSamplers.insert(key.immutableSamplers.end(), binding.pImmutableSamplers, binding.pImmutableSamplers + binding.descriptorCount);
+                }
+            }
+
+            auto found = layouts.find(key);
+            if (found != layouts.end()) {
+                return found->second;
+            }
+
+            VkDescriptorSetLayoutCreateInfo layoutInfo{};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            layoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+            layoutInfo.pBindings = key.bindings.data();
+
+            VkDescriptorSetLayout layout;
+            if (vkCreateDescriptorSetLayout(device.getLogicalDevice(), &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create descriptor set layout!");
+            }
+            layouts.emplace(std::move(key), layout);
+            return layout;
+        }
+        void destroy(VulkanDevice& device) {
+            for (auto& entry : layouts) {
+                vkDestroyDescriptorSetLayout(device.getLogicalDevice(), entry.second, nullptr);
+            }
+            layouts.clear();
+        }
+        size_t size() {
+            return layouts.size();
+        }
+
+    private:
+        // Immutable sampler handles are copied out, the caller's arrays do not have to outlive the call
+        struct LayoutKey {
+            std::vector<VkDescriptorSetLayoutBinding> bindings;
+            std::vector<VkSampler> immutableSamplers;
+
+            bool operator==(const LayoutKey& other) const {
+                if (bindings.size() != other.bindings.size() || immutableSamplers != other.immutableSamplers) {
+                    return false;
+                }
+                for (size_t i = 0; i < bindings.size(); i++) {
+                    const VkDescriptorSetLayoutBinding& a = bindings[i];
+                    const VkDescriptorSetLayoutBinding& b = other.bindings[i];
+                    if (a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount ||
+                        a.stageFlags != b.stageFlags || (a.pImmutableSamplers == nullptr) != (b.pImmutableSamplers == nullptr)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        };
+
+        struct LayoutKeyHash {
+            size_t operator()(const LayoutKey& key) const noexcept {
+                uint64_t hash = 0x9E3779B97F4A7C15ull;
+                auto mix = [&hash](uint64_t value) {
+                    hash = (hash ^ value) * 0xBF58476D1CE4E5B9ull;
+                    hash ^= hash >> 29;
+                };
+                for (const auto& binding : key.bindings) {
+                    mix(binding.binding | (static_cast<uint64_t>(binding.descriptorType) << 32));
+                    mix(binding.descriptorCount | (static_cast<uint64_t>(binding.stageFlags) << 32));
+                }
+                for (VkSampler sampler : key.immutableSamplers) {
+                    mix(reinterpret_cast<uint64_t>(sampler));
+                }
+                return static_cast<size_t>(hash);
+            }
+        };
+
+    private:
+        std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> layouts;
+    };
+
+    // Descriptors of one type per set handed out by a pool, scaled by the pool's set count
+    struct DescriptorPoolRatio {
+        VkDescriptorType type;
+        float perSet;
+    };
+
+    // Hands out sets from a list of pools. When a pool runs out another one is taken, so callers never size pools
+    // for what they are going to allocate. reset releases every set at once and keeps the pools for reuse.
+    class VulkanDescriptorAllocator {
+    public:
+        static std::vector<DescriptorPoolRatio> getDefaultRatios() {
+            return {
+                { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+                { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+                { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+                { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f },
+                { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f },
+                { VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f },
+                { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0.5f }
+            };
+        }
+        void create(uint32_t setsPerPoolIn = 256, const std::vector<DescriptorPoolRatio>& ratiosIn = getDefaultRatios()) {
+            setsPerPool = std::max(1u, setsPerPoolIn);
+            ratios = ratiosIn;
+        }
+        void destroy(VulkanDevice& device) {
+            for (VkDescriptorPool pool : usedPools) {
+                vkDestroyDescriptorPool(device.getLogicalDevice(), pool, nullptr);
+            }
+            for (VkDescriptorPool pool : freePools) {
+                vkDestroyDescriptorPool(device.getLogicalDevice(), pool, nullptr);
+            }
+            usedPools.clear();
+            freePools.clear();
+            currentPool = VK_NULL_HANDLE;
+        }
+        VkDescriptorSet allocate(VulkanDevice& device, VkDescriptorSetLayout layout) {
+            if (currentPool == VK_NULL_HANDLE) {
+                currentPool = takePool(device);
+            }
+
+            VkDescriptorSet set;
+            VkResult result = allocateFrom(device, currentPool, layout, set);
+            if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+                currentPool = takePool(device);
+                result = allocateFrom(device, currentPool, layout, set);
+            }
+            if (result != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate descriptor set!");
+            }
+            return set;
+        }
+        // Every set from this allocator must be out of use
+        void reset(VulkanDevice& device) {
+            for (VkDescriptorPool pool : usedPools) {
+                vkResetDescriptorPool(device.getLogicalDevice(), pool, 0);
+                freePools.push_back(pool);
+            }
+            usedPools.clear();
+            currentPool = VK_NULL_HANDLE;
+        }
+        size_t getPoolCount() {
+            return usedPools.size() + freePools.size();
+        }
+
+    private:
+        VkResult allocateFrom(VulkanDevice& device, VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet& set) {
+            VkDescriptorSetAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = pool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &layout;
+            return vkAllocateDescriptorSets(device.getLogicalDevice(), &allocInfo, &set);
+        }
+        VkDescriptorPool takePool(VulkanDevice& device) {
+            VkDescriptorPool pool;
+            if (!freePools.empty()) {
+                pool = freePools.back();
+                freePools.pop_back();
+            }
+            else {
+                pool = createPool(device);
+            }
+            usedPools.push_back(pool);
+            return pool;
+        }
+        VkDescriptorPool createPool(VulkanDevice& device) {
+            std::vector<VkDescriptorPoolSize> poolSizes;
+            for (const auto& ratio : ratios) {
+                poolSizes.push_back({ ratio.type, std::max(1u, static_cast<uint32_t>(ratio.perSet * setsPerPool)) });
+            }
+
+            VkDescriptorPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+            poolInfo.pPoolSizes = poolSizes.data();
+            poolInfo.maxSets = setsPerPool;
+
+            VkDescriptorPool pool;
+            if (vkCreateDescriptorPool(device.getLogicalDevice(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create descriptor pool!");
+            }
+            return pool;
+        }
+
+    private:
+        uint32_t setsPerPool = 256;
+        std::vector<DescriptorPoolRatio> ratios;
+        VkDescriptorPool currentPool = VK_NULL_HANDLE;
+        // Every pool in usedPools has handed out sets since the last reset, currentPool is its last entry
+        std::vector<VkDescriptorPool> usedPools;
+        std::vector<VkDescriptorPool> freePools;
+    };
+
+    // A descriptor allocator per frame in flight. Sets for one frame are allocated and written while it is
+    // recorded and all released together once its fence has signaled, nothing is freed one set at a time.
+    class VulkanFrameDescriptorAllocator {
+    public:
+        void create(uint32_t frameCount, uint32_t setsPerPool = 64) {
+            allocators.resize(frameCount);
+            for (auto& allocator : allocators) {
+                allocator.create(setsPerPool);
+            }
+            current = 0;
+        }
+        void destroy(VulkanDevice& device) {
+            for (auto& allocator : allocators) {
+                allocator.destroy(device);
+            }
+            allocators.clear();
+        }
+        // The caller must have waited on the fence of the frame that last used this slot
+        void beginFrame(VulkanDevice& device, uint32_t frameIndex) {
+            current = frameIndex % static_cast<uint32_t>(allocators.size());
+            allocators[current].reset(device);
+        }
+        VkDescriptorSet allocate(VulkanDevice& device, VkDescriptorSetLayout layout) {
+            return allocators[current].allocate(device, layout);
+        }
+        size_t getPoolCount() {
+            size_t count = 0;
+            for (auto& allocator : allocators) {
+                count += allocator.getPoolCount();
+            }
+            return count;
+        }
+
+    private:
+        std::vector<VulkanDescriptorAllocator> allocators;
+        uint32_t current = 0;
+    };
+
+    // Writes every binding of a set from one struct with vkUpdateDescriptorSetWithTemplate. Each entry names the
+    // offset of its VkDescriptorBufferInfo, VkDescriptorImageInfo or VkBufferView in that struct. Devices older than 1.1 get the
+    // same writes through vkUpdateDescriptorSets.
+    class VulkanDescriptorUpdateTemplate {
+    public:
+        static VkDescriptorUpdateTemplateEntry makeEntry(uint32_t binding, VkDescriptorType type, size_t offset, uint32_t count = 1, size_t stride = 0) {
+            VkDescriptorUpdateTemplateEntry entry{};
+            entry.dstBinding = binding;
+            entry.dstArrayElement = 0;
+            entry.descriptorCount = count;
+            entry.descriptorType = type;
+            entry.offset = offset;
+            entry.stride = stride;
+            return entry;
+        }
+        void create(VulkanDevice& device, VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntry>& entriesIn) {
+            entries = entriesIn;
+
+            VkPhysicalDeviceProperties properties{};
+            vkGetPhysicalDeviceProperties(device.getPhysicalDevice(), &properties);
+            if (properties.apiVersion < VK_API_VERSION_1_1) {
+                updateTemplate = VK_NULL_HANDLE;
+                return;
+            }
+
+            VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+            templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+            templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+            templateInfo.pDescriptorUpdateEntries = entries.data();
+            templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+            templateInfo.descriptorSetLayout = layout;
+
+            if (vkCreateDescriptorUpdateTemplate(device.getLogicalDevice(), &templateInfo, nullptr, &updateTemplate) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create descriptor update template!");
+            }
+        }
+        void destroy(VulkanDevice& device) {
+            if (updateTemplate != VK_NULL_HANDLE) {
+                vkDestroyDescriptorUpdateTemplate(device.getLogicalDevice(), updateTemplate, nullptr);
+                updateTemplate = VK_NULL_HANDLE;
+            }
+            entries.clear();
+        }
+        void update(VulkanDevice& device, VkDescriptorSet set, const void* data) {
+            if (updateTemplate != VK_NULL_HANDLE) {
+                vkUpdateDescriptorSetWithTemplate(device.getLogicalDevice(), set, updateTemplate, data);
+                return;
+            }
+
+            const char* bytes = static_cast<const char*>(data);
+            writes.clear();
+            for (const auto& entry : entries) {
+                for (uint32_t i = 0; i < entry.descriptorCount; i++) {
+                    const void* info = bytes + entry.offset + entry.stride * i;
+
+                    VkWriteDescriptorSet write{};
+                    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                    write.dstSet = set;
+                    write.dstBinding = entry.dstBinding;
+                    write.dstArrayElement = entry.dstArrayElement + i;
+                    write.descriptorType = entry.descriptorType;
+                    write.descriptorCount = 1;
+                    if (isBufferType(entry.descriptorType)) {
+                        write.pBufferInfo = static_cast<const VkDescriptorBufferInfo*>(info);
+                    }
+                    else if (entry.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER || entry.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER) {
+                        write.pTexelBufferView = static_cast<const VkBufferView*>(info);
+                    }
+                    else {
+                        write.pImageInfo = static_cast<const VkDescriptorImageInfo*>(info);
+                    }
+                    writes.push_back(write);
+                }
+            }
+            vkUpdateDescriptorSets(device.getLogicalDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        }
+
+    private:
+        static bool isBufferType(VkDescriptorType type) {
+            return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+                type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        }
+
+    private:
+        VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
+        std::vector<VkDescriptorUpdateTemplateEntry> entries;
+        std::vector<VkWriteDescriptorSet> writes;
+    };
+}
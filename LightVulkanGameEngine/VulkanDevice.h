@@ -5,6 +5,8 @@
 
 #include "VulkanPhysicalDevice.h"
 #include "VulkanLogicalDevice.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanPipelineCache.h"
 #include "Window.h"
 
 const std::vector<const char*> deviceExtensions = {
@@ -18,8 +20,16 @@ namespace LightVulkan {
             surface.setUp(instance, window);
             physicalDevice.pick(instance, msaaSamples, surface.get(), deviceExtensions);
             device.setUp(physicalDevice.get(), surface.get(), deviceExtensions);
+            allocator.create(physicalDevice.get(), device.get());
+        }
+        void setUpHeadless(VulkanInstance& instance, VkSampleCountFlagBits& msaaSamples) {
+            physicalDevice.pick(instance, msaaSamples, VK_NULL_HANDLE, {});
+            device.setUp(physicalDevice.get(), VK_NULL_HANDLE, {});
+            allocator.create(physicalDevice.get(), device.get());
         }
         void destroy(VkInstance& instance) {
+            pipelineCache.destroy(device.get());
+            allocator.destroy();
             vkDestroyDevice(device.get(), nullptr);
             surface.destroy(instance);
         }
@@ -35,18 +45,37 @@ namespace LightVulkan {
         VkQueue getPresentQueue() {
             return device.getPresentQueue();
         }
+        VkQueue getTransferQueue() {
+            return device.getTransferQueue();
+        }
+        QueueFamilyIndices getQueueFamilies() {
+            return findQueueFamilies(physicalDevice.get(), surface.get());
+        }
         VkCommandPool getCommandPool() {
             return device.getCommandPool();
         }
         VkSurfaceKHR getSurface() {
             return surface.get();
         }
+        VulkanMemoryAllocator& getAllocator() {
+            return allocator;
+        }
+        const DeviceFeatures& getFeatures() {
+            return device.getFeatures();
+        }
+        VulkanPipelineCache& getPipelineCache() {
+            return pipelineCache;
+        }
+        void createPipelineCache(const std::string& path, bool loadFromDisk) {
+            pipelineCache.create(physicalDevice.get(), device.get(), path, loadFromDisk);
+        }
         void createCommandPool() {
             QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice.get(), surface.get());
 
             VkCommandPoolCreateInfo poolInfo{};
             poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
             poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
             if (vkCreateCommandPool(device.get(), &poolInfo, nullptr, &device.getCommandPool()) != VK_SUCCESS) {
                 throw std::runtime_error("failed to create graphics command pool!");
@@ -57,6 +86,8 @@ namespace LightVulkan {
         VulkanPhysicalDevice physicalDevice;
         VulkanLogicalDevice device;
         VulkanSurfaceKHR surface;
+        VulkanMemoryAllocator allocator;
+        VulkanPipelineCache pipelineCache;
     };
 
 }
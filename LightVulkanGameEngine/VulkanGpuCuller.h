@@ -0,0 +1,247 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+#include "VulkanUploadManager.h"
+#include "VulkanComputePipeline.h"
+#include "VulkanDeletionQueue.h"
+#include "FrustumCulling.h"
+
+namespace LightVulkan {
+    // Matches GpuObject in cullShader.comp (std430). The sphere must contain the object for every transform it can
+    // take without the object buffer being rewritten, firstInstance selects its InstanceData.
+    struct GpuCullObject {
+        glm::vec4 sphere;
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t firstInstance;
+    };
+
+    // GPU driven culling. A compute pass tests every object sphere against the frustum and writes one
+    // VkDrawIndexedIndirectCommand per visible object plus a draw count, which the render pass consumes without
+    // the CPU touching individual objects. With drawIndirectCount the commands are compacted and drawn with
+    // vkCmdDrawIndexedIndirectCount, otherwise every object keeps its slot, culled ones with instanceCount 0.
+    class VulkanGpuCuller {
+    public:
+        // Needs multiDrawIndirect, and drawIndirectFirstInstance since every command addresses its own instance
+        static bool isSupported(VulkanDevice& device) {
+            const DeviceFeatures& features = device.getFeatures();
+            return features.multiDrawIndirect && features.drawIndirectFirstInstance;
+        }
+        void create(VulkanDevice& device, VulkanUploadManager& uploadManager, const std::vector<GpuCullObject>& objects, uint32_t frameCount,
+            const std::vector<uint32_t>& shaderCode) {
+            if (!isSupported(device)) {
+                throw std::runtime_error("GPU culling needs multiDrawIndirect and drawIndirectFirstInstance!");
+            }
+
+            VkPhysicalDeviceProperties properties{};
+            vkGetPhysicalDeviceProperties(device.getPhysicalDevice(), &properties);
+            if (objects.size() > properties.limits.maxDrawIndirectCount) {
+                throw std::runtime_error("object count exceeds maxDrawIndirectCount!");
+            }
+
+            objectCount = static_cast<uint32_t>(objects.size());
+            compact = device.getFeatures().drawIndirectCount;
+
+            VkDeviceSize objectBufferSize = sizeof(GpuCullObject) * std::max(1u, objectCount);
+            objectBuffer.create(device, objectBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            if (objectCount > 0) {
+                uploadManager.uploadBuffer(device, objectBuffer, objects.data(), sizeof(GpuCullObject) * objectCount,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            }
+
+            frames.resize(frameCount);
+            for (auto& frame : frames) {
+                frame.commandBuffer.create(device, sizeof(VkDrawIndexedIndirectCommand) * std::max(1u, objectCount),
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+                // Host visible so the result can be read back once the frame's fence has signaled
+                frame.countBuffer.create(device, sizeof(uint32_t),
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            }
+
+            createDescriptorSets(device);
+            pipeline.create(device, shaderCode, { descriptorSetLayout }, sizeof(PushConstants));
+        }
+        // Frames already submitted keep the old pipeline until their fences signal
+        void reloadShader(VulkanDevice& device, const std::vector<uint32_t>& shaderCode, VulkanDeletionQueue& deletionQueue, uint64_t serial) {
+            VkDevice logicalDevice = device.getLogicalDevice();
+            VkPipeline oldPipeline = pipeline.replaceShader(device, shaderCode);
+            deletionQueue.push(serial, [logicalDevice, oldPipeline]() {
+                vkDestroyPipeline(logicalDevice, oldPipeline, nullptr);
+            });
+        }
+        void destroy(VulkanDevice& device) {
+            pipeline.destroy(device);
+            vkDestroyDescriptorPool(device.getLogicalDevice(), descriptorPool, nullptr);
+            vkDestroyDescriptorSetLayout(device.getLogicalDevice(), descriptorSetLayout, nullptr);
+            for (auto& frame : frames) {
+                frame.countBuffer.destroy(device);
+                frame.commandBuffer.destroy(device);
+            }
+            frames.clear();
+            objectBuffer.destroy(device);
+        }
+        // Outside a render pass. The frame's command and count buffers are left as compute shader writes, the caller
+        // makes them visible to the draw indirect stage and the host.
+        void cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const Frustum& frustum) {
+            FrameState& frame = frames[frameIndex % frames.size()];
+
+            vkCmdFillBuffer(commandBuffer, frame.countBuffer.getBuffer(), 0, sizeof(uint32_t), 0);
+
+            VkMemoryBarrier clearBarrier{};
+            clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+            PushConstants pushConstants{};
+            for (int i = 0; i < Frustum::PlaneCount; i++) {
+                pushConstants.planes[i] = frustum.planes[i];
+            }
+            pushConstants.objectCount = objectCount;
+            pushConstants.compact = compact ? 1 : 0;
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.get());
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.getLayout(), 0, 1, &frame.descriptorSet, 0, nullptr);
+            vkCmdPushConstants(commandBuffer, pipeline.getLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+            vkCmdDispatch(commandBuffer, (objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+        }
+        // Inside the render pass with the pipeline, vertex, index and instance buffers already bound
+        void draw(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+            FrameState& frame = frames[frameIndex % frames.size()];
+            if (objectCount == 0) {
+                return;
+            }
+            if (compact) {
+                vkCmdDrawIndexedIndirectCount(commandBuffer, frame.commandBuffer.getBuffer(), 0, frame.countBuffer.getBuffer(), 0,
+                    objectCount, sizeof(VkDrawIndexedIndirectCommand));
+            }
+            else {
+                vkCmdDrawIndexedIndirect(commandBuffer, frame.commandBuffer.getBuffer(), 0, objectCount, sizeof(VkDrawIndexedIndirectCommand));
+            }
+        }
+        VkBuffer getCommandBuffer(uint32_t frameIndex) {
+            return frames[frameIndex % frames.size()].commandBuffer.getBuffer();
+        }
+        VkBuffer getCountBuffer(uint32_t frameIndex) {
+            return frames[frameIndex % frames.size()].countBuffer.getBuffer();
+        }
+        // Only valid after the fence of the frame that last culled into this slot has signaled
+        uint32_t getVisibleCount(uint32_t frameIndex) {
+            return *static_cast<uint32_t*>(frames[frameIndex % frames.size()].countBuffer.getMappedData());
+        }
+        uint32_t getObjectCount() {
+            return objectCount;
+        }
+        bool isCompacting() {
+            return compact;
+        }
+
+    private:
+        static const uint32_t WORKGROUP_SIZE = 64;
+
+        // Matches CullPushConstants in cullShader.comp, 104 of the guaranteed 128 bytes
+        struct PushConstants {
+            glm::vec4 planes[Frustum::PlaneCount];
+            uint32_t objectCount;
+            uint32_t compact;
+        };
+
+        struct FrameState {
+            VulkanBuffer commandBuffer;
+            VulkanBuffer countBuffer;
+            VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        };
+
+        void createDescriptorSets(VulkanDevice& device) {
+            std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+            for (uint32_t i = 0; i < bindings.size(); i++) {
+                bindings[i].binding = i;
+                bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                bindings[i].descriptorCount = 1;
+                bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            }
+
+            VkDescriptorSetLayoutCreateInfo layoutInfo{};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+            layoutInfo.pBindings = bindings.data();
+
+            if (vkCreateDescriptorSetLayout(device.getLogicalDevice(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create culling descriptor set layout!");
+            }
+
+            uint32_t frameCount = static_cast<uint32_t>(frames.size());
+            VkDescriptorPoolSize poolSize{};
+            poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            poolSize.descriptorCount = static_cast<uint32_t>(bindings.size()) * frameCount;
+
+            VkDescriptorPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            poolInfo.poolSizeCount = 1;
+            poolInfo.pPoolSizes = &poolSize;
+            poolInfo.maxSets = frameCount;
+
+            if (vkCreateDescriptorPool(device.getLogicalDevice(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create culling descriptor pool!");
+            }
+
+            for (auto& frame : frames) {
+                VkDescriptorSetAllocateInfo allocInfo{};
+                allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+                allocInfo.descriptorPool = descriptorPool;
+                allocInfo.descriptorSetCount = 1;
+                allocInfo.pSetLayouts = &descriptorSetLayout;
+
+                if (vkAllocateDescriptorSets(device.getLogicalDevice(), &allocInfo, &frame.descriptorSet) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to allocate culling descriptor set!");
+                }
+
+                std::array<VkDescriptorBufferInfo, 3> bufferInfos{};
+                bufferInfos[0].buffer = objectBuffer.getBuffer();
+                bufferInfos[0].range = VK_WHOLE_SIZE;
+                bufferInfos[1].buffer = frame.commandBuffer.getBuffer();
+                bufferInfos[1].range = VK_WHOLE_SIZE;
+                bufferInfos[2].buffer = frame.countBuffer.getBuffer();
+                bufferInfos[2].range = VK_WHOLE_SIZE;
+
+                std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+                for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+                    descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                    descriptorWrites[i].dstSet = frame.descriptorSet;
+                    descriptorWrites[i].dstBinding = i;
+                    descriptorWrites[i].dstArrayElement = 0;
+                    descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                    descriptorWrites[i].descriptorCount = 1;
+                    descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+                }
+
+                vkUpdateDescriptorSets(device.getLogicalDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+            }
+        }
+
+    private:
+        uint32_t objectCount = 0;
+        bool compact = false;
+        VulkanBuffer objectBuffer;
+        std::vector<FrameState> frames;
+
+        VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+        VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+        VulkanComputePipeline pipeline;
+    };
+}
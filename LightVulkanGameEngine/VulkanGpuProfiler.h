@@ -0,0 +1,165 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+#include "VulkanDevice.h"
+#include "Profiler.h"
+
+namespace LightVulkan {
+    // Timestamp pairs around GPU work, one query pool per frame in flight. A frame's results are read back when
+    // its slot is recorded again, after its fence, so reading never waits on the GPU. Timestamps are placed on
+    // the CPU timeline relative to when the frame started recording, the clocks are not calibrated against
+    // each other, so GPU events show durations and ordering, not exact overlap with CPU work.
+    class VulkanGpuProfiler {
+    public:
+        static bool isSupported(VulkanDevice& device) {
+            VkPhysicalDeviceProperties properties{};
+            vkGetPhysicalDeviceProperties(device.getPhysicalDevice(), &properties);
+            return properties.limits.timestampComputeAndGraphics == VK_TRUE && getValidBits(device) > 0;
+        }
+        void create(VulkanDevice& device, uint32_t frameCount, uint32_t maxScopesIn = 64) {
+            VkPhysicalDeviceProperties properties{};
+            vkGetPhysicalDeviceProperties(device.getPhysicalDevice(), &properties);
+            timestampPeriod = properties.limits.timestampPeriod;
+            uint32_t validBits = getValidBits(device);
+            validMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+            maxScopes = maxScopesIn;
+
+            frames.resize(frameCount);
+            for (auto& frame : frames) {
+                VkQueryPoolCreateInfo poolInfo{};
+                poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+                poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+                poolInfo.queryCount = maxScopes * 2;
+
+                if (vkCreateQueryPool(device.getLogicalDevice(), &poolInfo, nullptr, &frame.queryPool) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create timestamp query pool!");
+                }
+                frame.names.reserve(maxScopes);
+            }
+            results.resize(maxScopes * 2);
+        }
+        void destroy(VulkanDevice& device) {
+            for (auto& frame : frames) {
+                vkDestroyQueryPool(device.getLogicalDevice(), frame.queryPool, nullptr);
+            }
+            frames.clear();
+        }
+        bool isCreated() {
+            return !frames.empty();
+        }
+
+        // First thing recorded into the frame's command buffer, outside any render pass. The frame's fence must have
+        // signaled, the scopes it recorded last time are handed to the Profiler before the pool is reset.
+        void beginFrame(VulkanDevice& device, VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+            if (frames.empty()) {
+                return;
+            }
+            currentFrame = frameIndex % static_cast<uint32_t>(frames.size());
+            FrameQueries& frame = frames[currentFrame];
+            readResults(device, frame);
+
+            vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, maxScopes * 2);
+            frame.names.clear();
+            frame.recordStartNs = Profiler::get().now();
+        }
+        // UINT32_MAX once the frame's scopes are used up, endScope ignores it
+        uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name) {
+            if (frames.empty() || frames[currentFrame].names.size() >= maxScopes) {
+                return UINT32_MAX;
+            }
+            FrameQueries& frame = frames[currentFrame];
+            uint32_t scope = static_cast<uint32_t>(frame.names.size());
+            frame.names.push_back(name);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, scope * 2);
+            return scope;
+        }
+        void endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+            if (scope == UINT32_MAX) {
+                return;
+            }
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frames[currentFrame].queryPool, scope * 2 + 1);
+        }
+        // From the first scope's begin to the last end of the frame read back by the latest beginFrame, once per frame
+        bool consumeFrameTime(std::chrono::nanoseconds& time) {
+            bool read = frameTimeRead;
+            time = frameTime;
+            frameTimeRead = false;
+            return read;
+        }
+
+    private:
+        struct FrameQueries {
+            VkQueryPool queryPool = VK_NULL_HANDLE;
+            // Interned or literal, one per scope in query order
+            std::vector<const char*> names;
+            int64_t recordStartNs = 0;
+        };
+
+        static uint32_t getValidBits(VulkanDevice& device) {
+            uint32_t familyCount = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(device.getPhysicalDevice(), &familyCount, nullptr);
+            std::vector<VkQueueFamilyProperties> families(familyCount);
+            vkGetPhysicalDeviceQueueFamilyProperties(device.getPhysicalDevice(), &familyCount, families.data());
+            return families[device.getQueueFamilies().graphicsFamily.value()].timestampValidBits;
+        }
+        void readResults(VulkanDevice& device, FrameQueries& frame) {
+            if (frame.names.empty()) {
+                return;
+            }
+            uint32_t queryCount = static_cast<uint32_t>(frame.names.size()) * 2;
+            VkResult result = vkGetQueryPoolResults(device.getLogicalDevice(), frame.queryPool, 0, queryCount,
+                queryCount * sizeof(uint64_t), results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+            // Not every scope was ended, or the frame never got submitted
+            if (result != VK_SUCCESS) {
+                return;
+            }
+
+            uint64_t origin = results[0] & validMask;
+            uint64_t frameEnd = 0;
+            for (size_t i = 0; i < frame.names.size(); i++) {
+                uint64_t begin = (results[i * 2] - origin) & validMask;
+                uint64_t end = (results[i * 2 + 1] - origin) & validMask;
+                frameEnd = std::max(frameEnd, end);
+                Profiler::get().recordGpu(frame.names[i],
+                    frame.recordStartNs + static_cast<int64_t>(begin * timestampPeriod),
+                    frame.recordStartNs + static_cast<int64_t>(end * timestampPeriod));
+            }
+            frameTime = std::chrono::nanoseconds(static_cast<int64_t>(frameEnd * timestampPeriod));
+            frameTimeRead = true;
+        }
+
+    private:
+        std::vector<FrameQueries> frames;
+        uint32_t currentFrame = 0;
+        uint32_t maxScopes = 0;
+        float timestampPeriod = 1.0f;
+        uint64_t validMask = ~0ull;
+        std::vector<uint64_t> results;
+        std::chrono::nanoseconds frameTime{ 0 };
+        bool frameTimeRead = false;
+    };
+
+    // Times the commands recorded in the enclosing block
+    class GpuProfileScope {
+    public:
+        GpuProfileScope(VulkanGpuProfiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+            : profiler(profiler), commandBuffer(commandBuffer), scope(profiler.beginScope(commandBuffer, name)) {}
+        ~GpuProfileScope() {
+            profiler.endScope(commandBuffer, scope);
+        }
+        GpuProfileScope(const GpuProfileScope&) = delete;
+        GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+    private:
+        VulkanGpuProfiler& profiler;
+        VkCommandBuffer commandBuffer;
+        uint32_t scope;
+    };
+}
@@ -12,7 +12,7 @@
 namespace LightVulkan {
 	class VulkanImage {
 	public:
-		void createImage(VulkanDevice& device, uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceMemory& imageMemory) {
+		void createImage(VulkanDevice& device, uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VulkanAllocation& allocation) {
 			VkImageCreateInfo imageInfo{};
 			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 			imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -35,16 +35,10 @@ namespace LightVulkan {
 			VkMemoryRequirements memRequirements;
 			vkGetImageMemoryRequirements(device.getLogicalDevice(), image, &memRequirements);
 
-			VkMemoryAllocateInfo allocInfo{};
-			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-			allocInfo.allocationSize = memRequirements.size;
-			allocInfo.memoryTypeIndex = Utils::findMemoryType(device.getPhysicalDevice(), memRequirements.memoryTypeBits, properties);
+			AllocationKind kind = tiling == VK_IMAGE_TILING_OPTIMAL ? AllocationKind::Optimal : AllocationKind::Linear;
+			allocation = device.getAllocator().allocate(memRequirements, properties, kind);
 
-			if (vkAllocateMemory(device.getLogicalDevice(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-				throw std::runtime_error("failed to allocate image memory!");
-			}
-
-			vkBindImageMemory(device.getLogicalDevice(), image, imageMemory, 0);
+			vkBindImageMemory(device.getLogicalDevice(), image, allocation.memory, allocation.offset);
 		}
         void destroy(VkDevice device) {
             vkDestroyImage(device, image, nullptr);
@@ -77,6 +71,6 @@ namespace LightVulkan {
             commandBuffer.endSingleTimeCommands();
         }
     private:
-        VkImage image;
+        VkImage image = VK_NULL_HANDLE;
     };
 }
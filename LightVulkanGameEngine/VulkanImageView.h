@@ -31,6 +31,6 @@ namespace LightVulkan {
 			return imageView;
 		}
 	private:
-		VkImageView imageView;
+		VkImageView imageView = VK_NULL_HANDLE;
 	};
 }
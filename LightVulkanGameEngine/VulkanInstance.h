@@ -9,7 +9,7 @@
 namespace LightVulkan {
     class VulkanInstance {
     public:
-        void setUp(VulkanDebugMessenger& debugMessenger) {
+        void setUp(VulkanDebugMessenger& debugMessenger, bool headless = false) {
             if (enableValidationLayers && !checkValidationLayerSupport(validationLayers)) {
                 throw std::runtime_error("validation layers requested, but not available!");
             }
@@ -20,13 +20,14 @@ namespace LightVulkan {
             appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
             appInfo.pEngineName = "No Engine";
             appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-            appInfo.apiVersion = VK_API_VERSION_1_0;
+            // Highest version the engine uses, older devices are still picked and report the newer features as missing
+            appInfo.apiVersion = VK_API_VERSION_1_2;
 
             VkInstanceCreateInfo createInfo{};
             createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
             createInfo.pApplicationInfo = &appInfo;
 
-            auto extensions = getRequiredExtensions();
+            auto extensions = getRequiredExtensions(headless);
             createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
             createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -0,0 +1,66 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+#include "Vertex.h"
+
+namespace LightVulkan {
+    // Persistently mapped vertex buffer of InstanceData with a region per frame in flight. The whole buffer stays
+    // bound to InstanceData::BINDING, draws select their slice through firstInstance instead of rebinding.
+    class VulkanInstanceBuffer {
+    public:
+        void create(VulkanDevice& device, uint32_t frameCapacityIn, uint32_t frameCountIn) {
+            frameCapacity = std::max(1u, frameCapacityIn);
+            frameCount = frameCountIn;
+
+            buffer.create(device, sizeof(InstanceData) * frameCapacity * frameCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+            mapped = static_cast<InstanceData*>(buffer.getMappedData());
+            if (mapped == nullptr) {
+                throw std::runtime_error("failed to map instance buffer!");
+            }
+            beginFrame(0);
+        }
+        void destroy(VulkanDevice& device) {
+            buffer.destroy(device);
+            mapped = nullptr;
+        }
+        // The caller must have waited on the fence of the frame that last used this region
+        void beginFrame(uint32_t frameIndex) {
+            frameBegin = frameCapacity * (frameIndex % frameCount);
+            head = frameBegin;
+        }
+        // Returns count slots to fill this frame, firstInstance is what the draw passes to address them
+        InstanceData* allocate(uint32_t count, uint32_t& firstInstance) {
+            if (head + count > frameBegin + frameCapacity) {
+                throw std::runtime_error("instance buffer frame region exhausted!");
+            }
+            firstInstance = head;
+            head += count;
+            return mapped + firstInstance;
+        }
+        void bind(VkCommandBuffer commandBuffer) {
+            VkBuffer buffers[] = { buffer.getBuffer() };
+            VkDeviceSize offsets[] = { 0 };
+            vkCmdBindVertexBuffers(commandBuffer, InstanceData::BINDING, 1, buffers, offsets);
+        }
+        uint32_t getFrameCapacity() {
+            return frameCapacity;
+        }
+
+    private:
+        VulkanBuffer buffer;
+        InstanceData* mapped = nullptr;
+        uint32_t frameCapacity = 0;
+        uint32_t frameCount = 1;
+        uint32_t frameBegin = 0;
+        uint32_t head = 0;
+    };
+}
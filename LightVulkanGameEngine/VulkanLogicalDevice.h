@@ -9,13 +9,24 @@
 #include "VulkanQueueFamily.h"
 
 namespace LightVulkan {
+	// Optional features, enabled whenever the physical device has them
+	struct DeviceFeatures {
+		bool multiDrawIndirect = false;
+		bool drawIndirectFirstInstance = false;
+		// Core in 1.2, vkCmdDrawIndexedIndirectCount must not be called without it
+		bool drawIndirectCount = false;
+		bool textureCompressionBC = false;
+		// Runtime sized, partially bound sampled image arrays that can be written while in use, needed by the bindless table
+		bool descriptorIndexing = false;
+	};
+
 	class VulkanLogicalDevice {
 	public:
 		void setUp(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, const std::vector<const char*> deviceExtensions) {
 			QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
 
 			std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-			std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+			std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value(), indices.transferFamily.value() };
 
 			float queuePriority = 1.0f;
 			for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -27,11 +38,53 @@ namespace LightVulkan {
 				queueCreateInfos.push_back(queueCreateInfo);
 			}
 
+			VkPhysicalDeviceProperties properties{};
+			vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+			bool vulkan12 = properties.apiVersion >= VK_API_VERSION_1_2;
+
+			VkPhysicalDeviceFeatures supported{};
+			vkGetPhysicalDeviceFeatures(physicalDevice, &supported);
+
+			VkPhysicalDeviceVulkan12Features supported12{};
+			supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+			if (vulkan12) {
+				VkPhysicalDeviceFeatures2 supported2{};
+				supported2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+				supported2.pNext = &supported12;
+				vkGetPhysicalDeviceFeatures2(physicalDevice, &supported2);
+			}
+
+			features.multiDrawIndirect = supported.multiDrawIndirect == VK_TRUE;
+			features.drawIndirectFirstInstance = supported.drawIndirectFirstInstance == VK_TRUE;
+			features.drawIndirectCount = vulkan12 && supported12.drawIndirectCount == VK_TRUE;
+			features.textureCompressionBC = supported.textureCompressionBC == VK_TRUE;
+			features.descriptorIndexing = vulkan12 && supported12.runtimeDescriptorArray == VK_TRUE &&
+				supported12.descriptorBindingPartiallyBound == VK_TRUE &&
+				supported12.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+				supported12.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+				supported12.shaderSampledImageArrayNonUniformIndexing == VK_TRUE;
+
 			VkPhysicalDeviceFeatures deviceFeatures{};
 			deviceFeatures.samplerAnisotropy = VK_TRUE;
+			deviceFeatures.multiDrawIndirect = supported.multiDrawIndirect;
+			deviceFeatures.drawIndirectFirstInstance = supported.drawIndirectFirstInstance;
+			deviceFeatures.textureCompressionBC = supported.textureCompressionBC;
+
+			VkPhysicalDeviceVulkan12Features deviceFeatures12{};
+			deviceFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+			deviceFeatures12.drawIndirectCount = features.drawIndirectCount ? VK_TRUE : VK_FALSE;
+			if (features.descriptorIndexing) {
+				deviceFeatures12.runtimeDescriptorArray = VK_TRUE;
+				deviceFeatures12.descriptorBindingPartiallyBound = VK_TRUE;
+				deviceFeatures12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+				deviceFeatures12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+				deviceFeatures12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+			}
 
 			VkDeviceCreateInfo createInfo{};
 			createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+			// The 1.2 feature struct can only be chained on devices that know it
+			createInfo.pNext = vulkan12 ? &deviceFeatures12 : nullptr;
 
 			createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 			createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -55,10 +108,14 @@ namespace LightVulkan {
 
 			vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 			vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+			vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
 		}
 		VkDevice get() {
 			return device;
 		}
+		const DeviceFeatures& getFeatures() {
+			return features;
+		}
         VkCommandPool& getCommandPool() {
             return commandPool;
         }
@@ -68,12 +125,17 @@ namespace LightVulkan {
         VkQueue& getPresentQueue() {
             return presentQueue;
         }
+        VkQueue& getTransferQueue() {
+            return transferQueue;
+        }
         
 	private:
 		VkDevice device;
 
         VkQueue graphicsQueue;
         VkQueue presentQueue;
+        VkQueue transferQueue;
         VkCommandPool commandPool = VK_NULL_HANDLE;
+		DeviceFeatures features;
 	};
 }
@@ -0,0 +1,530 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+namespace LightVulkan {
+
+    // Buffers and linear images must not share a page with optimal images when
+    // bufferImageGranularity > 1, so each kind gets its own blocks in that case.
+    enum class AllocationKind {
+        Linear,
+        Optimal
+    };
+
+    struct VulkanAllocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mappedData = nullptr;
+        uint32_t poolIndex = UINT32_MAX;
+        uint32_t blockIndex = UINT32_MAX;
+        uint32_t regionIndex = UINT32_MAX;
+    };
+
+    struct VulkanAllocatorStats {
+        uint32_t blockCount = 0;
+        uint32_t allocationCount = 0;
+        VkDeviceSize blockBytes = 0;
+        VkDeviceSize usedBytes = 0;
+        VkDeviceSize largestFreeRegion = 0;
+        // Share of free bytes that lie outside the largest free region of their block
+        float fragmentation = 0.0f;
+    };
+
+    // Two-level segregated fit bookkeeping for one device memory block.
+    // Works on offsets only, so it runs the same with or without a GPU.
+    class TlsfMetadata {
+    public:
+        static constexpr uint32_t INVALID_REGION = UINT32_MAX;
+
+        void init(VkDeviceSize size) {
+            regions.clear();
+            unusedRegions.clear();
+            flBitmap = 0;
+            std::fill(std::begin(slBitmap), std::end(slBitmap), 0u);
+            for (auto& heads : freeHeads) {
+                std::fill(std::begin(heads), std::end(heads), INVALID_REGION);
+            }
+            totalSize = size;
+            freeSize = 0;
+
+            uint32_t region = newRegion();
+            regions[region].offset = 0;
+            regions[region].size = size;
+            insertFree(region);
+        }
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& regionIndex) {
+            VkDeviceSize request = size + (alignment > 1 ? alignment - 1 : 0);
+            if (request > totalSize) {
+                return false;
+            }
+
+            uint32_t fl, sl;
+            mappingSearch(request, fl, sl);
+            uint32_t region = findSuitable(fl, sl);
+            if (region == INVALID_REGION) {
+                return false;
+            }
+            removeFree(region);
+
+            VkDeviceSize alignedOffset = alignUp(regions[region].offset, alignment);
+            VkDeviceSize padding = alignedOffset - regions[region].offset;
+            if (padding > 0) {
+                uint32_t front = newRegion();
+                regions[front].offset = regions[region].offset;
+                regions[front].size = padding;
+                linkBefore(front, region);
+                regions[region].offset = alignedOffset;
+                regions[region].size -= padding;
+                insertFree(front);
+            }
+
+            if (regions[region].size - size >= MIN_SPLIT_SIZE) {
+                uint32_t back = newRegion();
+                regions[back].offset = regions[region].offset + size;
+                regions[back].size = regions[region].size - size;
+                linkAfter(back, region);
+                regions[region].size = size;
+                insertFree(back);
+            }
+
+            offset = regions[region].offset;
+            regionIndex = region;
+            return true;
+        }
+        void free(uint32_t region) {
+            uint32_t prev = regions[region].prevPhysical;
+            if (prev != INVALID_REGION && regions[prev].free) {
+                removeFree(prev);
+                regions[prev].size += regions[region].size;
+                unlink(region);
+                region = prev;
+            }
+
+            uint32_t next = regions[region].nextPhysical;
+            if (next != INVALID_REGION && regions[next].free) {
+                removeFree(next);
+                regions[region].size += regions[next].size;
+                unlink(next);
+            }
+
+            insertFree(region);
+        }
+        VkDeviceSize getRegionSize(uint32_t region) const {
+            return regions[region].size;
+        }
+        VkDeviceSize getFreeSize() const {
+            return freeSize;
+        }
+        VkDeviceSize getLargestFreeRegion() const {
+            if (flBitmap == 0) {
+                return 0;
+            }
+            uint32_t fl = 63 - countLeadingZeros(flBitmap);
+            uint32_t sl = 63 - countLeadingZeros(slBitmap[fl]);
+            VkDeviceSize largest = 0;
+            for (uint32_t region = freeHeads[fl][sl]; region != INVALID_REGION; region = regions[region].nextFree) {
+                largest = std::max(largest, regions[region].size);
+            }
+            return largest;
+        }
+        bool isEmpty() const {
+            return freeSize == totalSize;
+        }
+
+    private:
+        static constexpr uint32_t SL_BITS = 4;
+        static constexpr uint32_t SL_COUNT = 1 << SL_BITS;
+        static constexpr uint32_t FL_COUNT = 48;
+        static constexpr VkDeviceSize MIN_SPLIT_SIZE = 16;
+
+        struct Region {
+            VkDeviceSize offset = 0;
+            VkDeviceSize size = 0;
+            uint32_t prevPhysical = INVALID_REGION;
+            uint32_t nextPhysical = INVALID_REGION;
+            uint32_t prevFree = INVALID_REGION;
+            uint32_t nextFree = INVALID_REGION;
+            bool free = false;
+        };
+
+        static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+            return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+        }
+        static uint32_t countLeadingZeros(uint64_t value) {
+            uint32_t count = 0;
+            for (uint64_t bit = 1ull << 63; bit != 0 && (value & bit) == 0; bit >>= 1) {
+                count++;
+            }
+            return count;
+        }
+        static uint32_t countTrailingZeros(uint64_t value) {
+            uint32_t count = 0;
+            while ((value & 1) == 0) {
+                value >>= 1;
+                count++;
+            }
+            return count;
+        }
+        static void mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl) {
+            if (size < SL_COUNT) {
+                fl = 0;
+                sl = static_cast<uint32_t>(size);
+                return;
+            }
+            uint32_t log2 = 63 - countLeadingZeros(size);
+            fl = log2 - SL_BITS + 1;
+            sl = static_cast<uint32_t>(size >> (log2 - SL_BITS)) - SL_COUNT;
+        }
+        static void mappingSearch(VkDeviceSize size, uint32_t& fl, uint32_t& sl) {
+            if (size >= SL_COUNT) {
+                uint32_t log2 = 63 - countLeadingZeros(size);
+                size += (VkDeviceSize(1) << (log2 - SL_BITS)) - 1;
+            }
+            mapping(size, fl, sl);
+        }
+
+        uint32_t findSuitable(uint32_t fl, uint32_t sl) const {
+            if (fl >= FL_COUNT) {
+                return INVALID_REGION;
+            }
+            uint32_t slMap = slBitmap[fl] & (~0u << sl);
+            if (slMap == 0) {
+                uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ull << (fl + 1)) : 0;
+                if (flMap == 0) {
+                    return INVALID_REGION;
+                }
+                fl = countTrailingZeros(flMap);
+                slMap = slBitmap[fl];
+            }
+            return freeHeads[fl][countTrailingZeros(slMap)];
+        }
+        uint32_t newRegion() {
+            if (!unusedRegions.empty()) {
+                uint32_t region = unusedRegions.back();
+                unusedRegions.pop_back();
+                regions[region] = Region{};
+                return region;
+            }
+            regions.emplace_back();
+            return static_cast<uint32_t>(regions.size() - 1);
+        }
+        void insertFree(uint32_t region) {
+            uint32_t fl, sl;
+            mapping(regions[region].size, fl, sl);
+            regions[region].free = true;
+            regions[region].prevFree = INVALID_REGION;
+            regions[region].nextFree = freeHeads[fl][sl];
+            if (freeHeads[fl][sl] != INVALID_REGION) {
+                regions[freeHeads[fl][sl]].prevFree = region;
+            }
+            freeHeads[fl][sl] = region;
+            flBitmap |= 1ull << fl;
+            slBitmap[fl] |= 1u << sl;
+            freeSize += regions[region].size;
+        }
+        void removeFree(uint32_t region) {
+            uint32_t fl, sl;
+            mapping(regions[region].size, fl, sl);
+            Region& r = regions[region];
+            if (r.prevFree != INVALID_REGION) {
+                regions[r.prevFree].nextFree = r.nextFree;
+            }
+            else {
+                freeHeads[fl][sl] = r.nextFree;
+            }
+            if (r.nextFree != INVALID_REGION) {
+                regions[r.nextFree].prevFree = r.prevFree;
+            }
+            if (freeHeads[fl][sl] == INVALID_REGION) {
+                slBitmap[fl] &= ~(1u << sl);
+                if (slBitmap[fl] == 0) {
+                    flBitmap &= ~(1ull << fl);
+                }
+            }
+            r.free = false;
+            r.prevFree = INVALID_REGION;
+            r.nextFree = INVALID_REGION;
+            freeSize -= r.size;
+        }
+        void linkBefore(uint32_t region, uint32_t next) {
+            regions[region].prevPhysical = regions[next].prevPhysical;
+            regions[region].nextPhysical = next;
+            if (regions[next].prevPhysical != INVALID_REGION) {
+                regions[regions[next].prevPhysical].nextPhysical = region;
+            }
+            regions[next].prevPhysical = region;
+        }
+        void linkAfter(uint32_t region, uint32_t prev) {
+            regions[region].nextPhysical = regions[prev].nextPhysical;
+            regions[region].prevPhysical = prev;
+            if (regions[prev].nextPhysical != INVALID_REGION) {
+                regions[regions[prev].nextPhysical].prevPhysical = region;
+            }
+            regions[prev].nextPhysical = region;
+        }
+        void unlink(uint32_t region) {
+            Region& r = regions[region];
+            if (r.prevPhysical != INVALID_REGION) {
+                regions[r.prevPhysical].nextPhysical = r.nextPhysical;
+            }
+            if (r.nextPhysical != INVALID_REGION) {
+                regions[r.nextPhysical].prevPhysical = r.prevPhysical;
+            }
+            unusedRegions.push_back(region);
+        }
+
+    private:
+        std::vector<Region> regions;
+        std::vector<uint32_t> unusedRegions;
+        uint64_t flBitmap = 0;
+        uint32_t slBitmap[FL_COUNT] = {};
+        uint32_t freeHeads[FL_COUNT][SL_COUNT];
+        VkDeviceSize totalSize = 0;
+        VkDeviceSize freeSize = 0;
+    };
+
+    // Sub-allocates buffers and images out of large per-memory-type blocks instead
+    // of calling vkAllocateMemory once per resource. Host visible blocks stay mapped
+    // for their whole lifetime. A simulated allocator never touches the device and
+    // is used to benchmark the sub-allocation strategy on the CPU.
+    class VulkanMemoryAllocator {
+    public:
+        void create(VkPhysicalDevice physicalDevice, VkDevice deviceIn) {
+            device = deviceIn;
+            simulated = false;
+
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+            vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+            init(properties.limits.bufferImageGranularity);
+        }
+        void createSimulated(const VkPhysicalDeviceMemoryProperties& memPropertiesIn, VkDeviceSize bufferImageGranularity) {
+            device = VK_NULL_HANDLE;
+            simulated = true;
+            memProperties = memPropertiesIn;
+
+            init(bufferImageGranularity);
+        }
+        void destroy() {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& pool : pools) {
+                for (auto& block : pool) {
+                    releaseBlock(block);
+                }
+                pool.clear();
+            }
+        }
+        VulkanAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationKind kind) {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+            uint32_t poolIndex = memoryTypeIndex * 2 + (separateKinds && kind == AllocationKind::Optimal ? 1 : 0);
+            std::vector<MemoryBlock>& pool = pools[poolIndex];
+            VkDeviceSize blockSize = preferredBlockSizes[memoryTypeIndex];
+
+            VulkanAllocation allocation{};
+            allocation.poolIndex = poolIndex;
+            allocation.size = requirements.size;
+
+            if (requirements.size > blockSize / 2) {
+                allocation.blockIndex = createBlock(pool, memoryTypeIndex, requirements.size, true);
+                MemoryBlock& block = pool[allocation.blockIndex];
+                block.allocationCount++;
+                allocation.memory = block.memory;
+                allocation.offset = 0;
+                allocation.mappedData = block.mapped;
+                return allocation;
+            }
+
+            for (uint32_t i = 0; i < pool.size(); i++) {
+                if (tryAllocate(pool[i], i, requirements, allocation)) {
+                    return allocation;
+                }
+            }
+
+            uint32_t blockIndex = createBlock(pool, memoryTypeIndex, blockSize, false);
+            if (!tryAllocate(pool[blockIndex], blockIndex, requirements, allocation)) {
+                throw std::runtime_error("failed to sub-allocate device memory!");
+            }
+            return allocation;
+        }
+        void free(VulkanAllocation& allocation) {
+            if (allocation.blockIndex == UINT32_MAX) {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            std::vector<MemoryBlock>& pool = pools[allocation.poolIndex];
+            MemoryBlock& block = pool[allocation.blockIndex];
+            if (!block.dedicated) {
+                block.metadata.free(allocation.regionIndex);
+            }
+            block.allocationCount--;
+
+            if (block.allocationCount == 0 && (block.dedicated || hasOtherEmptyBlock(pool, allocation.blockIndex))) {
+                releaseBlock(block);
+            }
+
+            allocation = VulkanAllocation{};
+        }
+        VulkanAllocatorStats getStats() {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            VulkanAllocatorStats stats{};
+            VkDeviceSize freeBytes = 0;
+            VkDeviceSize scatteredBytes = 0;
+            for (auto& pool : pools) {
+                for (auto& block : pool) {
+                    if (!block.inUse) {
+                        continue;
+                    }
+                    stats.blockCount++;
+                    stats.allocationCount += block.allocationCount;
+                    stats.blockBytes += block.size;
+                    if (block.dedicated) {
+                        stats.usedBytes += block.size;
+                        continue;
+                    }
+                    VkDeviceSize blockFree = block.metadata.getFreeSize();
+                    VkDeviceSize blockLargest = block.metadata.getLargestFreeRegion();
+                    stats.usedBytes += block.size - blockFree;
+                    freeBytes += blockFree;
+                    scatteredBytes += blockFree - blockLargest;
+                    stats.largestFreeRegion = std::max(stats.largestFreeRegion, blockLargest);
+                }
+            }
+            stats.fragmentation = freeBytes > 0 ? static_cast<float>(scatteredBytes) / static_cast<float>(freeBytes) : 0.0f;
+            return stats;
+        }
+        const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const {
+            return memProperties;
+        }
+
+    private:
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+        static constexpr VkDeviceSize SMALL_HEAP_SIZE = 1024ull * 1024 * 1024;
+
+        struct MemoryBlock {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            void* mapped = nullptr;
+            TlsfMetadata metadata;
+            uint32_t allocationCount = 0;
+            bool dedicated = false;
+            bool inUse = false;
+        };
+
+        void init(VkDeviceSize bufferImageGranularity) {
+            separateKinds = bufferImageGranularity > 1;
+            pools.clear();
+            pools.resize(memProperties.memoryTypeCount * 2);
+            preferredBlockSizes.resize(memProperties.memoryTypeCount);
+            for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+                VkDeviceSize heapSize = memProperties.memoryHeaps[memProperties.memoryTypes[i].heapIndex].size;
+                preferredBlockSizes[i] = heapSize <= SMALL_HEAP_SIZE ? heapSize / 8 : DEFAULT_BLOCK_SIZE;
+            }
+        }
+        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+            for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+                if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                    return i;
+                }
+            }
+
+            throw std::runtime_error("failed to find suitable memory type!");
+        }
+        bool tryAllocate(MemoryBlock& block, uint32_t blockIndex, const VkMemoryRequirements& requirements, VulkanAllocation& allocation) {
+            if (!block.inUse || block.dedicated) {
+                return false;
+            }
+            if (!block.metadata.allocate(requirements.size, requirements.alignment, allocation.offset, allocation.regionIndex)) {
+                return false;
+            }
+            block.allocationCount++;
+            allocation.blockIndex = blockIndex;
+            allocation.memory = block.memory;
+            allocation.mappedData = block.mapped ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+            return true;
+        }
+        uint32_t createBlock(std::vector<MemoryBlock>& pool, uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated) {
+            uint32_t blockIndex = 0;
+            while (blockIndex < pool.size() && pool[blockIndex].inUse) {
+                blockIndex++;
+            }
+            if (blockIndex == pool.size()) {
+                pool.emplace_back();
+            }
+
+            MemoryBlock& block = pool[blockIndex];
+            block.size = size;
+            block.dedicated = dedicated;
+            block.allocationCount = 0;
+            block.inUse = true;
+            block.memory = VK_NULL_HANDLE;
+            block.mapped = nullptr;
+            if (!dedicated) {
+                block.metadata.init(size);
+            }
+
+            if (simulated) {
+                return blockIndex;
+            }
+
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = size;
+            allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+            if (vkAllocateMemory(device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+                block.inUse = false;
+                throw std::runtime_error("failed to allocate device memory block!");
+            }
+
+            if (memProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+                vkMapMemory(device, block.memory, 0, size, 0, &block.mapped);
+            }
+
+            return blockIndex;
+        }
+        void releaseBlock(MemoryBlock& block) {
+            if (!block.inUse) {
+                return;
+            }
+            if (!simulated) {
+                if (block.mapped) {
+                    vkUnmapMemory(device, block.memory);
+                }
+                vkFreeMemory(device, block.memory, nullptr);
+            }
+            block = MemoryBlock{};
+        }
+        bool hasOtherEmptyBlock(const std::vector<MemoryBlock>& pool, uint32_t blockIndex) const {
+            for (uint32_t i = 0; i < pool.size(); i++) {
+                if (i != blockIndex && pool[i].inUse && !pool[i].dedicated && pool[i].allocationCount == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        VkDevice device = VK_NULL_HANDLE;
+        VkPhysicalDeviceMemoryProperties memProperties{};
+        bool simulated = false;
+        bool separateKinds = true;
+
+        std::vector<std::vector<MemoryBlock>> pools;
+        std::vector<VkDeviceSize> preferredBlockSizes;
+        std::mutex mutex;
+    };
+}
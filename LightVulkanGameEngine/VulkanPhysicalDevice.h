@@ -72,8 +72,8 @@ namespace LightVulkan {
 
             bool extensionsSupported = Utils::checkDeviceExtensionSupport(device, deviceExtensions);
 
-            bool swapChainAdequate = false;
-            if (extensionsSupported) {
+            bool swapChainAdequate = surface == VK_NULL_HANDLE;
+            if (extensionsSupported && surface != VK_NULL_HANDLE) {
                 SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device, surface);
                 swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
             }
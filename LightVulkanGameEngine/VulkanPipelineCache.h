@@ -0,0 +1,141 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace LightVulkan {
+    struct PipelineCacheStats {
+        bool warm = false;
+        size_t loadedBytes = 0;
+        uint32_t pipelineCount = 0;
+        double creationMs = 0.0;
+    };
+
+    // VkPipelineCache persisted between runs. Data from another driver or GPU is dropped rather than
+    // handed to the driver, some implementations do not validate it themselves.
+    class VulkanPipelineCache {
+    public:
+        void create(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& pathIn, bool loadFromDisk) {
+            path = pathIn;
+            stats = PipelineCacheStats{};
+
+            std::vector<char> initialData;
+            if (loadFromDisk) {
+                initialData = readFile(path);
+                if (!isCompatible(physicalDevice, initialData)) {
+                    initialData.clear();
+                }
+            }
+
+            VkPipelineCacheCreateInfo cacheInfo{};
+            cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+            cacheInfo.initialDataSize = initialData.size();
+            cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+            if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create pipeline cache!");
+            }
+
+            stats.warm = !initialData.empty();
+            stats.loadedBytes = initialData.size();
+        }
+        void destroy(VkDevice device) {
+            if (cache == VK_NULL_HANDLE) {
+                return;
+            }
+            save(device);
+            vkDestroyPipelineCache(device, cache, nullptr);
+            cache = VK_NULL_HANDLE;
+        }
+        // Best effort, a failed save only costs the next startup a cold cache
+        bool save(VkDevice device) {
+            size_t size = 0;
+            if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS || size == 0) {
+                return false;
+            }
+            std::vector<char> data(size);
+            if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS) {
+                return false;
+            }
+
+            std::string tempPath = path + ".tmp";
+            {
+                std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+                if (!file) {
+                    return false;
+                }
+                file.write(data.data(), size);
+                if (!file) {
+                    return false;
+                }
+            }
+
+            std::error_code ec;
+            std::filesystem::rename(tempPath, path, ec);
+            if (ec) {
+                std::filesystem::remove(tempPath, ec);
+                return false;
+            }
+            return true;
+        }
+        VkResult createGraphicsPipeline(VkDevice device, const VkGraphicsPipelineCreateInfo& pipelineInfo, VkPipeline& pipeline) {
+            auto start = std::chrono::high_resolution_clock::now();
+            VkResult result = vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline);
+            stats.creationMs += std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+            stats.pipelineCount++;
+            return result;
+        }
+        VkResult createComputePipeline(VkDevice device, const VkComputePipelineCreateInfo& pipelineInfo, VkPipeline& pipeline) {
+            auto start = std::chrono::high_resolution_clock::now();
+            VkResult result = vkCreateComputePipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline);
+            stats.creationMs += std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+            stats.pipelineCount++;
+            return result;
+        }
+        VkPipelineCache get() {
+            return cache;
+        }
+        const PipelineCacheStats& getStats() {
+            return stats;
+        }
+
+    private:
+        static std::vector<char> readFile(const std::string& filename) {
+            std::ifstream file(filename, std::ios::binary);
+            if (!file) {
+                return {};
+            }
+            return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        static bool isCompatible(VkPhysicalDevice physicalDevice, const std::vector<char>& data) {
+            VkPipelineCacheHeaderVersionOne header;
+            if (data.size() < sizeof(header)) {
+                return false;
+            }
+            memcpy(&header, data.data(), sizeof(header));
+
+            VkPhysicalDeviceProperties properties{};
+            vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+            return header.headerSize >= sizeof(header) &&
+                header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                header.vendorID == properties.vendorID &&
+                header.deviceID == properties.deviceID &&
+                memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        }
+
+    private:
+        std::string path;
+        VkPipelineCache cache = VK_NULL_HANDLE;
+        PipelineCacheStats stats;
+    };
+}
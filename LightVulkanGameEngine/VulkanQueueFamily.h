@@ -7,13 +7,14 @@ namespace LightVulkan {
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> transferFamily;
 
         bool isComplete() {
             return graphicsFamily.has_value() && presentFamily.has_value();
         }
     };
 
-    QueueFamilyIndices findQueueFamilies(const VkPhysicalDevice& device, const VkSurfaceKHR& surface) {
+    inline QueueFamilyIndices findQueueFamilies(const VkPhysicalDevice& device, const VkSurfaceKHR& surface) {
         QueueFamilyIndices indices;
 
         uint32_t queueFamilyCount = 0;
@@ -24,24 +25,41 @@ namespace LightVulkan {
 
         int i = 0;
         for (const auto& queueFamily : queueFamilies) {
-            if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            // The first graphics and present families win, the scan only goes on to look for a transfer family
+            if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphicsFamily.has_value()) {
                 indices.graphicsFamily = i;
             }
 
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            if (surface != VK_NULL_HANDLE) {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            }
+            else {
+                // Headless: nothing is presented, the graphics queue stands in for the present queue
+                presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+            }
 
-            if (presentSupport) {
+            if (presentSupport && !indices.presentFamily.has_value()) {
                 indices.presentFamily = i;
             }
 
-            if (indices.isComplete()) {
+            // Prefer a transfer-only family, it usually maps to a dedicated DMA engine
+            if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)
+                && !indices.transferFamily.has_value()) {
+                indices.transferFamily = i;
+            }
+
+            if (indices.isComplete() && indices.transferFamily.has_value()) {
                 break;
             }
 
             i++;
         }
 
+        if (!indices.transferFamily.has_value()) {
+            indices.transferFamily = indices.graphicsFamily;
+        }
+
         return indices;
     }
 }
@@ -0,0 +1,957 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "VulkanDevice.h"
+#include "VulkanImageView.h"
+#include "VulkanGpuProfiler.h"
+#include "VulkanMemoryAllocator.h"
+
+namespace LightVulkan {
+    typedef uint32_t RenderGraphResource;
+
+    enum class RenderGraphPassType {
+        Graphics,
+        Compute,
+        Transfer
+    };
+
+    // How a pass touches a resource. Shader usages run in the vertex and fragment stages of graphics passes and
+    // in the compute stage of compute passes.
+    enum class RenderGraphUsage {
+        ColorAttachment,
+        DepthAttachment,
+        ResolveAttachment,
+        Sampled,
+        StorageRead,
+        StorageWrite,
+        StorageReadWrite,
+        Uniform,
+        VertexBuffer,
+        IndexBuffer,
+        Indirect,
+        TransferSrc,
+        TransferDst
+    };
+
+    // What a transient image is created with, or what an imported image looks like to the passes using it
+    struct RenderGraphImageDesc {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent = { 0, 0 };
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+        VkImageUsageFlags usage = 0;
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    };
+
+    // Layout and last accesses of an imported resource when the frame starts, or what they must be when it ends
+    struct RenderGraphState {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags stages = 0;
+        VkAccessFlags access = 0;
+    };
+
+    struct RenderGraphContext {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        // Graphics passes only, the render pass is already begun
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+        VkExtent2D extent = { 0, 0 };
+    };
+
+    // One dependency compile planned in front of a pass, buffers have no layouts and keep VK_IMAGE_LAYOUT_UNDEFINED
+    struct RenderGraphBarrier {
+        RenderGraphResource resource;
+        VkPipelineStageFlags srcStages;
+        VkAccessFlags srcAccess;
+        VkPipelineStageFlags dstStages;
+        VkAccessFlags dstAccess;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+    };
+
+    struct RenderGraphStats {
+        uint32_t passCount = 0;
+        uint32_t culledPassCount = 0;
+        // vkCmdPipelineBarrier calls and image barriers recorded per frame
+        uint32_t barrierBatchCount = 0;
+        uint32_t imageBarrierCount = 0;
+        uint32_t transientImageCount = 0;
+        // Memory the transient images would need on their own, and what they occupy once aliased
+        VkDeviceSize transientBytes = 0;
+        VkDeviceSize allocatedBytes = 0;
+    };
+
+    // Passes declare what they read and write, in submission order. compile drops passes whose results nothing
+    // consumes, places transient images whose lifetimes do not overlap in the same memory, and plans the barriers
+    // between passes: one vkCmdPipelineBarrier per pass at most, none where the previous access already covers
+    // the next. execute replays that plan every frame around the pass callbacks.
+    //
+    // Imported resources are owned elsewhere and may be swapped every frame (the swap chain image, per frame
+    // buffers), they are also what keeps passes alive. Graphics passes get a VkRenderPass whose attachments stay
+    // in the layouts the graph put them in, so all transitions happen in the planned barriers.
+    class VulkanRenderGraph {
+    public:
+        typedef std::function<void(RenderGraphContext&)> PassCallback;
+
+        RenderGraphResource createImage(const std::string& name, const RenderGraphImageDesc& desc) {
+            Resource resource;
+            resource.name = name;
+            resource.isImage = true;
+            resource.desc = desc;
+            return addResource(resource);
+        }
+        RenderGraphResource importImage(const std::string& name, const RenderGraphImageDesc& desc, const RenderGraphState& initial, const RenderGraphState& final) {
+            Resource resource;
+            resource.name = name;
+            resource.isImage = true;
+            resource.imported = true;
+            resource.desc = desc;
+            resource.initial = initial;
+            resource.final = final;
+            return addResource(resource);
+        }
+        RenderGraphResource importBuffer(const std::string& name, const RenderGraphState& initial, const RenderGraphState& final) {
+            Resource resource;
+            resource.name = name;
+            resource.imported = true;
+            resource.initial = initial;
+            resource.final = final;
+            return addResource(resource);
+        }
+        // Imported handles can change every frame, they are only read by execute
+        void setImage(RenderGraphResource resource, VkImage image, VkImageView view) {
+            resources.at(resource).image = image;
+            resources[resource].view = view;
+        }
+        void setBuffer(RenderGraphResource resource, VkBuffer buffer) {
+            resources.at(resource).buffer = buffer;
+        }
+
+        uint32_t addPass(const std::string& name, RenderGraphPassType type, PassCallback execute) {
+            Pass pass;
+            pass.name = name;
+            pass.profileName = Profiler::get().intern(name);
+            pass.type = type;
+            pass.execute = std::move(execute);
+            passes.push_back(std::move(pass));
+            return static_cast<uint32_t>(passes.size() - 1);
+        }
+        void read(uint32_t pass, RenderGraphResource resource, RenderGraphUsage usage) {
+            passes.at(pass).accesses.push_back({ resource, usage, true, false });
+        }
+        void write(uint32_t pass, RenderGraphResource resource, RenderGraphUsage usage) {
+            passes.at(pass).accesses.push_back({ resource, usage, isReadingUsage(usage), true });
+        }
+        // Attachments are cleared when a clear value is given and loaded otherwise, loading reads the previous contents
+        void addColorAttachment(uint32_t pass, RenderGraphResource resource, const VkClearValue* clear = nullptr) {
+            passes.at(pass).colors.push_back(makeAttachment(resource, clear));
+            passes[pass].accesses.push_back({ resource, RenderGraphUsage::ColorAttachment, clear == nullptr, true });
+        }
+        void setDepthAttachment(uint32_t pass, RenderGraphResource resource, const VkClearValue* clear = nullptr) {
+            passes.at(pass).depth = makeAttachment(resource, clear);
+            passes[pass].hasDepth = true;
+            passes[pass].accesses.push_back({ resource, RenderGraphUsage::DepthAttachment, clear == nullptr, true });
+        }
+        // One per color attachment, in the same order
+        void addResolveAttachment(uint32_t pass, RenderGraphResource resource) {
+            passes.at(pass).resolves.push_back(makeAttachment(resource, nullptr));
+            passes[pass].accesses.push_back({ resource, RenderGraphUsage::ResolveAttachment, false, true });
+        }
+        // Kept even when nothing reads what it writes
+        void setSideEffects(uint32_t pass) {
+            passes.at(pass).sideEffects = true;
+        }
+        // The render pass is begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+        void setSecondaryContents(uint32_t pass) {
+            passes.at(pass).secondaryContents = true;
+        }
+        // Every pass, barriers included, gets a GPU timestamp scope and a CPU scope named after it
+        void setProfiler(VulkanGpuProfiler* profiler) {
+            gpuProfiler = profiler;
+        }
+
+        void compile(VulkanDevice& device) {
+            beginCompile();
+            std::vector<RenderGraphResource> transients = getTransients();
+            createTransientImages(device, transients);
+            planAliasing(transients);
+            bindTransientImages(device);
+            planBarriers();
+            createRenderPasses(device);
+            simulated = false;
+            compiled = true;
+        }
+        // Culling, aliasing and barrier planning without a device, transient images get the memory requirements
+        // requirementsFn returns for their description. Only the plan can be inspected, execute refuses to run it.
+        void compileSimulated(const std::function<VkMemoryRequirements(const RenderGraphImageDesc&)>& requirementsFn) {
+            beginCompile();
+            std::vector<RenderGraphResource> transients = getTransients();
+            for (RenderGraphResource r : transients) {
+                resources[r].requirements = requirementsFn(resources[r].desc);
+            }
+            planAliasing(transients);
+            planBarriers();
+            simulated = true;
+            compiled = true;
+        }
+        void execute(VulkanDevice& device, VkCommandBuffer commandBuffer) {
+            if (!compiled || simulated) {
+                throw std::runtime_error("render graph executed before compile!");
+            }
+            for (auto& pass : passes) {
+                if (!pass.alive) {
+                    continue;
+                }
+                ProfileScope cpuScope(pass.profileName);
+                uint32_t gpuScope = gpuProfiler ? gpuProfiler->beginScope(commandBuffer, pass.profileName) : UINT32_MAX;
+                recordBarriers(commandBuffer, pass.barriers);
+
+                RenderGraphContext context;
+                context.commandBuffer = commandBuffer;
+                if (pass.type != RenderGraphPassType::Graphics) {
+                    pass.execute(context);
+                    endProfileScope(commandBuffer, gpuScope);
+                    continue;
+                }
+
+                std::vector<VkClearValue> clearValues;
+                VkFramebuffer framebuffer = getFramebuffer(device, pass, context.extent, clearValues);
+                context.renderPass = pass.renderPass;
+                context.framebuffer = framebuffer;
+
+                VkRenderPassBeginInfo renderPassInfo{};
+                renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+                renderPassInfo.renderPass = pass.renderPass;
+                renderPassInfo.framebuffer = framebuffer;
+                renderPassInfo.renderArea.offset = { 0, 0 };
+                renderPassInfo.renderArea.extent = context.extent;
+                renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+                renderPassInfo.pClearValues = clearValues.data();
+
+                vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
+                    pass.secondaryContents ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+                pass.execute(context);
+                vkCmdEndRenderPass(commandBuffer);
+                endProfileScope(commandBuffer, gpuScope);
+            }
+            recordBarriers(commandBuffer, finalBarriers);
+        }
+        void destroy(VulkanDevice& device) {
+            if (simulated) {
+                aliasGroups.clear();
+                compiled = false;
+                return;
+            }
+            for (auto& pass : passes) {
+                for (auto& framebuffer : pass.framebuffers) {
+                    vkDestroyFramebuffer(device.getLogicalDevice(), framebuffer.second, nullptr);
+                }
+                pass.framebuffers.clear();
+                if (pass.renderPass != VK_NULL_HANDLE) {
+                    vkDestroyRenderPass(device.getLogicalDevice(), pass.renderPass, nullptr);
+                    pass.renderPass = VK_NULL_HANDLE;
+                }
+            }
+            for (auto& resource : resources) {
+                if (!resource.imported && resource.image != VK_NULL_HANDLE) {
+                    vkDestroyImageView(device.getLogicalDevice(), resource.view, nullptr);
+                    vkDestroyImage(device.getLogicalDevice(), resource.image, nullptr);
+                    resource.image = VK_NULL_HANDLE;
+                    resource.view = VK_NULL_HANDLE;
+                }
+            }
+            for (auto& group : aliasGroups) {
+                device.getAllocator().free(group.allocation);
+            }
+            aliasGroups.clear();
+            compiled = false;
+        }
+
+        VkImage getImage(RenderGraphResource resource) {
+            return resources.at(resource).image;
+        }
+        VkImageView getImageView(RenderGraphResource resource) {
+            return resources.at(resource).view;
+        }
+        VkBuffer getBuffer(RenderGraphResource resource) {
+            return resources.at(resource).buffer;
+        }
+        // Compatible with every pipeline built against a render pass with the same attachment formats and samples
+        VkRenderPass getRenderPass(uint32_t pass) {
+            return passes.at(pass).renderPass;
+        }
+        bool isPassCulled(uint32_t pass) {
+            return !passes.at(pass).alive;
+        }
+        const std::vector<RenderGraphBarrier>& getBarriers(uint32_t pass) {
+            return passes.at(pass).barriers;
+        }
+        // Recorded after the last pass to hand imported resources over in their final state
+        const std::vector<RenderGraphBarrier>& getFinalBarriers() {
+            return finalBarriers;
+        }
+        // Transient images in the same group share memory, NO_ALIAS_GROUP for imported and culled resources
+        uint32_t getAliasGroup(RenderGraphResource resource) {
+            return resources.at(resource).aliasGroup;
+        }
+        const RenderGraphStats& getStats() {
+            return stats;
+        }
+
+        static const uint32_t NO_ALIAS_GROUP = ~0u;
+
+    private:
+        static const uint32_t NO_PASS = ~0u;
+
+        struct Access {
+            RenderGraphResource resource;
+            RenderGraphUsage usage;
+            bool read;
+            bool write;
+        };
+
+        struct Attachment {
+            RenderGraphResource resource = 0;
+            bool clear = false;
+            VkClearValue clearValue{};
+        };
+
+        struct Pass {
+            std::string name;
+            const char* profileName = nullptr;
+            RenderGraphPassType type = RenderGraphPassType::Graphics;
+            PassCallback execute;
+            std::vector<Access> accesses;
+            std::vector<Attachment> colors;
+            Attachment depth;
+            bool hasDepth = false;
+            std::vector<Attachment> resolves;
+            bool sideEffects = false;
+            bool secondaryContents = false;
+
+            bool alive = false;
+            std::vector<RenderGraphBarrier> barriers;
+            VkRenderPass renderPass = VK_NULL_HANDLE;
+            std::map<std::vector<VkImageView>, VkFramebuffer> framebuffers;
+        };
+
+        struct Resource {
+            std::string name;
+            bool isImage = false;
+            bool imported = false;
+            RenderGraphImageDesc desc;
+            RenderGraphState initial;
+            RenderGraphState final;
+
+            VkImage image = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+            VkBuffer buffer = VK_NULL_HANDLE;
+
+            uint32_t firstPass = NO_PASS;
+            uint32_t lastPass = NO_PASS;
+            VkMemoryRequirements requirements{};
+            uint32_t aliasGroup = NO_ALIAS_GROUP;
+            // Whatever used this memory last before the frame reaches firstPass, possibly in the previous frame
+            RenderGraphState previousOccupant;
+        };
+
+        struct AliasGroup {
+            VkMemoryRequirements requirements{};
+            std::vector<RenderGraphResource> occupants;
+            VulkanAllocation allocation;
+        };
+
+        // One pass' combined use of one resource
+        struct MergedAccess {
+            RenderGraphResource resource;
+            VkPipelineStageFlags stages;
+            VkAccessFlags access;
+            VkImageLayout layout;
+            bool read;
+            bool write;
+        };
+
+        // What a resource has been through so far in the planned frame
+        struct TrackedState {
+            VkImageLayout layout;
+            VkPipelineStageFlags writeStages;
+            VkAccessFlags writeAccess;
+            VkPipelineStageFlags readStages;
+            // Stages and accesses the last write has been made visible to
+            VkPipelineStageFlags visibleStages;
+            VkAccessFlags visibleAccess;
+        };
+
+        static const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+        void endProfileScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+            if (gpuProfiler) {
+                gpuProfiler->endScope(commandBuffer, scope);
+            }
+        }
+        static bool isReadingUsage(RenderGraphUsage usage) {
+            return usage == RenderGraphUsage::StorageReadWrite;
+        }
+        static Attachment makeAttachment(RenderGraphResource resource, const VkClearValue* clear) {
+            Attachment attachment;
+            attachment.resource = resource;
+            attachment.clear = clear != nullptr;
+            if (clear != nullptr) {
+                attachment.clearValue = *clear;
+            }
+            return attachment;
+        }
+        static MergedAccess describe(const Access& access, RenderGraphPassType type) {
+            VkPipelineStageFlags shaderStages = type == RenderGraphPassType::Compute
+                ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                : VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+            MergedAccess merged{ access.resource, 0, 0, VK_IMAGE_LAYOUT_UNDEFINED, access.read, access.write };
+            switch (access.usage) {
+            case RenderGraphUsage::ColorAttachment:
+            case RenderGraphUsage::ResolveAttachment:
+                merged.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+                merged.access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | (access.read ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0);
+                merged.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+                break;
+            case RenderGraphUsage::DepthAttachment:
+                merged.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+                merged.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+                merged.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                break;
+            case RenderGraphUsage::Sampled:
+                merged.stages = shaderStages;
+                merged.access = VK_ACCESS_SHADER_READ_BIT;
+                merged.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                break;
+            case RenderGraphUsage::StorageRead:
+                merged.stages = shaderStages;
+                merged.access = VK_ACCESS_SHADER_READ_BIT;
+                merged.layout = VK_IMAGE_LAYOUT_GENERAL;
+                break;
+            case RenderGraphUsage::StorageWrite:
+                merged.stages = shaderStages;
+                merged.access = VK_ACCESS_SHADER_WRITE_BIT;
+                merged.layout = VK_IMAGE_LAYOUT_GENERAL;
+                break;
+            case RenderGraphUsage::StorageReadWrite:
+                merged.stages = shaderStages;
+                merged.access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+                merged.layout = VK_IMAGE_LAYOUT_GENERAL;
+                break;
+            case RenderGraphUsage::Uniform:
+                merged.stages = shaderStages;
+                merged.access = VK_ACCESS_UNIFORM_READ_BIT;
+                break;
+            case RenderGraphUsage::VertexBuffer:
+                merged.stages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+                merged.access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+                break;
+            case RenderGraphUsage::IndexBuffer:
+                merged.stages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+                merged.access = VK_ACCESS_INDEX_READ_BIT;
+                break;
+            case RenderGraphUsage::Indirect:
+                merged.stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+                merged.access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+                break;
+            case RenderGraphUsage::TransferSrc:
+                merged.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+                merged.access = VK_ACCESS_TRANSFER_READ_BIT;
+                merged.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                break;
+            case RenderGraphUsage::TransferDst:
+                merged.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+                merged.access = VK_ACCESS_TRANSFER_WRITE_BIT;
+                merged.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                break;
+            }
+            return merged;
+        }
+
+        RenderGraphResource addResource(const Resource& resource) {
+            if (compiled) {
+                throw std::runtime_error("render graph changed after compile!");
+            }
+            resources.push_back(resource);
+            return static_cast<RenderGraphResource>(resources.size() - 1);
+        }
+        // Every access of a pass to the same resource folded into one, they must agree on the image layout
+        std::vector<MergedAccess> mergeAccesses(const Pass& pass) {
+            std::vector<MergedAccess> merged;
+            for (const auto& access : pass.accesses) {
+                MergedAccess next = describe(access, pass.type);
+                auto existing = std::find_if(merged.begin(), merged.end(), [&next](const MergedAccess& m) { return m.resource == next.resource; });
+                if (existing == merged.end()) {
+                    merged.push_back(next);
+                    continue;
+                }
+                if (resources[next.resource].isImage && existing->layout != next.layout) {
+                    throw std::runtime_error("render graph pass " + pass.name + " uses " + resources[next.resource].name + " in two layouts!");
+                }
+                existing->stages |= next.stages;
+                existing->access |= next.access;
+                existing->read = existing->read || next.read;
+                existing->write = existing->write || next.write;
+            }
+            return merged;
+        }
+
+        // Walks the passes backwards from the imported resources. A pass survives when it has side effects or
+        // writes something a surviving later pass reads, or an imported resource no later pass overwrites.
+        void cullPasses() {
+            std::vector<bool> needed(resources.size(), false);
+            for (size_t i = 0; i < resources.size(); i++) {
+                needed[i] = resources[i].imported;
+            }
+
+            for (size_t p = passes.size(); p-- > 0;) {
+                Pass& pass = passes[p];
+                std::vector<MergedAccess> merged = mergeAccesses(pass);
+
+                pass.alive = pass.sideEffects;
+                for (const auto& access : merged) {
+                    pass.alive = pass.alive || (access.write && needed[access.resource]);
+                }
+                if (!pass.alive) {
+                    stats.culledPassCount++;
+                    continue;
+                }
+                for (const auto& access : merged) {
+                    if (access.write && !access.read) {
+                        needed[access.resource] = false;
+                    }
+                }
+                for (const auto& access : merged) {
+                    if (access.read) {
+                        needed[access.resource] = true;
+                    }
+                }
+            }
+        }
+        void computeLifetimes() {
+            for (uint32_t p = 0; p < passes.size(); p++) {
+                if (!passes[p].alive) {
+                    continue;
+                }
+                for (const auto& access : passes[p].accesses) {
+                    Resource& resource = resources[access.resource];
+                    if (resource.firstPass == NO_PASS) {
+                        resource.firstPass = p;
+                    }
+                    resource.lastPass = p;
+                }
+            }
+        }
+        void beginCompile() {
+            if (compiled) {
+                throw std::runtime_error("render graph already compiled!");
+            }
+            stats = RenderGraphStats{};
+            stats.passCount = static_cast<uint32_t>(passes.size());
+
+            cullPasses();
+            computeLifetimes();
+        }
+        // Transients no surviving pass touches are never created
+        std::vector<RenderGraphResource> getTransients() {
+            std::vector<RenderGraphResource> transients;
+            for (RenderGraphResource r = 0; r < resources.size(); r++) {
+                const Resource& resource = resources[r];
+                if (resource.imported || resource.firstPass == NO_PASS) {
+                    continue;
+                }
+                if (!resource.isImage) {
+                    throw std::runtime_error("render graph buffers must be imported!");
+                }
+                transients.push_back(r);
+            }
+            return transients;
+        }
+        void createTransientImages(VulkanDevice& device, const std::vector<RenderGraphResource>& transients) {
+            for (RenderGraphResource r : transients) {
+                Resource& resource = resources[r];
+
+                VkImageCreateInfo imageInfo{};
+                imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+                imageInfo.imageType = VK_IMAGE_TYPE_2D;
+                imageInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+                imageInfo.mipLevels = 1;
+                imageInfo.arrayLayers = 1;
+                imageInfo.format = resource.desc.format;
+                imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+                imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                imageInfo.usage = resource.desc.usage;
+                imageInfo.samples = resource.desc.samples;
+                imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+                if (vkCreateImage(device.getLogicalDevice(), &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create render graph image!");
+                }
+                vkGetImageMemoryRequirements(device.getLogicalDevice(), resource.image, &resource.requirements);
+            }
+        }
+        // Largest first, each image joins the first group whose occupants are all dead before it starts or
+        // born after it ends
+        void planAliasing(std::vector<RenderGraphResource> transients) {
+            for (RenderGraphResource r : transients) {
+                stats.transientImageCount++;
+                stats.transientBytes += resources[r].requirements.size;
+            }
+
+            std::stable_sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+                return resources[a].requirements.size > resources[b].requirements.size;
+            });
+
+            for (RenderGraphResource r : transients) {
+                Resource& resource = resources[r];
+                AliasGroup* target = nullptr;
+                for (auto& group : aliasGroups) {
+                    if ((group.requirements.memoryTypeBits & resource.requirements.memoryTypeBits) == 0) {
+                        continue;
+                    }
+                    bool overlaps = false;
+                    for (RenderGraphResource occupant : group.occupants) {
+                        overlaps = overlaps || (resources[occupant].firstPass <= resource.lastPass && resource.firstPass <= resources[occupant].lastPass);
+                    }
+                    if (!overlaps) {
+                        target = &group;
+                        break;
+                    }
+                }
+                if (target == nullptr) {
+                    aliasGroups.emplace_back();
+                    target = &aliasGroups.back();
+                    target->requirements = resource.requirements;
+                }
+                target->requirements.size = std::max(target->requirements.size, resource.requirements.size);
+                target->requirements.alignment = std::max(target->requirements.alignment, resource.requirements.alignment);
+                target->requirements.memoryTypeBits &= resource.requirements.memoryTypeBits;
+                target->occupants.push_back(r);
+                resource.aliasGroup = static_cast<uint32_t>(target - aliasGroups.data());
+            }
+
+            for (auto& group : aliasGroups) {
+                stats.allocatedBytes += group.requirements.size;
+
+                std::sort(group.occupants.begin(), group.occupants.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+                    return resources[a].firstPass < resources[b].firstPass;
+                });
+                for (size_t i = 0; i < group.occupants.size(); i++) {
+                    // The first occupant follows the last one of the previous frame
+                    RenderGraphResource previous = group.occupants[(i + group.occupants.size() - 1) % group.occupants.size()];
+                    resources[group.occupants[i]].previousOccupant = getLastUse(previous);
+                }
+            }
+        }
+        void bindTransientImages(VulkanDevice& device) {
+            for (auto& group : aliasGroups) {
+                group.allocation = device.getAllocator().allocate(group.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::Optimal);
+                for (RenderGraphResource r : group.occupants) {
+                    Resource& resource = resources[r];
+                    vkBindImageMemory(device.getLogicalDevice(), resource.image, group.allocation.memory, group.allocation.offset);
+
+                    VulkanImageView view;
+                    view.create(device.getLogicalDevice(), resource.image, resource.desc.format, resource.desc.aspect, 1);
+                    resource.view = view.get();
+                }
+            }
+        }
+        RenderGraphState getLastUse(RenderGraphResource resource) {
+            RenderGraphState state;
+            for (const auto& access : mergeAccesses(passes[resources[resource].lastPass])) {
+                if (access.resource == resource) {
+                    state.layout = access.layout;
+                    state.stages = access.stages;
+                    state.access = access.access & WRITE_ACCESS;
+                }
+            }
+            return state;
+        }
+
+        void planBarriers() {
+            std::vector<TrackedState> states(resources.size());
+            for (size_t r = 0; r < resources.size(); r++) {
+                const Resource& resource = resources[r];
+                // Transient contents never survive into the next frame or the next occupant, only the ordering does
+                const RenderGraphState& start = resource.imported ? resource.initial : resource.previousOccupant;
+                states[r] = { resource.imported ? start.layout : VK_IMAGE_LAYOUT_UNDEFINED, start.stages, start.access & WRITE_ACCESS, 0, 0, 0 };
+            }
+
+            for (auto& pass : passes) {
+                pass.barriers.clear();
+                if (!pass.alive) {
+                    continue;
+                }
+                for (const auto& access : mergeAccesses(pass)) {
+                    planAccess(states[access.resource], access, pass.barriers);
+                }
+                countBarriers(pass.barriers);
+            }
+
+            finalBarriers.clear();
+            for (RenderGraphResource r = 0; r < resources.size(); r++) {
+                const Resource& resource = resources[r];
+                if (!resource.imported || resource.firstPass == NO_PASS || (resource.final.stages == 0 && resource.final.layout == VK_IMAGE_LAYOUT_UNDEFINED)) {
+                    continue;
+                }
+                MergedAccess final{ r, resource.final.stages, resource.final.access,
+                    resource.final.layout == VK_IMAGE_LAYOUT_UNDEFINED ? states[r].layout : resource.final.layout, true, false };
+                planAccess(states[r], final, finalBarriers);
+            }
+            countBarriers(finalBarriers);
+        }
+        // Adds the barrier access needs after everything state has seen, if any
+        void planAccess(TrackedState& state, const MergedAccess& access, std::vector<RenderGraphBarrier>& barriers) {
+            bool isImage = resources[access.resource].isImage;
+            bool layoutChange = isImage && access.layout != state.layout;
+            bool visible = (access.stages & ~state.visibleStages) == 0 && (access.access & ~state.visibleAccess) == 0;
+
+            RenderGraphBarrier barrier{ access.resource, 0, 0, access.stages, access.access, state.layout, isImage ? access.layout : VK_IMAGE_LAYOUT_UNDEFINED };
+            if (access.write || layoutChange) {
+                // Reads since the last write already waited for it, the new write only has to wait for them
+                if (state.readStages != 0) {
+                    barrier.srcStages = state.readStages;
+                    if (access.read && !visible) {
+                        barrier.srcStages |= state.writeStages;
+                        barrier.srcAccess = state.writeAccess;
+                    }
+                }
+                else {
+                    barrier.srcStages = state.writeStages;
+                    barrier.srcAccess = state.writeAccess;
+                }
+                if (barrier.srcStages != 0 || layoutChange) {
+                    barriers.push_back(barrier);
+                }
+
+                state.layout = barrier.newLayout;
+                if (access.write) {
+                    state.writeStages = access.stages;
+                    state.writeAccess = access.access & WRITE_ACCESS;
+                    state.readStages = 0;
+                    state.visibleStages = 0;
+                    state.visibleAccess = 0;
+                }
+                else {
+                    // The layout transition is the new write, visible to the stages that waited for it
+                    state.writeStages = access.stages;
+                    state.writeAccess = 0;
+                    state.readStages = access.stages;
+                    state.visibleStages = access.stages;
+                    state.visibleAccess = access.access;
+                }
+                return;
+            }
+
+            if (!visible && state.writeStages != 0) {
+                barrier.srcStages = state.writeStages;
+                barrier.srcAccess = state.writeAccess;
+                barriers.push_back(barrier);
+            }
+            state.readStages |= access.stages;
+            state.visibleStages |= access.stages;
+            state.visibleAccess |= access.access;
+        }
+        void countBarriers(const std::vector<RenderGraphBarrier>& barriers) {
+            if (barriers.empty()) {
+                return;
+            }
+            stats.barrierBatchCount++;
+            for (const auto& barrier : barriers) {
+                stats.imageBarrierCount += resources[barrier.resource].isImage ? 1 : 0;
+            }
+        }
+        // Images get their own barriers, every buffer dependency of the batch is folded into one memory barrier
+        void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<RenderGraphBarrier>& barriers) {
+            if (barriers.empty()) {
+                return;
+            }
+
+            VkPipelineStageFlags srcStages = 0;
+            VkPipelineStageFlags dstStages = 0;
+            VkMemoryBarrier memoryBarrier{};
+            memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            std::vector<VkImageMemoryBarrier> imageBarriers;
+
+            for (const auto& barrier : barriers) {
+                srcStages |= barrier.srcStages;
+                dstStages |= barrier.dstStages;
+
+                Resource& resource = resources[barrier.resource];
+                if (!resource.isImage) {
+                    memoryBarrier.srcAccessMask |= barrier.srcAccess;
+                    memoryBarrier.dstAccessMask |= barrier.dstAccess;
+                    continue;
+                }
+                if (resource.image == VK_NULL_HANDLE) {
+                    throw std::runtime_error("render graph image " + resource.name + " was not set!");
+                }
+
+                VkImageMemoryBarrier imageBarrier{};
+                imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                imageBarrier.srcAccessMask = barrier.srcAccess;
+                imageBarrier.dstAccessMask = barrier.dstAccess;
+                imageBarrier.oldLayout = barrier.oldLayout;
+                imageBarrier.newLayout = barrier.newLayout;
+                imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.image = resource.image;
+                imageBarrier.subresourceRange.aspectMask = resource.desc.aspect;
+                imageBarrier.subresourceRange.baseMipLevel = 0;
+                imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+                imageBarrier.subresourceRange.baseArrayLayer = 0;
+                imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+                imageBarriers.push_back(imageBarrier);
+            }
+
+            bool hasMemoryBarrier = memoryBarrier.srcAccessMask != 0 || memoryBarrier.dstAccessMask != 0;
+            vkCmdPipelineBarrier(commandBuffer,
+                srcStages != 0 ? srcStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                dstStages != 0 ? dstStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT), 0,
+                hasMemoryBarrier ? 1 : 0, hasMemoryBarrier ? &memoryBarrier : nullptr,
+                0, nullptr,
+                static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+        }
+
+        // Attachments start and end in the layout the barriers leave them in. Contents are only stored when a later
+        // pass reads them or they leave the graph.
+        void createRenderPasses(VulkanDevice& device) {
+            for (uint32_t p = 0; p < passes.size(); p++) {
+                Pass& pass = passes[p];
+                if (!pass.alive || pass.type != RenderGraphPassType::Graphics) {
+                    continue;
+                }
+
+                std::vector<VkAttachmentDescription> attachments;
+                auto addAttachment = [&](const Attachment& attachment, VkImageLayout layout, bool resolve) {
+                    const Resource& resource = resources[attachment.resource];
+                    VkAttachmentDescription description{};
+                    description.format = resource.desc.format;
+                    description.samples = resource.desc.samples;
+                    description.loadOp = resolve ? VK_ATTACHMENT_LOAD_OP_DONT_CARE
+                        : (attachment.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD);
+                    description.storeOp = isReadAfter(attachment.resource, p) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                    description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                    description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                    description.initialLayout = layout;
+                    description.finalLayout = layout;
+                    attachments.push_back(description);
+                    return VkAttachmentReference{ static_cast<uint32_t>(attachments.size() - 1), layout };
+                };
+
+                std::vector<VkAttachmentReference> colorRefs;
+                for (const auto& color : pass.colors) {
+                    colorRefs.push_back(addAttachment(color, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, false));
+                }
+                VkAttachmentReference depthRef{};
+                if (pass.hasDepth) {
+                    depthRef = addAttachment(pass.depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, false);
+                }
+                std::vector<VkAttachmentReference> resolveRefs;
+                for (const auto& resolve : pass.resolves) {
+                    resolveRefs.push_back(addAttachment(resolve, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true));
+                }
+                if (!resolveRefs.empty() && resolveRefs.size() != colorRefs.size()) {
+                    throw std::runtime_error("render graph pass " + pass.name + " needs one resolve attachment per color attachment!");
+                }
+
+                VkSubpassDescription subpass{};
+                subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+                subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+                subpass.pColorAttachments = colorRefs.data();
+                subpass.pDepthStencilAttachment = pass.hasDepth ? &depthRef : nullptr;
+                subpass.pResolveAttachments = resolveRefs.empty() ? nullptr : resolveRefs.data();
+
+                VkRenderPassCreateInfo renderPassInfo{};
+                renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+                renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+                renderPassInfo.pAttachments = attachments.data();
+                renderPassInfo.subpassCount = 1;
+                renderPassInfo.pSubpasses = &subpass;
+
+                if (vkCreateRenderPass(device.getLogicalDevice(), &renderPassInfo, nullptr, &pass.renderPass) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create render graph render pass!");
+                }
+            }
+        }
+        bool isReadAfter(RenderGraphResource resource, uint32_t pass) {
+            if (resources[resource].imported) {
+                return true;
+            }
+            for (uint32_t p = pass + 1; p < passes.size(); p++) {
+                if (!passes[p].alive) {
+                    continue;
+                }
+                for (const auto& access : passes[p].accesses) {
+                    if (access.resource == resource && access.read) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+        // Imported attachments can change every frame, one framebuffer per combination of views
+        VkFramebuffer getFramebuffer(VulkanDevice& device, Pass& pass, VkExtent2D& extent, std::vector<VkClearValue>& clearValues) {
+            std::vector<VkImageView> views;
+            auto addView = [&](const Attachment& attachment) {
+                const Resource& resource = resources[attachment.resource];
+                if (resource.view == VK_NULL_HANDLE) {
+                    throw std::runtime_error("render graph image " + resource.name + " was not set!");
+                }
+                views.push_back(resource.view);
+                clearValues.push_back(attachment.clearValue);
+                extent = resource.desc.extent;
+            };
+            for (const auto& color : pass.colors) {
+                addView(color);
+            }
+            if (pass.hasDepth) {
+                addView(pass.depth);
+            }
+            for (const auto& resolve : pass.resolves) {
+                addView(resolve);
+            }
+
+            auto found = pass.framebuffers.find(views);
+            if (found != pass.framebuffers.end()) {
+                return found->second;
+            }
+
+            VkFramebufferCreateInfo framebufferInfo{};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = pass.renderPass;
+            framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+            framebufferInfo.pAttachments = views.data();
+            framebufferInfo.width = extent.width;
+            framebufferInfo.height = extent.height;
+            framebufferInfo.layers = 1;
+
+            VkFramebuffer framebuffer;
+            if (vkCreateFramebuffer(device.getLogicalDevice(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create render graph framebuffer!");
+            }
+            pass.framebuffers.emplace(views, framebuffer);
+            return framebuffer;
+        }
+
+    private:
+        std::vector<Pass> passes;
+        std::vector<Resource> resources;
+        std::vector<AliasGroup> aliasGroups;
+        std::vector<RenderGraphBarrier> finalBarriers;
+        bool compiled = false;
+        bool simulated = false;
+        RenderGraphStats stats;
+        VulkanGpuProfiler* gpuProfiler = nullptr;
+    };
+}
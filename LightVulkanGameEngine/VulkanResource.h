@@ -12,14 +12,14 @@ namespace LightVulkan {
             VkMemoryPropertyFlags memProperties, VkImageAspectFlags aspects, uint32_t mipLevels) {
             image.createImage(device,
                 width, height, 1, msaaSamples, format,
-                tiling, usages, memProperties, memory);
+                tiling, usages, memProperties, allocation);
 
             imageView.create(device.getLogicalDevice(), image.get(), format, aspects, mipLevels);
         }
-        void destroy(VkDevice device) {
-            imageView.destroy(device);
-            image.destroy(device);
-            vkFreeMemory(device, memory, nullptr);
+        void destroy(VulkanDevice& device) {
+            imageView.destroy(device.getLogicalDevice());
+            image.destroy(device.getLogicalDevice());
+            device.getAllocator().free(allocation);
         }
         VulkanImage getImage() {
             return image;
@@ -27,14 +27,14 @@ namespace LightVulkan {
         VulkanImageView getImageView() {
             return imageView;
         }
-        VkDeviceMemory getMemory() {
-            return memory;
+        const VulkanAllocation& getAllocation() {
+            return allocation;
         }
 
     private:
         VulkanImage image;
         VulkanImageView imageView;
-        VkDeviceMemory memory;
+        VulkanAllocation allocation;
     };
 
     class VulkanDepthResource : public VulkanResource {
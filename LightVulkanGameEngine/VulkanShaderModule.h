@@ -11,15 +11,11 @@ namespace LightVulkan {
     public:
         VulkanShaderModule(VulkanDevice& device, const char* filepath) {
             auto code = readFile(filepath);
-
-            VkShaderModuleCreateInfo createInfo{};
-            createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-            createInfo.codeSize = code.size();
-            createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-            if (vkCreateShaderModule(device.getLogicalDevice(), &createInfo, nullptr, &module) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create shader module!");
-            }
+            create(device, reinterpret_cast<const uint32_t*>(code.data()), code.size());
+        }
+        // SPIR-V from ShaderManager
+        VulkanShaderModule(VulkanDevice& device, const std::vector<uint32_t>& code) {
+            create(device, code.data(), code.size() * sizeof(uint32_t));
         }
         void destroy(VulkanDevice& device) {
             vkDestroyShaderModule(device.getLogicalDevice(), module, nullptr);
@@ -28,6 +24,18 @@ namespace LightVulkan {
             return module;
         }
 
+private:
+    void create(VulkanDevice& device, const uint32_t* code, size_t codeSize) {
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = codeSize;
+        createInfo.pCode = code;
+
+        if (vkCreateShaderModule(device.getLogicalDevice(), &createInfo, nullptr, &module) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shader module!");
+        }
+    }
+
 private:
     VkShaderModule module;
 };
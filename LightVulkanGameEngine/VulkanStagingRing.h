@@ -0,0 +1,121 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+
+namespace LightVulkan {
+    // Persistently mapped host visible buffer handed out front to back. Space is given back in
+    // submission order once the GPU work that read it has completed. A simulated ring has no
+    // buffer behind it and only does the bookkeeping.
+    class VulkanStagingRing {
+    public:
+        void create(VulkanDevice& device, VkDeviceSize capacityIn) {
+            capacity = capacityIn;
+            buffer.create(device, capacity,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+            mapped = static_cast<char*>(buffer.getMappedData());
+            if (mapped == nullptr) {
+                throw std::runtime_error("failed to map staging ring!");
+            }
+            head = tail = used = 0;
+            simulated = false;
+        }
+        void createSimulated(VkDeviceSize capacityIn) {
+            capacity = capacityIn;
+            mapped = nullptr;
+            head = tail = used = 0;
+            simulated = true;
+        }
+        void destroy(VulkanDevice& device) {
+            if (!simulated) {
+                buffer.destroy(device);
+            }
+            mapped = nullptr;
+        }
+        // Reserves up to size bytes, shortened to a multiple of granularity when the whole request does not fit.
+        // Returns 0 when nothing can be reserved until older uploads are released.
+        VkDeviceSize allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize granularity, VkDeviceSize& offset, VkDeviceSize& consumed) {
+            if (used == 0) {
+                head = tail = 0;
+            }
+
+            bool wrapped = used > 0 && head <= tail;
+            VkDeviceSize aligned = alignUp(head, alignment);
+            VkDeviceSize end = wrapped ? tail : capacity;
+            VkDeviceSize granted = fit(size, aligned < end ? end - aligned : 0, granularity);
+
+            // Restart at the front when that gives more room than the tail end of the buffer
+            if (granted < size && !wrapped) {
+                VkDeviceSize frontGranted = fit(size, tail, granularity);
+                if (frontGranted > granted) {
+                    offset = 0;
+                    consumed = capacity - head + frontGranted;
+                    head = frontGranted;
+                    used += consumed;
+                    return frontGranted;
+                }
+            }
+            if (granted == 0) {
+                return 0;
+            }
+
+            offset = aligned;
+            consumed = aligned - head + granted;
+            head = aligned + granted;
+            used += consumed;
+            return granted;
+        }
+        // marker is the head at the time the released uploads were submitted. A release of 0 bytes leaves the
+        // tail alone, its marker can predate the restart at offset 0 allocate does once the ring is empty.
+        void release(VkDeviceSize marker, VkDeviceSize bytes) {
+            if (bytes == 0) {
+                return;
+            }
+            tail = marker;
+            used -= bytes;
+        }
+        VkDeviceSize getHead() {
+            return head;
+        }
+        VkDeviceSize getCapacity() {
+            return capacity;
+        }
+        VkDeviceSize getUsed() {
+            return used;
+        }
+        void* getMappedData(VkDeviceSize offset) {
+            return mapped + offset;
+        }
+        VkBuffer getBuffer() {
+            return buffer.getBuffer();
+        }
+
+    private:
+        static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+        static VkDeviceSize fit(VkDeviceSize size, VkDeviceSize space, VkDeviceSize granularity) {
+            if (size <= space) {
+                return size;
+            }
+            return space / granularity * granularity;
+        }
+
+    private:
+        VulkanBuffer buffer;
+        char* mapped = nullptr;
+        VkDeviceSize capacity = 0;
+        VkDeviceSize head = 0;
+        VkDeviceSize tail = 0;
+        VkDeviceSize used = 0;
+        bool simulated = false;
+    };
+}
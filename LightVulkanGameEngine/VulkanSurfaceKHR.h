@@ -17,13 +17,15 @@ namespace LightVulkan {
 			}
 		}
         void destroy(VkInstance& instance) {
-            vkDestroySurfaceKHR(instance, surface, nullptr);
+            if (surface != VK_NULL_HANDLE) {
+                vkDestroySurfaceKHR(instance, surface, nullptr);
+            }
         }
 		VkSurfaceKHR get() {
 			return surface;
 		}
 
 	private:
-		VkSurfaceKHR surface;
+		VkSurfaceKHR surface = VK_NULL_HANDLE;
 	};
 }
@@ -7,12 +7,14 @@
 
 #include "VulkanDevice.h"
 #include "VulkanImageView.h"
+#include "VulkanResource.h"
 
 namespace LightVulkan {
 
 	class VulkanSwapChain {
 	public:
-		void create(VulkanDevice& device, Window window) {
+		// The caller retires oldSwapChain once frames that used it have completed
+		void create(VulkanDevice& device, Window window, VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE) {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device.getPhysicalDevice(), device.getSurface());
 
 			VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -51,6 +53,7 @@ namespace LightVulkan {
 			createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 			createInfo.presentMode = presentMode;
 			createInfo.clipped = VK_TRUE;
+			createInfo.oldSwapchain = oldSwapChain;
 
 			if (vkCreateSwapchainKHR(device.getLogicalDevice(), &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
 				throw std::runtime_error("failed to create swap chain!");
@@ -63,8 +66,31 @@ namespace LightVulkan {
 			imageFormat = surfaceFormat.format;
 			extent = extentIn;
 		}
-        void destroy(VkDevice device) {
-            vkDestroySwapchainKHR(device, swapChain, nullptr);
+		void createOffscreen(VulkanDevice& device, uint32_t width, uint32_t height, uint32_t imageCount) {
+			offscreen = true;
+			imageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+			extent = { width, height };
+
+			offscreenImages.resize(imageCount);
+			images.resize(imageCount);
+			for (uint32_t i = 0; i < imageCount; i++) {
+				offscreenImages[i].create(device,
+					width, height,
+					VK_SAMPLE_COUNT_1_BIT, imageFormat, VK_IMAGE_TILING_OPTIMAL,
+					VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+					VK_IMAGE_ASPECT_COLOR_BIT, 1);
+				images[i] = offscreenImages[i].getImage().get();
+			}
+		}
+        void destroy(VulkanDevice& device) {
+            if (offscreen) {
+                for (auto& offscreenImage : offscreenImages) {
+                    offscreenImage.destroy(device);
+                }
+                return;
+            }
+            vkDestroySwapchainKHR(device.getLogicalDevice(), swapChain, nullptr);
         }
         void destroyFrameBuffers(VkDevice device) {
             for (auto framebuffer : framebuffers) {
@@ -72,6 +98,10 @@ namespace LightVulkan {
             }
         }
         void destroyImageViews(VkDevice device) {
+            // Offscreen views are owned by their VulkanResource and released in destroy()
+            if (offscreen) {
+                return;
+            }
             for (auto imageView : imageViews) {
                 imageView.destroy(device);
             }
@@ -94,8 +124,20 @@ namespace LightVulkan {
 		std::vector<VkFramebuffer>& getFramebuffers() {
 			return framebuffers;
 		}
+		bool isOffscreen() const {
+			return offscreen;
+		}
+		VkImageLayout getFinalLayout() const {
+			return offscreen ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		}
 		void createImageViews(VkDevice device) {
 			imageViews.resize(images.size());
+			if (offscreen) {
+				for (uint32_t i = 0; i < images.size(); i++) {
+					imageViews[i] = offscreenImages[i].getImageView();
+				}
+				return;
+			}
 			for (uint32_t i = 0; i < images.size(); i++) {
 				imageViews[i].create(device, images[i], imageFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 			}
@@ -147,5 +189,8 @@ namespace LightVulkan {
 		VkExtent2D extent;
 		std::vector<VulkanImageView> imageViews;
 		std::vector<VkFramebuffer> framebuffers;
+
+		bool offscreen = false;
+		std::vector<VulkanResource> offscreenImages;
 	};
 }
@@ -40,8 +40,9 @@ namespace LightVulkan {
                 vkDestroyFence(device.getLogicalDevice(), inFlightFences[i], nullptr);
             }
         }
+        // Images of a new swap chain have never been submitted
         void resize(VulkanSwapChain& swapChain) {
-            imagesInFlight.resize(swapChain.getImages().size(), VK_NULL_HANDLE);
+            imagesInFlight.assign(swapChain.getImages().size(), VK_NULL_HANDLE);
         }
         std::vector<VkSemaphore>& getImageAvailableSemaphores() {
             return imageAvailableSemaphores;
@@ -5,213 +5,122 @@
 
 #include <cmath>
 #include <string>
+#include <vector>
 
 #include "VulkanBuffer.h"
 #include "VulkanImage.h"
 #include "VulkanImageView.h"
-#include "VulkanCommandBuffer.h"
+#include "VulkanUploadManager.h"
+#include "MappedFile.h"
+#include "Ktx2.h"
+#include "VulkanBindlessTable.h"
 
 namespace LightVulkan {
     class VulkanTexture {
     public:
-        void create(VulkanDevice& device, const std::string& path, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) {
+        // Loads the cooked .ktx2 next to path when there is an up to date one the device can sample, the source image otherwise
+        void create(VulkanDevice& device, VulkanUploadManager& uploadManager, const std::string& path, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t& mipLevels) {
+            if (createCooked(device, uploadManager, path, format, aspectFlags, mipLevels)) {
+                return;
+            }
+
             int texWidth, texHeight, texChannels;
             stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
             VkDeviceSize imageSize = texWidth * texHeight * 4;
-            mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
             if (!pixels) {
                 throw std::runtime_error("failed to load texture image!");
             }
 
-            VulkanBuffer stagingBuffer;
-            stagingBuffer.create(device, imageSize,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-            void* data;
-            vkMapMemory(device.getLogicalDevice(), stagingBuffer.getMemory(), 0, imageSize, 0, &data);
-            memcpy(data, pixels, static_cast<size_t>(imageSize));
-            vkUnmapMemory(device.getLogicalDevice(), stagingBuffer.getMemory());
-
-            stbi_image_free(pixels);
+            mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
             image.createImage(device,
                 texWidth, texHeight, mipLevels,
-                VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
+                VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_TILING_OPTIMAL,
                 VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                memory);
-
-            transitionImageLayout(device, image.get(), VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-            image.copyBufferToImage(device, stagingBuffer.getBuffer(), static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-            //copyBufferToImage(stagingBuffer.getBuffer(), image.get(), static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-            //transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps
+                allocation);
 
-            vkDestroyBuffer(device.getLogicalDevice(), stagingBuffer.getBuffer(), nullptr);
-            vkFreeMemory(device.getLogicalDevice(), stagingBuffer.getMemory(), nullptr);
+            // Pixels are copied into staging memory here, the GPU side runs once the batch is submitted
+            uploadManager.uploadImage(device, image.get(), format, pixels, imageSize,
+                static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), mipLevels);
 
-            generateMipmaps(device, image.get(), VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
+            stbi_image_free(pixels);
 
             imageView.create(device.getLogicalDevice(), image.get(), format, aspectFlags, mipLevels);
         }
+        // Also takes a slot in the bindless table, the handle stays valid until destroy
+        void create(VulkanDevice& device, VulkanUploadManager& uploadManager, const std::string& path, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t& mipLevels,
+            VulkanBindlessTable& bindlessTableIn) {
+            create(device, uploadManager, path, format, aspectFlags, mipLevels);
+            bindlessTable = &bindlessTableIn;
+            bindlessHandle = bindlessTable->addTexture(device, imageView.get());
+        }
         void destroy(VulkanDevice& device) {
+            if (bindlessTable != nullptr) {
+                bindlessTable->removeTexture(bindlessHandle);
+                bindlessTable = nullptr;
+            }
             vkDestroyImageView(device.getLogicalDevice(), imageView.get(), nullptr);
             vkDestroyImage(device.getLogicalDevice(), image.get(), nullptr);
-            vkFreeMemory(device.getLogicalDevice(), memory, nullptr);
+            device.getAllocator().free(allocation);
         }
-        void generateMipmaps(VulkanDevice& device, VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
-            // Check if image format supports linear blitting
-            VkFormatProperties formatProperties;
-            vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), imageFormat, &formatProperties);
-
-            if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
-                throw std::runtime_error("texture image format does not support linear blitting!");
+        VkImage getImage() {
+            return image.get();
+        }
+        VkImageView getImageView() {
+            return imageView.get();
+        }
+        const VulkanAllocation& getAllocation() {
+            return allocation;
+        }
+        BindlessTextureHandle getBindlessHandle() {
+            return bindlessHandle;
+        }
+    private:
+        bool createCooked(VulkanDevice& device, VulkanUploadManager& uploadManager, const std::string& path, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t& mipLevels) {
+            std::string cookedPath = Ktx2::getCookedPath(path);
+            if (!device.getFeatures().textureCompressionBC || !Ktx2::isFresh(cookedPath, path)) {
+                return false;
             }
 
-            //VkCommandBuffer commandBuffer = CmdBuffer::beginSingleTimeCommands(device.get(), commandPool);
-            VulkanCommandBuffer commandBuffer;
-            commandBuffer.createSingleTimeCommandBuffer(device);
-            commandBuffer.beginSingleTimeCommands();
-
-            VkImageMemoryBarrier barrier{};
-            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-            barrier.image = image;
-            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            barrier.subresourceRange.baseArrayLayer = 0;
-            barrier.subresourceRange.layerCount = 1;
-            barrier.subresourceRange.levelCount = 1;
-
-            int32_t mipWidth = texWidth;
-            int32_t mipHeight = texHeight;
-
-            for (uint32_t i = 1; i < mipLevels; i++) {
-                barrier.subresourceRange.baseMipLevel = i - 1;
-                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-                vkCmdPipelineBarrier(commandBuffer.get(),
-                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-                    0, nullptr,
-                    0, nullptr,
-                    1, &barrier);
-
-                VkImageBlit blit{};
-                blit.srcOffsets[0] = { 0, 0, 0 };
-                blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-                blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                blit.srcSubresource.mipLevel = i - 1;
-                blit.srcSubresource.baseArrayLayer = 0;
-                blit.srcSubresource.layerCount = 1;
-                blit.dstOffsets[0] = { 0, 0, 0 };
-                blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
-                blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                blit.dstSubresource.mipLevel = i;
-                blit.dstSubresource.baseArrayLayer = 0;
-                blit.dstSubresource.layerCount = 1;
-
-                vkCmdBlitImage(commandBuffer.get(),
-                    image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                    image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    1, &blit,
-                    VK_FILTER_LINEAR);
-
-                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-                barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-                barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-                vkCmdPipelineBarrier(commandBuffer.get(),
-                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-                    0, nullptr,
-                    0, nullptr,
-                    1, &barrier);
-
-                if (mipWidth > 1) mipWidth /= 2;
-                if (mipHeight > 1) mipHeight /= 2;
+            MappedFile file;
+            Ktx2View view;
+            if (!file.open(cookedPath) || !Ktx2::read(file, view) || Ktx2::isSrgb(view.format) != Ktx2::isSrgb(format)) {
+                return false;
             }
 
-            barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            vkCmdPipelineBarrier(commandBuffer.get(),
-                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-                0, nullptr,
-                0, nullptr,
-                1, &barrier);
-
-            //endSingleTimeCommands();
-            commandBuffer.endSingleTimeCommands();
-        }
-        void transitionImageLayout(VulkanDevice& device, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
-            VulkanCommandBuffer commandBuffer; 
-            commandBuffer.create(device, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
-            commandBuffer.beginSingleTimeCommands();
-
-            VkImageMemoryBarrier barrier{};
-            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-            barrier.oldLayout = oldLayout;
-            barrier.newLayout = newLayout;
-            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            barrier.image = image;
-            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            barrier.subresourceRange.baseMipLevel = 0;
-            barrier.subresourceRange.levelCount = mipLevels;
-            barrier.subresourceRange.baseArrayLayer = 0;
-            barrier.subresourceRange.layerCount = 1;
-
-            VkPipelineStageFlags sourceStage;
-            VkPipelineStageFlags destinationStage;
-
-            if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-                barrier.srcAccessMask = 0;
-                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-                sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-                destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            VkFormatProperties formatProperties;
+            vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), view.format, &formatProperties);
+            VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+            if ((formatProperties.optimalTilingFeatures & required) != required) {
+                return false;
             }
-            else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-                barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-                sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-                destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-            }
-            else {
-                throw std::invalid_argument("unsupported layout transition!");
+            std::vector<ImageLevel> levels;
+            for (const auto& level : view.levels) {
+                levels.push_back({ level.offset, level.size, level.width, level.height });
             }
+            mipLevels = static_cast<uint32_t>(levels.size());
 
-            vkCmdPipelineBarrier(
-                commandBuffer.get(),
-                sourceStage, destinationStage,
-                0,
-                0, nullptr,
-                0, nullptr,
-                1, &barrier
-            );
+            image.createImage(device,
+                view.width, view.height, mipLevels,
+                VK_SAMPLE_COUNT_1_BIT, view.format, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                allocation);
 
-            commandBuffer.endSingleTimeCommands();
-        }
-        VkImage getImage() {
-            return image.get();
-        }
-        VkImageView getImageView() {
-            return imageView.get();
-        }
-        VkDeviceMemory getMemory() {
-            return memory;
+            // Every level is already in the file, staged straight from the mapping with no decode and no blits
+            uploadManager.uploadImageLevels(device, image.get(), view.data, view.dataSize, levels, view.blockBytes);
+
+            imageView.create(device.getLogicalDevice(), image.get(), view.format, aspectFlags, mipLevels);
+            return true;
         }
-    private:
+
         VulkanImage image;
         VulkanImageView imageView;
-        VkDeviceMemory memory;
+        VulkanAllocation allocation;
+        VulkanBindlessTable* bindlessTable = nullptr;
+        BindlessTextureHandle bindlessHandle = 0;
     };
 }
@@ -0,0 +1,371 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VulkanDevice.h"
+#include "VulkanImage.h"
+#include "VulkanImageView.h"
+#include "VulkanTexture.h"
+#include "VulkanUploadManager.h"
+#include "VulkanDeletionQueue.h"
+#include "MappedFile.h"
+#include "JobSystem.h"
+#include "Ktx2.h"
+
+namespace LightVulkan {
+    typedef uint32_t StreamedTextureHandle;
+
+    struct TextureStreamerStats {
+        VkDeviceSize budgetBytes = 0;
+        VkDeviceSize residentBytes = 0;
+        VkDeviceSize peakResidentBytes = 0;
+        VkDeviceSize streamedBytes = 0;
+        uint32_t streamIns = 0;
+        uint32_t evictions = 0;
+    };
+
+    // Keeps cooked textures resident at the detail their on-screen size asks for, within a VRAM budget.
+    // Registration uploads only the mip tail so rendering can start at once, finer levels are read from the
+    // mapped KTX2 file later. Residency changes go into a new image holding just the resident levels, so dropping
+    // detail really frees memory, and the new view is only published once its upload has completed. Textures
+    // without a usable cooked file are loaded whole and count against the budget without ever being evicted.
+    class VulkanTextureStreamer {
+    public:
+        // Levels at or below this size are loaded up front and never evicted
+        static const uint32_t MIP_TAIL_SIZE = 64;
+        // Textures not requested for this many updates fall back to their mip tail
+        static const uint32_t EVICT_AFTER_UPDATES = 120;
+
+        // A budget of 0 takes a quarter of the largest device local heap
+        void create(VulkanDevice& device, VulkanUploadManager& uploadManagerIn, JobSystem& jobSystemIn, VkDeviceSize budget,
+            VkDeviceSize streamBytesPerUpdateIn = 16 * 1024 * 1024) {
+            uploadManager = &uploadManagerIn;
+            jobSystem = &jobSystemIn;
+            streamBytesPerUpdate = streamBytesPerUpdateIn;
+
+            if (budget == 0) {
+                VkPhysicalDeviceMemoryProperties memoryProperties;
+                vkGetPhysicalDeviceMemoryProperties(device.getPhysicalDevice(), &memoryProperties);
+                for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+                    if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                        budget = std::max(budget, memoryProperties.memoryHeaps[i].size / 4);
+                    }
+                }
+            }
+            stats.budgetBytes = budget;
+        }
+        // Only after the device has gone idle
+        void destroy(VulkanDevice& device) {
+            for (auto& texture : textures) {
+                jobSystem->wait(texture->prefetch);
+                if (texture->uploading) {
+                    uploadManager->wait(device, texture->ticket);
+                }
+                destroyResidency(device, texture->pending);
+                destroyResidency(device, texture->resident);
+                if (!texture->streamable) {
+                    texture->whole.destroy(device);
+                }
+            }
+            textures.clear();
+        }
+        StreamedTextureHandle add(VulkanDevice& device, const std::string& path, VkFormat format) {
+            auto texture = std::make_unique<Texture>();
+            texture->streamable = openCooked(device, *texture, path, format);
+
+            if (texture->streamable) {
+                const Ktx2View& view = texture->view;
+                uint32_t tail = 0;
+                while (tail + 1 < view.levels.size() && std::max(view.levels[tail].width, view.levels[tail].height) > MIP_TAIL_SIZE) {
+                    tail++;
+                }
+                texture->tailLevel = tail;
+                texture->targetLevel = tail;
+                texture->levelCount = static_cast<uint32_t>(view.levels.size());
+
+                // Init waits for its uploads before the first frame, so the tail goes live without a ticket check
+                beginResidency(device, *texture, tail);
+                texture->uploading = false;
+                texture->resident = texture->pending;
+                texture->pending = Residency();
+                texture->generation = 1;
+            }
+            else {
+                texture->whole.create(device, *uploadManager, path, format, VK_IMAGE_ASPECT_COLOR_BIT, texture->levelCount);
+                addResidentBytes(texture->whole.getAllocation().size);
+                texture->generation = 1;
+            }
+
+            textures.push_back(std::move(texture));
+            return static_cast<StreamedTextureHandle>(textures.size() - 1);
+        }
+        // Largest extent in pixels that anything sampling the texture covers on screen this update
+        void requestResolution(StreamedTextureHandle handle, float screenPixels) {
+            Texture& texture = *textures[handle];
+            texture.requestedPixels = std::max(texture.requestedPixels, screenPixels);
+            texture.lastRequest = updateIndex;
+        }
+        // Once per frame, after the fence of the frame about to be recorded. Images replaced by a newer residency
+        // are retired through deletionQueue under serial, the last frame submitted that could still sample them.
+        void update(VulkanDevice& device, VulkanDeletionQueue& deletionQueue, uint64_t serial) {
+            completeTransitions(device, deletionQueue, serial);
+            chooseTargets();
+            startTransitions(device);
+
+            for (auto& texture : textures) {
+                texture->requestedPixels = 0.0f;
+            }
+            updateIndex++;
+        }
+        VkImageView getImageView(StreamedTextureHandle handle) {
+            Texture& texture = *textures[handle];
+            return texture.streamable ? texture.resident.view.get() : texture.whole.getImageView();
+        }
+        // Changes whenever getImageView returns a new view, descriptors written with an older value are stale
+        uint64_t getGeneration(StreamedTextureHandle handle) {
+            return textures[handle]->generation;
+        }
+        // Length of the full chain, what samplers should allow as maxLod
+        uint32_t getLevelCount(StreamedTextureHandle handle) {
+            return textures[handle]->levelCount;
+        }
+        // Finest level currently resident
+        uint32_t getResidentLevel(StreamedTextureHandle handle) {
+            Texture& texture = *textures[handle];
+            return texture.streamable ? texture.resident.topLevel : 0;
+        }
+        const TextureStreamerStats& getStats() {
+            return stats;
+        }
+
+    private:
+        struct Residency {
+            VulkanImage image;
+            VulkanImageView view;
+            VulkanAllocation allocation;
+            uint32_t topLevel = 0;
+            bool valid = false;
+        };
+
+        struct Texture {
+            bool streamable = false;
+            VulkanTexture whole;
+
+            MappedFile file;
+            Ktx2View view;
+            uint32_t levelCount = 1;
+            uint32_t tailLevel = 0;
+
+            Residency resident;
+            Residency pending;
+            uint32_t targetLevel = 0;
+            JobCounter prefetch;
+            bool prefetching = false;
+            uint32_t prefetchLevel = 0;
+            bool uploading = false;
+            UploadTicket ticket = 0;
+
+            float requestedPixels = 0.0f;
+            float wantedPixels = 0.0f;
+            uint64_t lastRequest = 0;
+            uint64_t generation = 0;
+        };
+
+        bool openCooked(VulkanDevice& device, Texture& texture, const std::string& path, VkFormat format) {
+            std::string cookedPath = Ktx2::getCookedPath(path);
+            if (!device.getFeatures().textureCompressionBC || !Ktx2::isFresh(cookedPath, path)) {
+                return false;
+            }
+            if (!texture.file.open(cookedPath) || !Ktx2::read(texture.file, texture.view) || Ktx2::isSrgb(texture.view.format) != Ktx2::isSrgb(format)) {
+                return false;
+            }
+
+            VkFormatProperties formatProperties;
+            vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), texture.view.format, &formatProperties);
+            VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+            return (formatProperties.optimalTilingFeatures & required) == required;
+        }
+        // Bytes of levels topLevel and below, which is what a residency starting at topLevel holds
+        VkDeviceSize getChainBytes(const Texture& texture, uint32_t topLevel) {
+            const Ktx2View::Level& top = texture.view.levels[topLevel];
+            const Ktx2View::Level& last = texture.view.levels.back();
+            // Levels are stored smallest first, so the chain from topLevel down is one contiguous range
+            return top.offset + top.size - last.offset;
+        }
+        uint32_t getWantedLevel(const Texture& texture) {
+            if (updateIndex - texture.lastRequest > EVICT_AFTER_UPDATES || texture.wantedPixels <= 0.0f) {
+                return texture.tailLevel;
+            }
+            float size = static_cast<float>(std::max(texture.view.width, texture.view.height));
+            float level = std::floor(std::log2(std::max(1.0f, size / texture.wantedPixels)));
+            return std::min(texture.tailLevel, static_cast<uint32_t>(level));
+        }
+        void chooseTargets() {
+            for (auto& texture : textures) {
+                if (texture->lastRequest == updateIndex) {
+                    texture->wantedPixels = texture->requestedPixels;
+                }
+                if (texture->streamable) {
+                    texture->targetLevel = getWantedLevel(*texture);
+                }
+            }
+
+            // Over budget, take detail away from the least recently requested and then smallest on screen first
+            VkDeviceSize total = 0;
+            for (auto& texture : textures) {
+                total += texture->streamable ? getChainBytes(*texture, texture->targetLevel) : texture->whole.getAllocation().size;
+            }
+            while (total > stats.budgetBytes) {
+                Texture* victim = nullptr;
+                for (auto& texture : textures) {
+                    if (!texture->streamable || texture->targetLevel >= texture->tailLevel) {
+                        continue;
+                    }
+                    if (victim == nullptr || texture->lastRequest < victim->lastRequest ||
+                        (texture->lastRequest == victim->lastRequest && texture->wantedPixels < victim->wantedPixels)) {
+                        victim = texture.get();
+                    }
+                }
+                if (victim == nullptr) {
+                    break;
+                }
+                total -= getChainBytes(*victim, victim->targetLevel) - getChainBytes(*victim, victim->targetLevel + 1);
+                victim->targetLevel++;
+            }
+        }
+        void startTransitions(VulkanDevice& device) {
+            // Shrinking first, it frees memory the stream-ins below may need once the old images retire
+            for (auto& texture : textures) {
+                if (texture->streamable && !texture->pending.valid && !texture->prefetching && texture->targetLevel > texture->resident.topLevel) {
+                    stats.evictions++;
+                    beginResidency(device, *texture, texture->targetLevel);
+                }
+            }
+
+            VkDeviceSize streamed = 0;
+            for (auto& texture : textures) {
+                if (!texture->streamable || texture->pending.valid || texture->prefetching || texture->targetLevel >= texture->resident.topLevel) {
+                    continue;
+                }
+                // Both images are alive until the switch, the new one has to fit next to everything already resident
+                VkDeviceSize bytes = getChainBytes(*texture, texture->targetLevel);
+                if (stats.residentBytes + bytes > stats.budgetBytes || (streamed > 0 && streamed + bytes > streamBytesPerUpdate)) {
+                    continue;
+                }
+                streamed += bytes;
+
+                // The first touch of the finer levels faults them in from disk, done on a worker rather than in the upload.
+                // Without workers nothing would run the job, the upload takes the faults instead.
+                if (jobSystem->getThreadCount() <= 1) {
+                    stats.streamIns++;
+                    stats.streamedBytes += bytes;
+                    beginResidency(device, *texture, texture->targetLevel);
+                    continue;
+                }
+                const Ktx2View::Level& top = texture->view.levels[texture->targetLevel];
+                const Ktx2View::Level& resident = texture->view.levels[texture->resident.topLevel];
+                const uint8_t* begin = texture->view.data + resident.offset + resident.size;
+                size_t size = static_cast<size_t>(top.offset + top.size - (resident.offset + resident.size));
+                texture->prefetching = true;
+                texture->prefetchLevel = texture->targetLevel;
+                jobSystem->run([begin, size]() {
+                    volatile uint8_t sink = 0;
+                    for (size_t offset = 0; offset < size; offset += 4096) {
+                        sink = sink + begin[offset];
+                    }
+                }, &texture->prefetch);
+            }
+
+            for (auto& texture : textures) {
+                if (!texture->prefetching || texture->prefetch.get() != 0) {
+                    continue;
+                }
+                texture->prefetching = false;
+                // Dropped when the texture shrank on screen while its pages were being read
+                if (texture->targetLevel <= texture->prefetchLevel) {
+                    stats.streamIns++;
+                    stats.streamedBytes += getChainBytes(*texture, texture->prefetchLevel);
+                    beginResidency(device, *texture, texture->prefetchLevel);
+                }
+            }
+        }
+        // Allocates the image for levels topLevel and below and records their upload, the view goes live in completeTransitions
+        void beginResidency(VulkanDevice& device, Texture& texture, uint32_t topLevel) {
+            const Ktx2View& view = texture.view;
+            Residency& pending = texture.pending;
+            pending.topLevel = topLevel;
+
+            uint32_t levelCount = static_cast<uint32_t>(view.levels.size()) - topLevel;
+            pending.image.createImage(device,
+                view.levels[topLevel].width, view.levels[topLevel].height, levelCount,
+                VK_SAMPLE_COUNT_1_BIT, view.format, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                pending.allocation);
+            pending.valid = true;
+            addResidentBytes(pending.allocation.size);
+
+            // Offsets are rebased onto the start of the last level, the smallest, where the contiguous range begins
+            VkDeviceSize base = view.levels.back().offset;
+            std::vector<ImageLevel> levels;
+            for (uint32_t level = topLevel; level < view.levels.size(); level++) {
+                const Ktx2View::Level& source = view.levels[level];
+                levels.push_back({ source.offset - base, source.size, source.width, source.height });
+            }
+            uploadManager->uploadImageLevels(device, pending.image.get(), view.data + base, getChainBytes(texture, topLevel), levels, view.blockBytes);
+            texture.ticket = uploadManager->submit(device);
+            texture.uploading = true;
+
+            pending.view.create(device.getLogicalDevice(), pending.image.get(), view.format, VK_IMAGE_ASPECT_COLOR_BIT, levelCount);
+        }
+        // Swaps each completed residency in, the previous one lives on until the frames that sampled it are done
+        void completeTransitions(VulkanDevice& device, VulkanDeletionQueue& deletionQueue, uint64_t serial) {
+            for (auto& texture : textures) {
+                if (!texture->uploading || !uploadManager->isComplete(device, texture->ticket)) {
+                    continue;
+                }
+                texture->uploading = false;
+
+                Residency retired = texture->resident;
+                deletionQueue.push(serial, [this, &device, retired]() mutable {
+                    stats.residentBytes -= retired.allocation.size;
+                    destroyResidency(device, retired);
+                });
+
+                texture->resident = texture->pending;
+                texture->pending = Residency();
+                texture->generation++;
+            }
+        }
+        void destroyResidency(VulkanDevice& device, Residency& residency) {
+            if (!residency.valid) {
+                return;
+            }
+            residency.view.destroy(device.getLogicalDevice());
+            vkDestroyImage(device.getLogicalDevice(), residency.image.get(), nullptr);
+            device.getAllocator().free(residency.allocation);
+            residency.valid = false;
+        }
+        void addResidentBytes(VkDeviceSize bytes) {
+            stats.residentBytes += bytes;
+            stats.peakResidentBytes = std::max(stats.peakResidentBytes, stats.residentBytes);
+        }
+
+    private:
+        VulkanUploadManager* uploadManager = nullptr;
+        JobSystem* jobSystem = nullptr;
+        VkDeviceSize streamBytesPerUpdate = 0;
+
+        std::vector<std::unique_ptr<Texture>> textures;
+        uint64_t updateIndex = 0;
+        TextureStreamerStats stats;
+    };
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+
+namespace LightVulkan {
+    // One persistently mapped uniform buffer split into a region per frame in flight.
+    // Each frame hands out aligned slices that are bound with VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC.
+    class VulkanUniformRingBuffer {
+    public:
+        void create(VulkanDevice& device, VkDeviceSize frameSizeIn, uint32_t frameCountIn) {
+            VkPhysicalDeviceProperties properties{};
+            vkGetPhysicalDeviceProperties(device.getPhysicalDevice(), &properties);
+
+            alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+            frameSize = alignUp(frameSizeIn);
+            frameCount = frameCountIn;
+
+            buffer.create(device, frameSize * frameCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+            mapped = static_cast<char*>(buffer.getMappedData());
+            if (mapped == nullptr) {
+                throw std::runtime_error("failed to map uniform ring buffer!");
+            }
+            beginFrame(0);
+        }
+        void destroy(VulkanDevice& device) {
+            buffer.destroy(device);
+            mapped = nullptr;
+        }
+        // The caller must have waited on the fence of the frame that last used this region
+        void beginFrame(uint32_t frameIndex) {
+            frameBegin = frameSize * (frameIndex % frameCount);
+            head = frameBegin;
+        }
+        // Returns the dynamic offset to pass to vkCmdBindDescriptorSets
+        uint32_t allocate(VkDeviceSize size, void** data) {
+            VkDeviceSize offset = head;
+            VkDeviceSize end = offset + size;
+            if (end > frameBegin + frameSize) {
+                throw std::runtime_error("uniform ring buffer frame region exhausted!");
+            }
+            head = alignUp(end);
+
+            *data = mapped + offset;
+            return static_cast<uint32_t>(offset);
+        }
+        template<typename T>
+        uint32_t push(const T& value) {
+            void* data;
+            uint32_t offset = allocate(sizeof(T), &data);
+            memcpy(data, &value, sizeof(T));
+            return offset;
+        }
+        VkBuffer getBuffer() {
+            return buffer.getBuffer();
+        }
+        VkDeviceSize getAlignment() {
+            return alignment;
+        }
+        VkDeviceSize getFrameSize() {
+            return frameSize;
+        }
+        VkDeviceSize getFrameUsage() {
+            return head - frameBegin;
+        }
+
+    private:
+        VkDeviceSize alignUp(VkDeviceSize value) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+    private:
+        VulkanBuffer buffer;
+        char* mapped = nullptr;
+        VkDeviceSize alignment = 1;
+        VkDeviceSize frameSize = 0;
+        uint32_t frameCount = 1;
+        VkDeviceSize frameBegin = 0;
+        VkDeviceSize head = 0;
+    };
+}
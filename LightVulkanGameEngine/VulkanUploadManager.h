@@ -0,0 +1,555 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+#include "VulkanStagingRing.h"
+
+const VkDeviceSize STAGING_RING_SIZE = 32 * 1024 * 1024;
+const VkDeviceSize STAGING_MIN_CHUNK_SIZE = 64 * 1024;
+
+namespace LightVulkan {
+    typedef uint64_t UploadTicket;
+
+    // One mip level inside a contiguous block of image data
+    struct ImageLevel {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    // Batches staging copies into one command buffer on the transfer queue. Work that needs the
+    // graphics queue (ownership acquire, mip generation, final layouts) goes into a second command
+    // buffer that waits on the transfer submit. Each submit returns a ticket that can be polled.
+    // Source data is written straight into a shared staging ring, uploads larger than the free
+    // space are split into chunks and the batch is flushed early when the ring runs dry.
+    class VulkanUploadManager {
+    public:
+        void create(VulkanDevice& device) {
+            QueueFamilyIndices indices = device.getQueueFamilies();
+            transferFamily = indices.transferFamily.value();
+            graphicsFamily = indices.graphicsFamily.value();
+
+            transferPool = createPool(device, transferFamily);
+            graphicsPool = createPool(device, graphicsFamily);
+
+            VkPhysicalDeviceProperties properties{};
+            vkGetPhysicalDeviceProperties(device.getPhysicalDevice(), &properties);
+            copyAlignment = std::max<VkDeviceSize>(properties.limits.optimalBufferCopyOffsetAlignment, 16);
+
+            uint32_t familyCount = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(device.getPhysicalDevice(), &familyCount, nullptr);
+            std::vector<VkQueueFamilyProperties> families(familyCount);
+            vkGetPhysicalDeviceQueueFamilyProperties(device.getPhysicalDevice(), &familyCount, families.data());
+            imageGranularity = families[transferFamily].minImageTransferGranularity;
+
+            stagingRing.create(device, STAGING_RING_SIZE);
+        }
+        void destroy(VulkanDevice& device) {
+            if (recording) {
+                submit(device);
+            }
+            waitAll(device);
+            collect(device);
+
+            stagingRing.destroy(device);
+            vkDestroyCommandPool(device.getLogicalDevice(), graphicsPool, nullptr);
+            vkDestroyCommandPool(device.getLogicalDevice(), transferPool, nullptr);
+        }
+        void uploadBuffer(VulkanDevice& device, VulkanBuffer& dstBuffer, const void* data, VkDeviceSize size,
+            VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, VkDeviceSize dstOffset = 0) {
+            const char* src = static_cast<const char*>(data);
+            fillBuffer(device, dstBuffer, size, 1, [src](void* staging, VkDeviceSize offset, VkDeviceSize chunkSize) {
+                memcpy(staging, src + offset, static_cast<size_t>(chunkSize));
+            }, dstStage, dstAccess, dstOffset);
+        }
+        // Like uploadBuffer, but fill writes the data straight into staging memory, for data that is converted on
+        // the way (packed vertices, narrowed indices). Chunks are whole elements of elementSize bytes and fill gets
+        // their byte offset within the upload.
+        void fillBuffer(VulkanDevice& device, VulkanBuffer& dstBuffer, VkDeviceSize size, VkDeviceSize elementSize,
+            const std::function<void(void*, VkDeviceSize, VkDeviceSize)>& fill,
+            VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, VkDeviceSize dstOffset = 0) {
+            begin(device);
+
+            VkDeviceSize granularity = (STAGING_MIN_CHUNK_SIZE + elementSize - 1) / elementSize * elementSize;
+            VkDeviceSize copied = 0;
+            while (copied < size) {
+                VkDeviceSize stagingOffset;
+                VkDeviceSize chunkSize = reserveStaging(device, size - copied, granularity, stagingOffset);
+                fill(stagingRing.getMappedData(stagingOffset), copied, chunkSize);
+
+                VkBufferCopy copyRegion{};
+                copyRegion.srcOffset = stagingOffset;
+                copyRegion.dstOffset = dstOffset + copied;
+                copyRegion.size = chunkSize;
+                vkCmdCopyBuffer(current.transferCommandBuffer, stagingRing.getBuffer(), dstBuffer.getBuffer(), 1, &copyRegion);
+
+                copied += chunkSize;
+            }
+
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.buffer = dstBuffer.getBuffer();
+            barrier.offset = dstOffset;
+            barrier.size = size;
+
+            if (transferFamily != graphicsFamily) {
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = 0;
+                barrier.srcQueueFamilyIndex = transferFamily;
+                barrier.dstQueueFamilyIndex = graphicsFamily;
+                vkCmdPipelineBarrier(current.transferCommandBuffer,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                    0, nullptr,
+                    1, &barrier,
+                    0, nullptr);
+            }
+            else {
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            }
+
+            barrier.srcAccessMask = transferFamily != graphicsFamily ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = dstAccess;
+            vkCmdPipelineBarrier(current.graphicsCommandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0,
+                0, nullptr,
+                1, &barrier,
+                0, nullptr);
+        }
+        // Copies mip 0 and leaves every level in SHADER_READ_ONLY_OPTIMAL, blitting the chain when mipLevels > 1
+        void uploadImage(VulkanDevice& device, VkImage image, VkFormat format, const void* pixels, VkDeviceSize size,
+            uint32_t width, uint32_t height, uint32_t mipLevels) {
+            if (mipLevels > 1) {
+                VkFormatProperties formatProperties;
+                vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), format, &formatProperties);
+
+                if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+                    throw std::runtime_error("texture image format does not support linear blitting!");
+                }
+            }
+
+            begin(device);
+
+            VkImageMemoryBarrier barrier = beginImageUpload(image, mipLevels);
+
+            // Large images are copied in bands of whole rows
+            const char* src = static_cast<const char*>(pixels);
+            VkDeviceSize rowPitch = size / height;
+            uint32_t bandRows = getBandRows(height);
+            uint32_t row = 0;
+            while (row < height) {
+                VkDeviceSize stagingOffset;
+                VkDeviceSize chunkSize = reserveStaging(device, rowPitch * (height - row), rowPitch * bandRows, stagingOffset);
+                uint32_t rowCount = static_cast<uint32_t>(chunkSize / rowPitch);
+                memcpy(stagingRing.getMappedData(stagingOffset), src + rowPitch * row, static_cast<size_t>(chunkSize));
+
+                VkBufferImageCopy region{};
+                region.bufferOffset = stagingOffset;
+                region.bufferRowLength = 0;
+                region.bufferImageHeight = 0;
+                region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.imageSubresource.mipLevel = 0;
+                region.imageSubresource.baseArrayLayer = 0;
+                region.imageSubresource.layerCount = 1;
+                region.imageOffset = { 0, static_cast<int32_t>(row), 0 };
+                region.imageExtent = { width, rowCount, 1 };
+
+                vkCmdCopyBufferToImage(current.transferCommandBuffer, stagingRing.getBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+                row += rowCount;
+            }
+
+            // Hand the whole image to the graphics family, still in TRANSFER_DST_OPTIMAL
+            recordImageHandoff(barrier, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+
+            recordMipmaps(current.graphicsCommandBuffer, image, static_cast<int32_t>(width), static_cast<int32_t>(height), mipLevels);
+        }
+        // Uploads a complete, already built mip chain of a block compressed image. Level offsets are relative to
+        // data and aligned to the block size. When the whole chain fits the staging ring it goes through one
+        // memcpy and one copy command, otherwise each level is copied in bands of whole block rows.
+        void uploadImageLevels(VulkanDevice& device, VkImage image, const void* data, VkDeviceSize size,
+            const std::vector<ImageLevel>& levels, uint32_t blockBytes) {
+            begin(device);
+
+            uint32_t mipLevels = static_cast<uint32_t>(levels.size());
+            VkImageMemoryBarrier barrier = beginImageUpload(image, mipLevels);
+
+            const char* src = static_cast<const char*>(data);
+            if (size + copyAlignment <= stagingRing.getCapacity()) {
+                VkDeviceSize stagingOffset;
+                reserveStaging(device, size, size, stagingOffset);
+                memcpy(stagingRing.getMappedData(stagingOffset), src, static_cast<size_t>(size));
+
+                std::vector<VkBufferImageCopy> regions(mipLevels);
+                for (uint32_t level = 0; level < mipLevels; level++) {
+                    regions[level] = levelCopyRegion(level, stagingOffset + levels[level].offset, 0, levels[level].width, levels[level].height);
+                }
+                vkCmdCopyBufferToImage(current.transferCommandBuffer, stagingRing.getBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    mipLevels, regions.data());
+            }
+            else {
+                for (uint32_t level = 0; level < mipLevels; level++) {
+                    const ImageLevel& info = levels[level];
+                    VkDeviceSize rowPitch = static_cast<VkDeviceSize>((info.width + 3) / 4) * blockBytes;
+                    uint32_t blockRows = (info.height + 3) / 4;
+                    uint32_t bandRows = getBandRows(blockRows);
+                    uint32_t row = 0;
+                    while (row < blockRows) {
+                        VkDeviceSize stagingOffset;
+                        VkDeviceSize chunkSize = reserveStaging(device, rowPitch * (blockRows - row), rowPitch * bandRows, stagingOffset);
+                        uint32_t rowCount = static_cast<uint32_t>(chunkSize / rowPitch);
+                        memcpy(stagingRing.getMappedData(stagingOffset), src + info.offset + rowPitch * row, static_cast<size_t>(chunkSize));
+
+                        // The last band may end on a partial block, which the copy expresses by reaching the image edge
+                        uint32_t bandHeight = std::min(rowCount * 4, info.height - row * 4);
+                        VkBufferImageCopy region = levelCopyRegion(level, stagingOffset, row * 4, info.width, bandHeight);
+                        vkCmdCopyBufferToImage(current.transferCommandBuffer, stagingRing.getBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+                        row += rowCount;
+                    }
+                }
+            }
+
+            recordImageHandoff(barrier, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        }
+        UploadTicket submit(VulkanDevice& device) {
+            if (!recording) {
+                return lastSubmitted;
+            }
+            recording = false;
+
+            vkEndCommandBuffer(current.transferCommandBuffer);
+            vkEndCommandBuffer(current.graphicsCommandBuffer);
+
+            VkSubmitInfo transferSubmit{};
+            transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            transferSubmit.commandBufferCount = 1;
+            transferSubmit.pCommandBuffers = &current.transferCommandBuffer;
+            transferSubmit.signalSemaphoreCount = 1;
+            transferSubmit.pSignalSemaphores = &current.semaphore;
+
+            if (vkQueueSubmit(device.getTransferQueue(), 1, &transferSubmit, VK_NULL_HANDLE) != VK_SUCCESS) {
+                throw std::runtime_error("failed to submit transfer command buffer!");
+            }
+
+            VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            VkSubmitInfo graphicsSubmit{};
+            graphicsSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            graphicsSubmit.waitSemaphoreCount = 1;
+            graphicsSubmit.pWaitSemaphores = &current.semaphore;
+            graphicsSubmit.pWaitDstStageMask = &waitStage;
+            graphicsSubmit.commandBufferCount = 1;
+            graphicsSubmit.pCommandBuffers = &current.graphicsCommandBuffer;
+
+            if (vkQueueSubmit(device.getGraphicsQueue(), 1, &graphicsSubmit, current.fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to submit upload command buffer!");
+            }
+
+            current.ticket = ++lastSubmitted;
+            current.stagingEnd = stagingRing.getHead();
+            inFlight.push_back(std::move(current));
+            current = Batch{};
+            return lastSubmitted;
+        }
+        // Non-blocking, also releases the staging memory of every finished batch
+        bool isComplete(VulkanDevice& device, UploadTicket ticket) {
+            collect(device);
+            return ticket <= lastCompleted;
+        }
+        void wait(VulkanDevice& device, UploadTicket ticket) {
+            for (auto& batch : inFlight) {
+                if (batch.ticket <= ticket) {
+                    vkWaitForFences(device.getLogicalDevice(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+                }
+            }
+            collect(device);
+        }
+        void waitAll(VulkanDevice& device) {
+            wait(device, lastSubmitted);
+        }
+        void collect(VulkanDevice& device) {
+            while (!inFlight.empty() && vkGetFenceStatus(device.getLogicalDevice(), inFlight.front().fence) == VK_SUCCESS) {
+                Batch& batch = inFlight.front();
+                lastCompleted = batch.ticket;
+                release(device, batch);
+                inFlight.pop_front();
+            }
+        }
+
+    private:
+        struct Batch {
+            VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+            VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+            VkSemaphore semaphore = VK_NULL_HANDLE;
+            VkFence fence = VK_NULL_HANDLE;
+            VkDeviceSize stagingEnd = 0;
+            VkDeviceSize stagingBytes = 0;
+            UploadTicket ticket = 0;
+        };
+
+        VkCommandPool createPool(VulkanDevice& device, uint32_t queueFamily) {
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolInfo.queueFamilyIndex = queueFamily;
+
+            VkCommandPool pool;
+            if (vkCreateCommandPool(device.getLogicalDevice(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create upload command pool!");
+            }
+            return pool;
+        }
+        void begin(VulkanDevice& device) {
+            if (recording) {
+                return;
+            }
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+
+            allocInfo.commandPool = transferPool;
+            if (vkAllocateCommandBuffers(device.getLogicalDevice(), &allocInfo, &current.transferCommandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate upload command buffers!");
+            }
+            allocInfo.commandPool = graphicsPool;
+            if (vkAllocateCommandBuffers(device.getLogicalDevice(), &allocInfo, &current.graphicsCommandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate upload command buffers!");
+            }
+
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+            if (vkCreateSemaphore(device.getLogicalDevice(), &semaphoreInfo, nullptr, &current.semaphore) != VK_SUCCESS ||
+                vkCreateFence(device.getLogicalDevice(), &fenceInfo, nullptr, &current.fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create upload synchronization objects!");
+            }
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+            vkBeginCommandBuffer(current.transferCommandBuffer, &beginInfo);
+            vkBeginCommandBuffer(current.graphicsCommandBuffer, &beginInfo);
+            recording = true;
+
+            // A chunked upload can span batches, keep its copies ordered after the previous batch's transitions
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(current.transferCommandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                1, &barrier,
+                0, nullptr,
+                0, nullptr);
+        }
+        // Blocks on the oldest batch when the ring is full, flushing the one being recorded first if it holds staging data
+        VkDeviceSize reserveStaging(VulkanDevice& device, VkDeviceSize size, VkDeviceSize granularity, VkDeviceSize& offset) {
+            while (true) {
+                VkDeviceSize consumed;
+                VkDeviceSize granted = stagingRing.allocate(size, copyAlignment, granularity, offset, consumed);
+                if (granted > 0) {
+                    current.stagingBytes += consumed;
+                    return granted;
+                }
+
+                if (current.stagingBytes > 0) {
+                    submit(device);
+                    begin(device);
+                }
+                else if (!inFlight.empty()) {
+                    vkWaitForFences(device.getLogicalDevice(), 1, &inFlight.front().fence, VK_TRUE, UINT64_MAX);
+                    collect(device);
+                }
+                else {
+                    throw std::runtime_error("staging ring is too small for upload!");
+                }
+            }
+        }
+        // Bands start at x = 0 and span the full width and depth, so only their rows have to follow the transfer
+        // family's minImageTransferGranularity, counted in texel blocks for compressed formats. A granularity of 0
+        // allows whole levels only.
+        uint32_t getBandRows(uint32_t levelRows) {
+            return imageGranularity.height == 0 ? levelRows : imageGranularity.height;
+        }
+        // Records the move of every level to TRANSFER_DST_OPTIMAL and returns the barrier for the handoff to reuse
+        VkImageMemoryBarrier beginImageUpload(VkImage image, uint32_t mipLevels) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.image = image;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = mipLevels;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+            vkCmdPipelineBarrier(current.transferCommandBuffer,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier);
+            return barrier;
+        }
+        // Releases the image from the transfer family and acquires it on the graphics family, both halves carrying
+        // the same transition out of TRANSFER_DST_OPTIMAL as the ownership transfer requires
+        void recordImageHandoff(VkImageMemoryBarrier& barrier, VkImageLayout newLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = newLayout;
+            if (transferFamily != graphicsFamily) {
+                barrier.srcQueueFamilyIndex = transferFamily;
+                barrier.dstQueueFamilyIndex = graphicsFamily;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = 0;
+                vkCmdPipelineBarrier(current.transferCommandBuffer,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                    0, nullptr,
+                    0, nullptr,
+                    1, &barrier);
+                barrier.srcAccessMask = 0;
+            }
+            else {
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            }
+            barrier.dstAccessMask = dstAccess;
+            vkCmdPipelineBarrier(current.graphicsCommandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier);
+        }
+        VkBufferImageCopy levelCopyRegion(uint32_t level, VkDeviceSize bufferOffset, uint32_t y, uint32_t width, uint32_t height) {
+            VkBufferImageCopy region{};
+            region.bufferOffset = bufferOffset;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = level;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = { 0, static_cast<int32_t>(y), 0 };
+            region.imageExtent = { width, height, 1 };
+            return region;
+        }
+        void release(VulkanDevice& device, Batch& batch) {
+            stagingRing.release(batch.stagingEnd, batch.stagingBytes);
+            vkFreeCommandBuffers(device.getLogicalDevice(), transferPool, 1, &batch.transferCommandBuffer);
+            vkFreeCommandBuffers(device.getLogicalDevice(), graphicsPool, 1, &batch.graphicsCommandBuffer);
+            vkDestroySemaphore(device.getLogicalDevice(), batch.semaphore, nullptr);
+            vkDestroyFence(device.getLogicalDevice(), batch.fence, nullptr);
+        }
+        // Expects every level in TRANSFER_DST_OPTIMAL, leaves them in SHADER_READ_ONLY_OPTIMAL
+        void recordMipmaps(VkCommandBuffer commandBuffer, VkImage image, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.image = image;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = 1;
+            barrier.subresourceRange.levelCount = 1;
+
+            int32_t mipWidth = texWidth;
+            int32_t mipHeight = texHeight;
+
+            for (uint32_t i = 1; i < mipLevels; i++) {
+                barrier.subresourceRange.baseMipLevel = i - 1;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+                vkCmdPipelineBarrier(commandBuffer,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                    0, nullptr,
+                    0, nullptr,
+                    1, &barrier);
+
+                VkImageBlit blit{};
+                blit.srcOffsets[0] = { 0, 0, 0 };
+                blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+                blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                blit.srcSubresource.mipLevel = i - 1;
+                blit.srcSubresource.baseArrayLayer = 0;
+                blit.srcSubresource.layerCount = 1;
+                blit.dstOffsets[0] = { 0, 0, 0 };
+                blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
+                blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                blit.dstSubresource.mipLevel = i;
+                blit.dstSubresource.baseArrayLayer = 0;
+                blit.dstSubresource.layerCount = 1;
+
+                vkCmdBlitImage(commandBuffer,
+                    image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    1, &blit,
+                    VK_FILTER_LINEAR);
+
+                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+                barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+                vkCmdPipelineBarrier(commandBuffer,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                    0, nullptr,
+                    0, nullptr,
+                    1, &barrier);
+
+                if (mipWidth > 1) mipWidth /= 2;
+                if (mipHeight > 1) mipHeight /= 2;
+            }
+
+            barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier);
+        }
+
+    private:
+        uint32_t transferFamily = 0;
+        uint32_t graphicsFamily = 0;
+        VkCommandPool transferPool = VK_NULL_HANDLE;
+        VkCommandPool graphicsPool = VK_NULL_HANDLE;
+
+        VulkanStagingRing stagingRing;
+        VkDeviceSize copyAlignment = 16;
+        VkExtent3D imageGranularity = { 1, 1, 1 };
+
+        Batch current;
+        bool recording = false;
+        std::deque<Batch> inFlight;
+        UploadTicket lastSubmitted = 0;
+        UploadTicket lastCompleted = 0;
+    };
+}
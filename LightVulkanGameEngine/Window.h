@@ -16,6 +16,7 @@ namespace LightVulkan {
             window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
             glfwSetWindowUserPointer(window, this);
             glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+            glfwSetKeyCallback(window, keyCallback);
         }
         void destroy() {
             glfwDestroyWindow(window);
@@ -29,14 +30,26 @@ namespace LightVulkan {
         bool isFrameBufferResized() const {
             return framebufferResized;
         }
+        // True once per F12 press
+        bool consumeStatsRequest() {
+            bool requested = statsRequested;
+            statsRequested = false;
+            return requested;
+        }
 
     private:
         static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
             framebufferResized = true;
         }
+        static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+            if (key == GLFW_KEY_F12 && action == GLFW_PRESS) {
+                static_cast<Window*>(glfwGetWindowUserPointer(window))->statsRequested = true;
+            }
+        }
 
     private:
         static bool framebufferResized;
         GLFWwindow* window;
+        bool statsRequested = false;
     };
 }
@@ -1,12 +1,152 @@
 #include "SimpleModelApplication.h"
 #include "HelloTriangleApplication.h"
+#include "Benchmarks.h"
+#include "TextureCooker.h"
 
-int main() {
+int main(int argc, char* argv[]) {
     SimpleModelApplication app;
     //HelloTriangleApplication app;
 
+    bool headless = false;
+    uint32_t headlessFrames = 1000;
+    std::string frameBenchPath;
+    float timeStep = -1.0f;
+    uint32_t allocatorOps = 0;
+    std::string meshBenchPath;
+    std::string cookTexturePath;
+    bool benchJobs = false;
+    uint32_t cullingObjects = 0;
+    // Numeric values go through std::stoul and std::stof, which throw on text that is not a number
+    int i = 1;
     try {
-        app.run();
+        for (; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--headless") {
+                headless = true;
+            }
+            else if (arg == "--cold-pipeline-cache") {
+                app.setLoadPipelineCache(false);
+            }
+            else if (arg == "--objects" && i + 1 < argc) {
+                app.setObjectCount(static_cast<uint32_t>(std::stoul(argv[++i])));
+            }
+            else if (arg == "--texture-budget" && i + 1 < argc) {
+                app.setTextureBudget(static_cast<VkDeviceSize>(std::stoull(argv[++i])) * 1024 * 1024);
+            }
+            else if (arg == "--gpu-culling") {
+                app.setGpuCulling(true);
+            }
+            else if (arg == "--no-bindless") {
+                app.setBindless(false);
+            }
+            else if (arg == "--float-vertices") {
+                app.setVertexLayout(VertexLayout::Float32);
+            }
+            else if (arg == "--watch-shaders") {
+                app.setShaderHotReload(true);
+            }
+            else if (arg == "--profile") {
+                std::string tracePath = "profile.json";
+                if (i + 1 < argc && argv[i + 1][0] != '-') {
+                    tracePath = argv[++i];
+                }
+                app.setProfiling(tracePath);
+            }
+            else if (arg == "--frame-stats" && i + 1 < argc) {
+                app.setFrameStatsPath(argv[++i]);
+            }
+            else if (arg == "--threads" && i + 1 < argc) {
+                app.setJobThreadCount(static_cast<uint32_t>(std::stoul(argv[++i])));
+            }
+            else if (arg == "--bench-jobs") {
+                benchJobs = true;
+            }
+            else if (arg == "--bench-culling") {
+                cullingObjects = 100000;
+                if (i + 1 < argc && argv[i + 1][0] != '-') {
+                    cullingObjects = static_cast<uint32_t>(std::stoul(argv[++i]));
+                }
+            }
+            else if (arg == "--frames" && i + 1 < argc) {
+                headlessFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--resolution" && i + 1 < argc) {
+                std::string resolution = argv[++i];
+                size_t separator = resolution.find('x');
+                if (separator != std::string::npos) {
+                    app.setResolution(static_cast<uint32_t>(std::stoul(resolution.substr(0, separator))),
+                        static_cast<uint32_t>(std::stoul(resolution.substr(separator + 1))));
+                }
+            }
+            else if (arg == "--time-step" && i + 1 < argc) {
+                timeStep = std::stof(argv[++i]);
+            }
+            else if (arg == "--bench-frames") {
+                frameBenchPath = "frame_bench.json";
+                if (i + 1 < argc && argv[i + 1][0] != '-') {
+                    frameBenchPath = argv[++i];
+                }
+            }
+            else if (arg == "--bench-allocator") {
+                allocatorOps = 1000000;
+                if (i + 1 < argc && argv[i + 1][0] != '-') {
+                    allocatorOps = static_cast<uint32_t>(std::stoul(argv[++i]));
+                }
+            }
+            else if (arg == "--cook-textures") {
+                cookTexturePath = TEXTURE_PATH;
+                if (i + 1 < argc && argv[i + 1][0] != '-') {
+                    cookTexturePath = argv[++i];
+                }
+            }
+            else if (arg == "--bench-mesh") {
+                meshBenchPath = MODEL_PATH;
+                if (i + 1 < argc && argv[i + 1][0] != '-') {
+                    meshBenchPath = argv[++i];
+                }
+            }
+        }
+    }
+    catch (const std::logic_error&) {
+        std::cerr << "invalid value " << argv[i] << " for " << argv[i - 1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Fixed scene replay: deterministic animation and a fixed frame count, headless or windowed
+    if (!frameBenchPath.empty()) {
+        app.setBenchmarkOutput(frameBenchPath);
+        app.setFrameLimit(headlessFrames);
+        if (timeStep < 0.0f) {
+            timeStep = 1.0f / 60.0f;
+        }
+    }
+    if (timeStep >= 0.0f) {
+        app.setFixedTimeStep(timeStep);
+    }
+
+    try {
+        if (allocatorOps > 0) {
+            LightVulkan::Benchmarks::runAllocatorBenchmark(allocatorOps);
+        }
+        else if (benchJobs) {
+            LightVulkan::Benchmarks::runJobSystemBenchmark();
+        }
+        else if (cullingObjects > 0) {
+            LightVulkan::Benchmarks::runCullingBenchmark(cullingObjects);
+        }
+        else if (!cookTexturePath.empty()) {
+            LightVulkan::TextureCooker::cookAndReport(cookTexturePath);
+        }
+        else if (!meshBenchPath.empty()) {
+            LightVulkan::Benchmarks::runMeshLoadBenchmark(meshBenchPath);
+            LightVulkan::Benchmarks::runMeshIngestBenchmark(meshBenchPath);
+        }
+        else if (headless) {
+            app.runHeadless(headlessFrames);
+        }
+        else {
+            app.run();
+        }
     }
     catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
@@ -0,0 +1,28 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Matches BindlessMaterial, albedoTexture is already a slot in textures
+struct Material {
+    vec4 baseColor;
+    uint albedoTexture;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Materials {
+    Material materials[];
+};
+
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 1) uniform sampler textureSampler;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragMaterial;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    Material material = materials[fragMaterial];
+    // Instances of one draw can use different materials
+    vec4 albedo = texture(sampler2D(textures[nonuniformEXT(material.albedoTexture)], textureSampler), fragTexCoord);
+    outColor = albedo * material.baseColor * vec4(fragColor, 1.0);
+}
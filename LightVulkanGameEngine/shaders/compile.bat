@@ -1,5 +0,0 @@
-C:/VulkanSDK/1.2.198.1/Bin/glslc.exe shader.vert -o vert.spv
-C:/VulkanSDK/1.2.198.1/Bin/glslc.exe shader.frag -o frag.spv
-C:/VulkanSDK/1.2.198.1/Bin/glslc.exe helloTriangleShader.vert -o helloTriangleVert.spv
-C:/VulkanSDK/1.2.198.1/Bin/glslc.exe helloTriangleShader.frag -o helloTriangleFrag.spv
-pause
@@ -0,0 +1,27 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+// Normalized to the mesh bounds, ubo.model includes the dequantize transform
+layout(location = 0) in vec4 inPosition;
+layout(location = 2) in vec2 inTexCoord;
+
+// Per instance, binding 1
+layout(location = 3) in mat4 instanceModel;
+layout(location = 7) in vec4 instanceColor;
+layout(location = 8) in uint instanceMaterial;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragMaterial;
+
+void main() {
+    gl_Position = ubo.proj * ubo.view * instanceModel * ubo.model * vec4(inPosition.xyz, 1.0);
+    fragColor = instanceColor.rgb;
+    fragTexCoord = inTexCoord;
+    fragMaterial = instanceMaterial;
+}
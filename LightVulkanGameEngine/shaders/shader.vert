@@ -10,12 +10,19 @@ layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
+// Per instance, binding 1
+layout(location = 3) in mat4 instanceModel;
+layout(location = 7) in vec4 instanceColor;
+layout(location = 8) in uint instanceMaterial;
+
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragMaterial;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-    fragColor = inColor;
+    gl_Position = ubo.proj * ubo.view * instanceModel * ubo.model * vec4(inPosition, 1.0);
+    fragColor = inColor * instanceColor.rgb;
     fragTexCoord = inTexCoord;
+    fragMaterial = instanceMaterial;
 }
 
@@ -0,0 +1,132 @@
+#include "TestFramework.h"
+
+#include "../FrustumCulling.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace LightVulkan;
+
+namespace {
+    struct Box {
+        glm::vec3 center;
+        glm::vec3 extent;
+    };
+
+    Frustum testFrustum() {
+        glm::mat4 view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 50.0f);
+        proj[1][1] *= -1;
+        return Frustum::fromViewProjection(proj * view);
+    }
+
+    // Scalar reference written independently of Frustum::intersects: the box corner furthest along each plane
+    // normal has to be on the inside. Returns the smallest signed distance of those corners so callers can skip
+    // boxes that touch a plane, where the SIMD paths may round the other way.
+    float referenceDistance(const Frustum& frustum, const Box& box) {
+        float smallest = 0.0f;
+        for (int p = 0; p < Frustum::PlaneCount; p++) {
+            const glm::vec4& plane = frustum.planes[p];
+            glm::vec3 corner(
+                plane.x >= 0.0f ? box.center.x + box.extent.x : box.center.x - box.extent.x,
+                plane.y >= 0.0f ? box.center.y + box.extent.y : box.center.y - box.extent.y,
+                plane.z >= 0.0f ? box.center.z + box.extent.z : box.center.z - box.extent.z);
+            float distance = glm::dot(glm::vec3(plane), corner) + plane.w;
+            smallest = p == 0 ? distance : std::min(smallest, distance);
+        }
+        return smallest;
+    }
+
+    std::vector<Box> randomBoxes(uint32_t count, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+        std::uniform_real_distribution<float> size(0.0f, 4.0f);
+        std::vector<Box> boxes(count);
+        for (auto& box : boxes) {
+            box.center = glm::vec3(position(rng), position(rng), position(rng));
+            box.extent = glm::vec3(size(rng), size(rng), size(rng));
+        }
+        return boxes;
+    }
+
+    typedef uint32_t (*CullFn)(const Frustum&, const CullingBounds&, uint32_t*);
+
+    // Output has to be ascending, and agree with the reference for every box not within epsilon of a plane
+    bool matchesReference(const Frustum& frustum, const std::vector<Box>& boxes, CullFn cull) {
+        CullingBounds bounds;
+        bounds.resize(static_cast<uint32_t>(boxes.size()));
+        for (uint32_t i = 0; i < boxes.size(); i++) {
+            bounds.set(i, boxes[i].center, boxes[i].extent);
+        }
+        std::vector<uint32_t> visible(bounds.getPaddedCount());
+        uint32_t visibleCount = cull(frustum, bounds, visible.data());
+
+        uint32_t next = 0;
+        for (uint32_t i = 0; i < boxes.size(); i++) {
+            bool reported = next < visibleCount && visible[next] == i;
+            next += reported ? 1 : 0;
+            float distance = referenceDistance(frustum, boxes[i]);
+            if (std::abs(distance) > 1e-4f && reported != (distance >= 0.0f)) {
+                return false;
+            }
+        }
+        return next == visibleCount;
+    }
+
+    uint32_t cullDefault(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visible) {
+        std::vector<uint32_t> result;
+        uint32_t count = FrustumCuller::cull(frustum, bounds, result);
+        std::copy(result.begin(), result.end(), visible);
+        return count;
+    }
+}
+
+TEST_CASE(FrustumKeepsWhatTheCameraLooksAt) {
+    Frustum frustum = testFrustum();
+    CHECK(frustum.intersects(glm::vec3(0.0f), glm::vec3(0.5f)));
+    // Behind the camera, past the far plane and far off to the side
+    CHECK(!frustum.intersects(glm::vec3(4.0f, 4.0f, 4.0f), glm::vec3(0.5f)));
+    CHECK(!frustum.intersects(glm::vec3(-40.0f, -40.0f, -40.0f), glm::vec3(0.5f)));
+    CHECK(!frustum.intersects(glm::vec3(20.0f, -20.0f, 0.0f), glm::vec3(0.5f)));
+    // A box around the camera itself reaches into the frustum
+    CHECK(frustum.intersects(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(1.0f)));
+}
+
+// Counts around the lane widths exercise the masked tail of every path
+TEST_CASE(FrustumCullerMatchesScalarReference) {
+    Frustum frustum = testFrustum();
+    const uint32_t counts[] = { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 1003, 10000 };
+    uint32_t seed = 0;
+    for (uint32_t count : counts) {
+        std::vector<Box> boxes = randomBoxes(count, seed++);
+        CHECK(matchesReference(frustum, boxes, &FrustumCuller::cullScalar));
+        CHECK(matchesReference(frustum, boxes, &cullDefault));
+#if defined(__AVX__) || defined(LIGHTVULKAN_CULL_SSE)
+        CHECK(matchesReference(frustum, boxes, &FrustumCuller::cullSSE));
+#endif
+#if defined(__AVX__)
+        CHECK(matchesReference(frustum, boxes, &FrustumCuller::cullAVX));
+#endif
+    }
+}
+
+TEST_CASE(FrustumCullerKeepsOnlyTheVisibleTail) {
+    Frustum frustum = testFrustum();
+    // Nine boxes, only the last one in view, so the one visible lane sits in a partial block
+    std::vector<Box> boxes(9, Box{ glm::vec3(-40.0f, -40.0f, -40.0f), glm::vec3(0.5f) });
+    boxes[8].center = glm::vec3(0.0f);
+
+    CullingBounds bounds;
+    bounds.resize(9);
+    for (uint32_t i = 0; i < boxes.size(); i++) {
+        bounds.set(i, boxes[i].center, boxes[i].extent);
+    }
+    std::vector<uint32_t> visible;
+    CHECK(FrustumCuller::cull(frustum, bounds, visible) == 1);
+    CHECK(visible.size() == 1);
+    CHECK(!visible.empty() && visible[0] == 8);
+}
@@ -0,0 +1,163 @@
+#include "TestFramework.h"
+
+#include "../JobSystem.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace LightVulkan;
+
+TEST_CASE(JobSystemRunsEveryJobOnce) {
+    JobSystem jobSystem;
+    jobSystem.create(4);
+    CHECK(jobSystem.getThreadCount() == 4);
+
+    std::vector<std::atomic<uint32_t>> runs(10000);
+    JobCounter counter;
+    for (uint32_t i = 0; i < runs.size(); i++) {
+        jobSystem.run([&runs, i]() { runs[i].fetch_add(1); }, &counter);
+    }
+    jobSystem.wait(counter);
+    CHECK(counter.get() == 0);
+
+    uint32_t wrong = 0;
+    for (auto& count : runs) {
+        wrong += count.load() != 1 ? 1 : 0;
+    }
+    CHECK(wrong == 0);
+    jobSystem.destroy();
+}
+
+TEST_CASE(JobSystemParallelForCoversTheRangeOnce) {
+    JobSystem jobSystem;
+    jobSystem.create(4);
+
+    const uint32_t counts[] = { 0, 1, 63, 64, 65, 1000, 4097 };
+    for (uint32_t count : counts) {
+        std::vector<std::atomic<uint32_t>> hits(count);
+        std::atomic<uint32_t> oversized{ 0 };
+        jobSystem.parallelFor(count, 64, [&](uint32_t begin, uint32_t end) {
+            if (end - begin > 64 || end > count) {
+                oversized.fetch_add(1);
+            }
+            for (uint32_t i = begin; i < end; i++) {
+                hits[i].fetch_add(1);
+            }
+        });
+
+        uint32_t wrong = 0;
+        for (auto& hit : hits) {
+            wrong += hit.load() != 1 ? 1 : 0;
+        }
+        CHECK(wrong == 0);
+        CHECK(oversized.load() == 0);
+    }
+    jobSystem.destroy();
+}
+
+// Jobs queued behind a dependency only start once every job signalling it has finished
+TEST_CASE(JobSystemHoldsContinuationsUntilTheDependencyFinishes) {
+    JobSystem jobSystem;
+    jobSystem.create(4);
+
+    for (uint32_t round = 0; round < 50; round++) {
+        JobCounter first, second;
+        std::atomic<uint32_t> finished{ 0 };
+        std::atomic<uint32_t> early{ 0 };
+        for (uint32_t i = 0; i < 64; i++) {
+            jobSystem.run([&finished]() {
+                std::this_thread::yield();
+                finished.fetch_add(1);
+            }, &first);
+        }
+        for (uint32_t i = 0; i < 16; i++) {
+            jobSystem.run([&finished, &early]() {
+                if (finished.load() != 64) {
+                    early.fetch_add(1);
+                }
+            }, &second, &first);
+        }
+        jobSystem.wait(second);
+        CHECK(first.get() == 0);
+        CHECK(early.load() == 0);
+    }
+
+    // A dependency that already reached zero does not hold anything back
+    JobCounter done, after;
+    std::atomic<bool> ran{ false };
+    jobSystem.run([&ran]() { ran = true; }, &after, &done);
+    jobSystem.wait(after);
+    CHECK(ran.load());
+    jobSystem.destroy();
+}
+
+TEST_CASE(JobSystemRethrowsTheFirstFailureFromWait) {
+    JobSystem jobSystem;
+    jobSystem.create(4);
+
+    JobCounter counter;
+    std::atomic<uint32_t> completed{ 0 };
+    for (uint32_t i = 0; i < 100; i++) {
+        jobSystem.run([&completed, i]() {
+            if (i % 10 == 0) {
+                throw std::runtime_error("job failed");
+            }
+            completed.fetch_add(1);
+        }, &counter);
+    }
+
+    bool threw = false;
+    try {
+        jobSystem.wait(counter);
+    }
+    catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    // Failing jobs do not cancel the others, and the failure is handed out only once
+    CHECK(completed.load() == 90);
+    CHECK(counter.get() == 0);
+    jobSystem.wait(counter);
+    jobSystem.destroy();
+}
+
+TEST_CASE(JobSystemRunsMainThreadJobsOnTheMainThread) {
+    JobSystem jobSystem;
+    jobSystem.create(4);
+    CHECK(jobSystem.isMainThread());
+    CHECK(JobSystem::getThreadIndex() == 0);
+
+    JobCounter counter;
+    std::atomic<uint32_t> offMain{ 0 };
+    std::atomic<uint32_t> mainRuns{ 0 };
+    for (uint32_t i = 0; i < 32; i++) {
+        // Workers hand the main thread part of their work, which it only picks up while waiting
+        jobSystem.run([&]() {
+            jobSystem.runOnMainThread([&]() {
+                if (!jobSystem.isMainThread()) {
+                    offMain.fetch_add(1);
+                }
+                mainRuns.fetch_add(1);
+            }, &counter);
+        }, &counter);
+    }
+    jobSystem.wait(counter);
+    CHECK(mainRuns.load() == 32);
+    CHECK(offMain.load() == 0);
+    jobSystem.destroy();
+}
+
+TEST_CASE(JobSystemWorkerIndicesStayInRange) {
+    JobSystem jobSystem;
+    jobSystem.create(3);
+
+    std::atomic<uint32_t> outOfRange{ 0 };
+    jobSystem.parallelFor(3000, 1, [&](uint32_t, uint32_t) {
+        if (JobSystem::getThreadIndex() >= jobSystem.getThreadCount()) {
+            outOfRange.fetch_add(1);
+        }
+    });
+    CHECK(outOfRange.load() == 0);
+    jobSystem.destroy();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace LightVulkan {
+    namespace Tests {
+        typedef void (*TestFunction)();
+
+        struct TestCase {
+            const char* name;
+            TestFunction run;
+        };
+
+        inline std::vector<TestCase>& getTests() {
+            static std::vector<TestCase> tests;
+            return tests;
+        }
+        inline uint32_t& getFailureCount() {
+            static uint32_t failures = 0;
+            return failures;
+        }
+
+        struct TestRegistrar {
+            TestRegistrar(const char* name, TestFunction run) {
+                getTests().push_back({ name, run });
+            }
+        };
+
+        inline void reportFailure(const char* file, int line, const char* expression) {
+            std::cerr << file << "(" << line << "): CHECK(" << expression << ") failed" << std::endl;
+            getFailureCount()++;
+        }
+    }
+}
+
+// Test cases register themselves before main, TestMain.cpp runs every one of them
+#define TEST_CASE(name) \
+    static void name(); \
+    static LightVulkan::Tests::TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+// Records the failure and keeps going, so one run reports every broken expectation
+#define CHECK(expression) \
+    do { \
+        if (!(expression)) { \
+            LightVulkan::Tests::reportFailure(__FILE__, __LINE__, #expression); \
+        } \
+    } while (false)
@@ -0,0 +1,35 @@
+#include "TestFramework.h"
+
+#include <cstdlib>
+#include <exception>
+#include <string>
+
+// Runs every registered test, or only those whose name contains the first argument
+int main(int argc, char* argv[]) {
+    using namespace LightVulkan::Tests;
+
+    std::string filter = argc > 1 ? argv[1] : "";
+    uint32_t run = 0;
+    uint32_t failed = 0;
+    for (const auto& test : getTests()) {
+        if (!filter.empty() && std::string(test.name).find(filter) == std::string::npos) {
+            continue;
+        }
+
+        uint32_t failuresBefore = getFailureCount();
+        try {
+            test.run();
+        }
+        catch (const std::exception& e) {
+            std::cerr << test.name << " threw: " << e.what() << std::endl;
+            getFailureCount()++;
+        }
+        bool passed = getFailureCount() == failuresBefore;
+        std::cout << (passed ? "[ PASS ] " : "[ FAIL ] ") << test.name << std::endl;
+        run++;
+        failed += passed ? 0 : 1;
+    }
+
+    std::cout << run << " tests, " << failed << " failed" << std::endl;
+    return failed == 0 && run > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
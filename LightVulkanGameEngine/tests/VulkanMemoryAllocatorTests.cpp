@@ -0,0 +1,256 @@
+#include "TestFramework.h"
+
+#include "../VulkanMemoryAllocator.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace LightVulkan;
+
+namespace {
+    struct LiveRegion {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        uint32_t region;
+    };
+
+    bool overlapsAny(const std::vector<LiveRegion>& live, VkDeviceSize offset, VkDeviceSize size) {
+        for (const auto& other : live) {
+            if (offset < other.offset + other.size && other.offset < offset + size) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // One device local type and one host visible type, each on its own heap
+    VkPhysicalDeviceMemoryProperties testMemory(VkDeviceSize deviceHeapSize) {
+        VkPhysicalDeviceMemoryProperties props{};
+        props.memoryHeapCount = 2;
+        props.memoryHeaps[0].size = deviceHeapSize;
+        props.memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        props.memoryHeaps[1].size = 4ull * 1024 * 1024 * 1024;
+
+        props.memoryTypeCount = 2;
+        props.memoryTypes[0].heapIndex = 0;
+        props.memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        props.memoryTypes[1].heapIndex = 1;
+        props.memoryTypes[1].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        return props;
+    }
+
+    VkMemoryRequirements requirements(VkDeviceSize size, VkDeviceSize alignment, uint32_t memoryTypeBits = 0x3) {
+        VkMemoryRequirements result{};
+        result.size = size;
+        result.alignment = alignment;
+        result.memoryTypeBits = memoryTypeBits;
+        return result;
+    }
+}
+
+TEST_CASE(TlsfFillsBlockAndCoalescesOnFree) {
+    const VkDeviceSize blockSize = 64 * 1024;
+    TlsfMetadata metadata;
+    metadata.init(blockSize);
+    CHECK(metadata.isEmpty());
+    CHECK(metadata.getLargestFreeRegion() == blockSize);
+
+    std::vector<LiveRegion> live;
+    VkDeviceSize offset;
+    uint32_t region;
+    // No alignment, so the worst case padding cannot keep the last region from being used
+    while (metadata.allocate(1024, 1, offset, region)) {
+        CHECK(offset + 1024 <= blockSize);
+        CHECK(!overlapsAny(live, offset, metadata.getRegionSize(region)));
+        live.push_back({ offset, metadata.getRegionSize(region), region });
+    }
+    CHECK(live.size() == blockSize / 1024);
+    CHECK(metadata.getFreeSize() == 0);
+
+    // Every other region first, nothing can merge until the neighbours go too
+    for (size_t i = 0; i < live.size(); i += 2) {
+        metadata.free(live[i].region);
+    }
+    CHECK(metadata.getLargestFreeRegion() == 1024);
+    for (size_t i = 1; i < live.size(); i += 2) {
+        metadata.free(live[i].region);
+    }
+    CHECK(metadata.isEmpty());
+    CHECK(metadata.getLargestFreeRegion() == blockSize);
+}
+
+TEST_CASE(TlsfAlignmentPaddingStaysFree) {
+    TlsfMetadata metadata;
+    metadata.init(4096);
+
+    VkDeviceSize first, second;
+    uint32_t firstRegion, secondRegion;
+    CHECK(metadata.allocate(100, 1, first, firstRegion));
+    CHECK(metadata.allocate(512, 1024, second, secondRegion));
+    CHECK(first == 0);
+    CHECK(second % 1024 == 0);
+    CHECK(second >= 100);
+
+    // The padding in front of the aligned region is handed out again
+    VkDeviceSize small;
+    uint32_t smallRegion;
+    CHECK(metadata.allocate(64, 1, small, smallRegion));
+    CHECK(small + 64 <= second || small >= second + 512);
+
+    metadata.free(secondRegion);
+    metadata.free(firstRegion);
+    metadata.free(smallRegion);
+    CHECK(metadata.isEmpty());
+}
+
+TEST_CASE(TlsfRejectsRequestsLargerThanTheBlock) {
+    TlsfMetadata metadata;
+    metadata.init(1024);
+
+    VkDeviceSize offset;
+    uint32_t region;
+    CHECK(!metadata.allocate(2048, 1, offset, region));
+    // The worst case alignment padding counts against the block too
+    CHECK(!metadata.allocate(1024, 16, offset, region));
+    CHECK(metadata.allocate(1024, 1, offset, region));
+    CHECK(!metadata.allocate(1, 1, offset, region));
+}
+
+// Random churn against a plain list of live ranges: no overlaps, and the free size always adds up
+TEST_CASE(TlsfRandomChurnNeverOverlaps) {
+    const VkDeviceSize blockSize = 16 * 1024 * 1024;
+    TlsfMetadata metadata;
+    metadata.init(blockSize);
+
+    std::mt19937 rng(42);
+    std::vector<LiveRegion> live;
+    VkDeviceSize liveBytes = 0;
+    for (uint32_t i = 0; i < 20000; i++) {
+        if (live.empty() || rng() % 3 != 0) {
+            VkDeviceSize size = 16 + rng() % (64 * 1024);
+            VkDeviceSize alignment = 1ull << (rng() % 12);
+            VkDeviceSize offset;
+            uint32_t region;
+            if (!metadata.allocate(size, alignment, offset, region)) {
+                continue;
+            }
+            VkDeviceSize regionSize = metadata.getRegionSize(region);
+            CHECK(offset % alignment == 0);
+            CHECK(regionSize >= size);
+            CHECK(offset + regionSize <= blockSize);
+            CHECK(!overlapsAny(live, offset, regionSize));
+            live.push_back({ offset, regionSize, region });
+            liveBytes += regionSize;
+        }
+        else {
+            size_t index = rng() % live.size();
+            metadata.free(live[index].region);
+            liveBytes -= live[index].size;
+            live[index] = live.back();
+            live.pop_back();
+        }
+        CHECK(metadata.getFreeSize() == blockSize - liveBytes);
+    }
+
+    for (const auto& region : live) {
+        metadata.free(region.region);
+    }
+    CHECK(metadata.isEmpty());
+    CHECK(metadata.getLargestFreeRegion() == blockSize);
+}
+
+TEST_CASE(AllocatorSeparatesLinearAndOptimalBlocks) {
+    VulkanMemoryAllocator allocator;
+    allocator.createSimulated(testMemory(8ull * 1024 * 1024 * 1024), 1024);
+
+    VulkanAllocation linear = allocator.allocate(requirements(4096, 256), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::Linear);
+    VulkanAllocation optimal = allocator.allocate(requirements(4096, 256), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::Optimal);
+    CHECK(linear.poolIndex != optimal.poolIndex);
+    CHECK(allocator.getStats().blockCount == 2);
+
+    allocator.free(linear);
+    allocator.free(optimal);
+    allocator.destroy();
+
+    // Without a granularity constraint both kinds share one block
+    VulkanMemoryAllocator shared;
+    shared.createSimulated(testMemory(8ull * 1024 * 1024 * 1024), 1);
+    linear = shared.allocate(requirements(4096, 256), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::Linear);
+    optimal = shared.allocate(requirements(4096, 256), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::Optimal);
+    CHECK(linear.poolIndex == optimal.poolIndex);
+    CHECK(linear.blockIndex == optimal.blockIndex);
+    CHECK(linear.offset + 4096 <= optimal.offset || optimal.offset + 4096 <= linear.offset);
+    CHECK(shared.getStats().blockCount == 1);
+    shared.destroy();
+}
+
+TEST_CASE(AllocatorPicksMemoryTypeFromProperties) {
+    VulkanMemoryAllocator allocator;
+    allocator.createSimulated(testMemory(8ull * 1024 * 1024 * 1024), 1);
+
+    VulkanAllocation deviceLocal = allocator.allocate(requirements(256, 16), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::Linear);
+    VulkanAllocation hostVisible = allocator.allocate(requirements(256, 16), VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, AllocationKind::Linear);
+    CHECK(deviceLocal.poolIndex / 2 == 0);
+    CHECK(hostVisible.poolIndex / 2 == 1);
+
+    // The only host visible type is masked out
+    bool threw = false;
+    try {
+        allocator.allocate(requirements(256, 16, 0x1), VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, AllocationKind::Linear);
+    }
+    catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    allocator.free(deviceLocal);
+    allocator.free(hostVisible);
+    allocator.destroy();
+}
+
+TEST_CASE(AllocatorGivesLargeRequestsTheirOwnBlock) {
+    VulkanMemoryAllocator allocator;
+    allocator.createSimulated(testMemory(8ull * 1024 * 1024 * 1024), 1);
+
+    VulkanAllocation small = allocator.allocate(requirements(1024, 16), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::Linear);
+    VulkanAllocation large = allocator.allocate(requirements(48ull * 1024 * 1024, 16), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::Linear);
+    CHECK(large.offset == 0);
+    CHECK(large.blockIndex != small.blockIndex);
+
+    VulkanAllocatorStats stats = allocator.getStats();
+    CHECK(stats.blockCount == 2);
+    CHECK(stats.allocationCount == 2);
+
+    allocator.free(large);
+    CHECK(allocator.getStats().blockCount == 1);
+    allocator.free(small);
+    allocator.destroy();
+    CHECK(allocator.getStats().blockCount == 0);
+}
+
+// Small heaps use an eighth of the heap per block, so the fourth block opens after three are full
+TEST_CASE(AllocatorOpensBlocksAndKeepsOneEmptyBlock) {
+    const VkDeviceSize heapSize = 256ull * 1024 * 1024;
+    const VkDeviceSize blockSize = heapSize / 8;
+    VulkanMemoryAllocator allocator;
+    allocator.createSimulated(testMemory(heapSize), 1);
+
+    std::vector<VulkanAllocation> allocations;
+    for (uint32_t i = 0; i < 6; i++) {
+        allocations.push_back(allocator.allocate(requirements(blockSize / 2, 1), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::Linear));
+    }
+    CHECK(allocator.getStats().blockCount == 3);
+    CHECK(allocator.getStats().usedBytes == 3 * blockSize);
+
+    // Emptying two blocks keeps the first of them for reuse and releases the second
+    for (uint32_t i = 0; i < 4; i++) {
+        allocator.free(allocations[i]);
+    }
+    CHECK(allocator.getStats().blockCount == 2);
+    CHECK(allocator.getStats().allocationCount == 2);
+
+    allocator.free(allocations[4]);
+    allocator.free(allocations[5]);
+    allocator.destroy();
+}
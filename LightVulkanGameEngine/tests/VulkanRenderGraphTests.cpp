@@ -0,0 +1,293 @@
+#include "TestFramework.h"
+
+#include "../VulkanRenderGraph.h"
+
+#include <vector>
+
+using namespace LightVulkan;
+
+namespace {
+    const VkDeviceSize IMAGE_BYTES = 8 * 1024 * 1024;
+
+    // Every image the same size, so only lifetimes and memory types decide the aliasing
+    VkMemoryRequirements fixedRequirements(const RenderGraphImageDesc& desc) {
+        VkMemoryRequirements requirements{};
+        requirements.size = IMAGE_BYTES;
+        requirements.alignment = 64 * 1024;
+        // Depth images can only live in the second memory type
+        requirements.memoryTypeBits = desc.aspect == VK_IMAGE_ASPECT_DEPTH_BIT ? 0x2 : 0x3;
+        return requirements;
+    }
+
+    // Color images lose the second memory type, nothing is left that depth could share
+    VkMemoryRequirements disjointRequirements(const RenderGraphImageDesc& desc) {
+        VkMemoryRequirements requirements = fixedRequirements(desc);
+        requirements.memoryTypeBits = desc.aspect == VK_IMAGE_ASPECT_DEPTH_BIT ? 0x2 : 0x1;
+        return requirements;
+    }
+
+    RenderGraphImageDesc colorDesc() {
+        RenderGraphImageDesc desc;
+        desc.format = VK_FORMAT_R8G8B8A8_SRGB;
+        desc.extent = { 1280, 720 };
+        desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        return desc;
+    }
+
+    RenderGraphImageDesc depthDesc() {
+        RenderGraphImageDesc desc;
+        desc.format = VK_FORMAT_D32_SFLOAT;
+        desc.extent = { 1280, 720 };
+        desc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        desc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+        return desc;
+    }
+
+    RenderGraphResource importBackBuffer(VulkanRenderGraph& graph) {
+        RenderGraphState initial;
+        RenderGraphState final;
+        final.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        return graph.importImage("backbuffer", colorDesc(), initial, final);
+    }
+
+    const RenderGraphBarrier* findBarrier(const std::vector<RenderGraphBarrier>& barriers, RenderGraphResource resource) {
+        for (const auto& barrier : barriers) {
+            if (barrier.resource == resource) {
+                return &barrier;
+            }
+        }
+        return nullptr;
+    }
+
+    void noop(RenderGraphContext&) {
+    }
+}
+
+TEST_CASE(RenderGraphCullsPassesNothingConsumes) {
+    VulkanRenderGraph graph;
+    RenderGraphResource backBuffer = importBackBuffer(graph);
+    RenderGraphResource unused = graph.createImage("unused", colorDesc());
+    RenderGraphResource chained = graph.createImage("chained", colorDesc());
+    RenderGraphResource scratch = graph.createImage("scratch", colorDesc());
+
+    uint32_t dead = graph.addPass("dead", RenderGraphPassType::Graphics, noop);
+    graph.addColorAttachment(dead, unused);
+    // Feeds only a culled pass, so it goes too
+    uint32_t deadProducer = graph.addPass("dead producer", RenderGraphPassType::Graphics, noop);
+    graph.addColorAttachment(deadProducer, chained);
+    uint32_t deadConsumer = graph.addPass("dead consumer", RenderGraphPassType::Graphics, noop);
+    graph.read(deadConsumer, chained, RenderGraphUsage::Sampled);
+    graph.addColorAttachment(deadConsumer, scratch);
+    uint32_t sideEffects = graph.addPass("side effects", RenderGraphPassType::Compute, noop);
+    graph.write(sideEffects, scratch, RenderGraphUsage::StorageWrite);
+    graph.setSideEffects(sideEffects);
+    uint32_t present = graph.addPass("present", RenderGraphPassType::Graphics, noop);
+    graph.addColorAttachment(present, backBuffer);
+
+    graph.compileSimulated(fixedRequirements);
+    CHECK(graph.isPassCulled(dead));
+    CHECK(graph.isPassCulled(deadProducer));
+    CHECK(graph.isPassCulled(deadConsumer));
+    CHECK(!graph.isPassCulled(sideEffects));
+    CHECK(!graph.isPassCulled(present));
+    CHECK(graph.getStats().culledPassCount == 3);
+
+    // Only images a surviving pass touches are created
+    CHECK(graph.getStats().transientImageCount == 1);
+    CHECK(graph.getAliasGroup(unused) == VulkanRenderGraph::NO_ALIAS_GROUP);
+    CHECK(graph.getAliasGroup(chained) == VulkanRenderGraph::NO_ALIAS_GROUP);
+    CHECK(graph.getAliasGroup(backBuffer) == VulkanRenderGraph::NO_ALIAS_GROUP);
+}
+
+// A -> B -> C -> backbuffer: A and C never live at the same time and share memory, B overlaps both
+TEST_CASE(RenderGraphAliasesImagesWithDisjointLifetimes) {
+    VulkanRenderGraph graph;
+    RenderGraphResource backBuffer = importBackBuffer(graph);
+    RenderGraphResource a = graph.createImage("a", colorDesc());
+    RenderGraphResource b = graph.createImage("b", colorDesc());
+    RenderGraphResource c = graph.createImage("c", colorDesc());
+
+    uint32_t first = graph.addPass("first", RenderGraphPassType::Graphics, noop);
+    graph.addColorAttachment(first, a);
+    uint32_t second = graph.addPass("second", RenderGraphPassType::Graphics, noop);
+    graph.read(second, a, RenderGraphUsage::Sampled);
+    graph.addColorAttachment(second, b);
+    uint32_t third = graph.addPass("third", RenderGraphPassType::Graphics, noop);
+    graph.read(third, b, RenderGraphUsage::Sampled);
+    graph.addColorAttachment(third, c);
+    uint32_t present = graph.addPass("present", RenderGraphPassType::Graphics, noop);
+    graph.read(present, c, RenderGraphUsage::Sampled);
+    graph.addColorAttachment(present, backBuffer);
+
+    graph.compileSimulated(fixedRequirements);
+    CHECK(graph.getAliasGroup(a) == graph.getAliasGroup(c));
+    CHECK(graph.getAliasGroup(a) != graph.getAliasGroup(b));
+    CHECK(graph.getStats().transientImageCount == 3);
+    CHECK(graph.getStats().transientBytes == 3 * IMAGE_BYTES);
+    CHECK(graph.getStats().allocatedBytes == 2 * IMAGE_BYTES);
+
+    // c takes over a's memory, so its first write waits for a's last read rather than starting from nothing
+    const RenderGraphBarrier* handover = findBarrier(graph.getBarriers(third), c);
+    CHECK(handover != nullptr);
+    if (handover != nullptr) {
+        CHECK(handover->srcStages == (VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT));
+        CHECK(handover->oldLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+        CHECK(handover->newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    }
+}
+
+// A color image that is dead before a depth image is born can only share its memory when their types overlap
+TEST_CASE(RenderGraphKeepsIncompatibleMemoryTypesApart) {
+    typedef VkMemoryRequirements (*RequirementsFn)(const RenderGraphImageDesc&);
+    const RequirementsFn requirementsFns[] = { fixedRequirements, disjointRequirements };
+    for (RequirementsFn requirementsFn : requirementsFns) {
+        VulkanRenderGraph graph;
+        RenderGraphResource backBuffer = importBackBuffer(graph);
+        RenderGraphResource color = graph.createImage("color", colorDesc());
+        RenderGraphResource depth = graph.createImage("depth", depthDesc());
+
+        uint32_t first = graph.addPass("first", RenderGraphPassType::Graphics, noop);
+        graph.addColorAttachment(first, color);
+        uint32_t second = graph.addPass("second", RenderGraphPassType::Graphics, noop);
+        graph.read(second, color, RenderGraphUsage::Sampled);
+        graph.addColorAttachment(second, backBuffer);
+        uint32_t third = graph.addPass("third", RenderGraphPassType::Graphics, noop);
+        graph.setDepthAttachment(third, depth);
+        graph.addColorAttachment(third, backBuffer);
+
+        graph.compileSimulated(requirementsFn);
+        bool shared = requirementsFn == fixedRequirements;
+        CHECK((graph.getAliasGroup(color) == graph.getAliasGroup(depth)) == shared);
+        CHECK(graph.getStats().allocatedBytes == (shared ? 1 : 2) * IMAGE_BYTES);
+    }
+}
+
+TEST_CASE(RenderGraphPlansReadAfterWriteBarriers) {
+    VulkanRenderGraph graph;
+    RenderGraphResource backBuffer = importBackBuffer(graph);
+    RenderGraphResource shadow = graph.createImage("shadow", colorDesc());
+
+    VkClearValue clear{};
+    uint32_t render = graph.addPass("render", RenderGraphPassType::Graphics, noop);
+    graph.addColorAttachment(render, shadow, &clear);
+    uint32_t firstRead = graph.addPass("first read", RenderGraphPassType::Graphics, noop);
+    graph.read(firstRead, shadow, RenderGraphUsage::Sampled);
+    graph.addColorAttachment(firstRead, backBuffer, &clear);
+    uint32_t secondRead = graph.addPass("second read", RenderGraphPassType::Graphics, noop);
+    graph.read(secondRead, shadow, RenderGraphUsage::Sampled);
+    graph.addColorAttachment(secondRead, backBuffer);
+
+    graph.compileSimulated(fixedRequirements);
+
+    const RenderGraphBarrier* transition = findBarrier(graph.getBarriers(firstRead), shadow);
+    CHECK(transition != nullptr);
+    if (transition != nullptr) {
+        CHECK(transition->srcStages == VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        CHECK(transition->srcAccess == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+        CHECK(transition->dstStages == (VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT));
+        CHECK(transition->dstAccess == VK_ACCESS_SHADER_READ_BIT);
+        CHECK(transition->oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        CHECK(transition->newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    // The first read already made the write visible to the same stages
+    CHECK(findBarrier(graph.getBarriers(secondRead), shadow) == nullptr);
+
+    // The back buffer is written by both readers: a transition, then a write-after-write dependency
+    const RenderGraphBarrier* initial = findBarrier(graph.getBarriers(firstRead), backBuffer);
+    CHECK(initial != nullptr && initial->oldLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+    const RenderGraphBarrier* overwrite = findBarrier(graph.getBarriers(secondRead), backBuffer);
+    CHECK(overwrite != nullptr);
+    if (overwrite != nullptr) {
+        CHECK(overwrite->srcStages == VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        CHECK(overwrite->oldLayout == overwrite->newLayout);
+    }
+
+    // Handed to presentation at the end
+    const RenderGraphBarrier* final = findBarrier(graph.getFinalBarriers(), backBuffer);
+    CHECK(final != nullptr);
+    if (final != nullptr) {
+        CHECK(final->oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        CHECK(final->newLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    }
+    CHECK(graph.getStats().barrierBatchCount == 4);
+}
+
+// A compute pass writes draw arguments that a later graphics pass consumes, with an unrelated read in between
+TEST_CASE(RenderGraphPlansBufferBarriers) {
+    VulkanRenderGraph graph;
+    RenderGraphResource backBuffer = importBackBuffer(graph);
+    RenderGraphResource commands = graph.importBuffer("commands", RenderGraphState{}, RenderGraphState{});
+
+    uint32_t cull = graph.addPass("cull", RenderGraphPassType::Compute, noop);
+    graph.write(cull, commands, RenderGraphUsage::StorageWrite);
+    uint32_t draw = graph.addPass("draw", RenderGraphPassType::Graphics, noop);
+    graph.read(draw, commands, RenderGraphUsage::Indirect);
+    graph.addColorAttachment(draw, backBuffer);
+    uint32_t again = graph.addPass("draw again", RenderGraphPassType::Graphics, noop);
+    graph.read(again, commands, RenderGraphUsage::Indirect);
+    graph.addColorAttachment(again, backBuffer);
+    uint32_t reset = graph.addPass("reset", RenderGraphPassType::Compute, noop);
+    graph.write(reset, commands, RenderGraphUsage::StorageWrite);
+
+    graph.compileSimulated(fixedRequirements);
+    CHECK(!graph.isPassCulled(reset));
+    CHECK(findBarrier(graph.getBarriers(cull), commands) == nullptr);
+
+    const RenderGraphBarrier* indirect = findBarrier(graph.getBarriers(draw), commands);
+    CHECK(indirect != nullptr);
+    if (indirect != nullptr) {
+        CHECK(indirect->srcStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        CHECK(indirect->srcAccess == VK_ACCESS_SHADER_WRITE_BIT);
+        CHECK(indirect->dstStages == VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+        CHECK(indirect->dstAccess == VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+        CHECK(indirect->oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && indirect->newLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+    }
+    CHECK(findBarrier(graph.getBarriers(again), commands) == nullptr);
+
+    // Write after read only needs an execution dependency on the readers
+    const RenderGraphBarrier* overwrite = findBarrier(graph.getBarriers(reset), commands);
+    CHECK(overwrite != nullptr);
+    if (overwrite != nullptr) {
+        CHECK(overwrite->srcStages == VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+        CHECK(overwrite->srcAccess == 0);
+    }
+    // Buffers never count as image barriers
+    CHECK(graph.getStats().imageBarrierCount == 3);
+}
+
+TEST_CASE(RenderGraphRejectsTwoLayoutsInOnePass) {
+    VulkanRenderGraph graph;
+    RenderGraphResource backBuffer = importBackBuffer(graph);
+    uint32_t pass = graph.addPass("feedback", RenderGraphPassType::Graphics, noop);
+    graph.read(pass, backBuffer, RenderGraphUsage::Sampled);
+    graph.addColorAttachment(pass, backBuffer);
+
+    bool threw = false;
+    try {
+        graph.compileSimulated(fixedRequirements);
+    }
+    catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+TEST_CASE(RenderGraphSimulatedPlanCannotExecute) {
+    VulkanRenderGraph graph;
+    RenderGraphResource backBuffer = importBackBuffer(graph);
+    uint32_t pass = graph.addPass("present", RenderGraphPassType::Graphics, noop);
+    graph.addColorAttachment(pass, backBuffer);
+    graph.compileSimulated(fixedRequirements);
+
+    VulkanDevice device;
+    bool threw = false;
+    try {
+        graph.execute(device, VK_NULL_HANDLE);
+    }
+    catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    graph.destroy(device);
+}
@@ -0,0 +1,165 @@
+#include "TestFramework.h"
+
+#include "../VulkanStagingRing.h"
+
+#include <deque>
+#include <random>
+#include <vector>
+
+using namespace LightVulkan;
+
+namespace {
+    struct Range {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    // Follows VulkanUploadManager: a batch remembers the head and the bytes it consumed when submitted, and
+    // batches are released oldest first
+    struct Batch {
+        VkDeviceSize stagingEnd = 0;
+        VkDeviceSize stagingBytes = 0;
+        std::vector<Range> ranges;
+    };
+
+    class RingModel {
+    public:
+        explicit RingModel(VkDeviceSize capacity) {
+            ring.createSimulated(capacity);
+        }
+
+        // Returns false when the ring has no room, like reserveStaging before it waits
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize granularity, Range& range) {
+            VkDeviceSize offset, consumed;
+            VkDeviceSize granted = ring.allocate(size, alignment, granularity, offset, consumed);
+            if (granted == 0) {
+                return false;
+            }
+            range = { offset, granted };
+            overlapFound = overlapFound || overlapsLive(range) || offset + granted > ring.getCapacity() || offset % alignment != 0;
+            current.stagingBytes += consumed;
+            current.ranges.push_back(range);
+            return true;
+        }
+        void submit() {
+            current.stagingEnd = ring.getHead();
+            inFlight.push_back(current);
+            current = Batch{};
+        }
+        bool completeOldest() {
+            if (inFlight.empty()) {
+                return false;
+            }
+            ring.release(inFlight.front().stagingEnd, inFlight.front().stagingBytes);
+            inFlight.pop_front();
+            return true;
+        }
+
+        VulkanStagingRing ring;
+        bool overlapFound = false;
+
+    private:
+        bool overlapsLive(const Range& range) {
+            auto overlaps = [&range](const Batch& batch) {
+                for (const auto& other : batch.ranges) {
+                    if (range.offset < other.offset + other.size && other.offset < range.offset + range.size) {
+                        return true;
+                    }
+                }
+                return false;
+            };
+            bool found = overlaps(current);
+            for (const auto& batch : inFlight) {
+                found = found || overlaps(batch);
+            }
+            return found;
+        }
+
+        Batch current;
+        std::deque<Batch> inFlight;
+    };
+}
+
+TEST_CASE(StagingRingWrapsToTheFront) {
+    RingModel model(1024);
+    Range first, second, third;
+    CHECK(model.allocate(600, 16, 16, first));
+    model.submit();
+    CHECK(model.allocate(300, 16, 16, second));
+    model.submit();
+    CHECK(first.offset == 0);
+    CHECK(second.offset == 608);
+
+    // 400 bytes neither fit after the second range nor in front of the first until it is released
+    CHECK(!model.allocate(400, 16, 400, third));
+    CHECK(model.completeOldest());
+    CHECK(model.allocate(400, 16, 400, third));
+    CHECK(third.offset == 0);
+    CHECK(third.size == 400);
+    CHECK(!model.overlapFound);
+}
+
+TEST_CASE(StagingRingShortensToGranularity) {
+    RingModel model(1000);
+    Range first, second;
+    CHECK(model.allocate(700, 4, 4, first));
+    // 300 bytes are left, a request for 512 in steps of 128 gets two steps
+    CHECK(model.allocate(512, 4, 128, second));
+    CHECK(second.offset == 700);
+    CHECK(second.size == 256);
+    CHECK(!model.overlapFound);
+}
+
+// An empty batch still in flight when the ring drains used to move the tail back to its stale marker on release,
+// after allocate had already restarted at offset 0
+TEST_CASE(StagingRingIgnoresEmptyBatchMarkers) {
+    RingModel model(1024);
+    Range range;
+    CHECK(model.allocate(512, 16, 16, range));
+    model.submit();
+    model.submit();
+    CHECK(model.completeOldest());
+    CHECK(model.ring.getUsed() == 0);
+
+    CHECK(model.allocate(768, 16, 16, range));
+    CHECK(range.offset == 0);
+    model.submit();
+    CHECK(model.completeOldest());
+
+    // The 768 bytes at the front are still in flight, the ring has to wait for them instead of wrapping onto them
+    Range next;
+    CHECK(model.allocate(128, 16, 16, next));
+    CHECK(next.offset == 768);
+    CHECK(!model.allocate(256, 16, 256, next));
+    CHECK(!model.overlapFound);
+}
+
+// Random allocations, submits (empty ones included) and completions, checked against the ranges still in flight
+TEST_CASE(StagingRingRandomBatchesNeverOverlap) {
+    for (uint32_t seed = 0; seed < 50; seed++) {
+        std::mt19937 rng(seed);
+        RingModel model(64 * 1024);
+        for (uint32_t step = 0; step < 5000; step++) {
+            uint32_t action = rng() % 10;
+            if (action < 6) {
+                VkDeviceSize alignment = 1ull << (rng() % 5);
+                VkDeviceSize size = 1 + rng() % (16 * 1024);
+                VkDeviceSize granularity = alignment * (1 + rng() % 64);
+                Range range;
+                if (!model.allocate(size, alignment, granularity, range) && !model.completeOldest()) {
+                    model.submit();
+                }
+            }
+            else if (action < 8) {
+                model.submit();
+            }
+            else {
+                model.completeOldest();
+            }
+            if (model.overlapFound) {
+                break;
+            }
+        }
+        CHECK(!model.overlapFound);
+    }
+}